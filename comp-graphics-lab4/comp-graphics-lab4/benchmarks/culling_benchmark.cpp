@@ -0,0 +1,100 @@
+#include "camera_path.h"
+#include "culling_benchmark.h"
+#include "thread_pool.h"
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+    const std::string ENTRIES_ARG = "--entries=";
+    const std::string CAMERA_PATH_ARG = "--camera-path=";
+    const std::string OUT_ARG = "--out=";
+
+    constexpr size_t OBJECT_COUNT = 20000;
+    constexpr float FIELD_HALF_SIZE = 100.0f;
+    constexpr size_t DEFAULT_CAMERA_PATH_POSES = 256;
+
+    bool startsWith(const std::string& value, const std::string& prefix) {
+        return value.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    // Boxes of mixed size scattered through a cube, so every backend sees both dense and empty cells.
+    std::vector<SpatialIndex::Entry> createEntries() {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> position(-FIELD_HALF_SIZE, FIELD_HALF_SIZE);
+        std::uniform_real_distribution<float> size(0.1f, 4.0f);
+
+        std::vector<SpatialIndex::Entry> entries(OBJECT_COUNT);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            entries[i].bounds = BoundingBox(XMFLOAT3(position(random), position(random), position(random)),
+                XMFLOAT3(size(random), size(random), size(random)));
+            entries[i].objectIndex = i;
+        }
+        return entries;
+    }
+}
+
+// Compares the spatial index backends on frustum queries along a camera path. The scene is
+// a synthetic box field unless --entries names a file written by the application's
+// --export-culling-entries mode, and the path orbits the scene unless --camera-path names a
+// recorded one. Fails if any backend drops a box the exact frustum test keeps.
+int main(int argc, char* argv[]) {
+    std::string entriesFile;
+    std::string cameraPathFile;
+    std::string outFile;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (startsWith(arg, ENTRIES_ARG)) {
+            entriesFile = arg.substr(ENTRIES_ARG.size());
+        } else if (startsWith(arg, CAMERA_PATH_ARG)) {
+            cameraPathFile = arg.substr(CAMERA_PATH_ARG.size());
+        } else if (startsWith(arg, OUT_ARG)) {
+            outFile = arg.substr(OUT_ARG.size());
+        } else {
+            std::cerr << "unknown argument: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<SpatialIndex::Entry> entries;
+    if (entriesFile.empty()) {
+        entries = createEntries();
+    } else if (!loadCullingEntries(entriesFile, entries)) {
+        std::cerr << "cannot read entries from " << entriesFile << "\n";
+        return 1;
+    }
+
+    std::vector<CameraPose> path;
+    if (cameraPathFile.empty()) {
+        BoundingBox sceneBounds = entries.front().bounds;
+        for (const auto& entry : entries) {
+            BoundingBox::CreateMerged(sceneBounds, sceneBounds, entry.bounds);
+        }
+        path = createOrbitCameraPath(sceneBounds, DEFAULT_CAMERA_PATH_POSES);
+    } else if (!loadCameraPath(cameraPathFile, path)) {
+        std::cerr << "cannot read camera path from " << cameraPathFile << "\n";
+        return 1;
+    }
+
+    ThreadPool threadPool;
+    size_t falseNegatives = 0;
+    if (outFile.empty()) {
+        falseNegatives = runCullingBenchmark(entries, path, std::cout, &threadPool);
+    } else {
+        std::ofstream out(outFile);
+        falseNegatives = runCullingBenchmark(entries, path, out, &threadPool);
+        if (!out) {
+            std::cerr << "cannot write " << outFile << "\n";
+            return 1;
+        }
+    }
+
+    return falseNegatives == 0 ? 0 : 1;
+}
\ No newline at end of file
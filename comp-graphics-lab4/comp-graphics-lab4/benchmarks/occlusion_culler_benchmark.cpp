@@ -0,0 +1,178 @@
+#include "occlusion_culler.h"
+#include "thread_pool.h"
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+    constexpr size_t BLOCK_ROWS = 16;
+    constexpr float BLOCK_SPACING = 10.0f;
+    constexpr float BLOCK_HALF_SIZE = 3.5f;
+    constexpr float FIELD_HALF_SIZE = 0.5f * BLOCK_ROWS * BLOCK_SPACING;
+    constexpr size_t OBJECT_COUNT = 20000;
+    constexpr size_t FRAME_COUNT = 64;
+    constexpr float EYE_HEIGHT = 1.5f;
+
+    using Clock = std::chrono::steady_clock;
+
+    double elapsedMicroseconds(Clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    // A closed box with two triangles per face; corner i has its x, y and z offsets in bits
+    // 0, 1 and 2. The culler rasterizes both windings, so the face order does not matter.
+    OcclusionCuller::Occluder createBlock(const XMFLOAT3& center, const XMFLOAT3& extents) {
+        OcclusionCuller::Occluder block;
+        for (uint32_t corner = 0; corner < 8; ++corner) {
+            block.positions.emplace_back(
+                center.x + ((corner & 1) ? extents.x : -extents.x),
+                center.y + ((corner & 2) ? extents.y : -extents.y),
+                center.z + ((corner & 4) ? extents.z : -extents.z));
+        }
+        block.indices = {
+            0, 2, 3, 0, 3, 1,
+            4, 5, 7, 4, 7, 6,
+            0, 4, 6, 0, 6, 2,
+            1, 3, 7, 1, 7, 5,
+            0, 1, 5, 0, 5, 4,
+            2, 6, 7, 2, 7, 3 };
+        return block;
+    }
+
+    // A city grid: blocks of random height separated by streets, with small objects
+    // scattered over the whole field.
+    void createScene(std::vector<OcclusionCuller::Occluder>& occluders, std::vector<BoundingBox>& objects) {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> height(4.0f, 20.0f);
+        for (size_t row = 0; row < BLOCK_ROWS; ++row) {
+            for (size_t column = 0; column < BLOCK_ROWS; ++column) {
+                const float blockHeight = height(random);
+                const XMFLOAT3 center(
+                    -FIELD_HALF_SIZE + (static_cast<float>(column) + 0.5f) * BLOCK_SPACING, 0.5f * blockHeight,
+                    -FIELD_HALF_SIZE + (static_cast<float>(row) + 0.5f) * BLOCK_SPACING);
+                occluders.push_back(createBlock(center, XMFLOAT3(BLOCK_HALF_SIZE, 0.5f * blockHeight, BLOCK_HALF_SIZE)));
+            }
+        }
+
+        std::uniform_real_distribution<float> position(-FIELD_HALF_SIZE, FIELD_HALF_SIZE);
+        std::uniform_real_distribution<float> elevation(0.0f, 3.0f);
+        std::uniform_real_distribution<float> size(0.2f, 1.0f);
+        for (size_t i = 0; i < OBJECT_COUNT; ++i) {
+            objects.emplace_back(XMFLOAT3(position(random), elevation(random), position(random)),
+                XMFLOAT3(size(random), size(random), size(random)));
+        }
+    }
+
+    // Walks down a street at eye height while turning around once.
+    void createCamera(size_t frame, XMFLOAT4X4& viewProj, BoundingFrustum& frustum) {
+        const float t = static_cast<float>(frame) / static_cast<float>(FRAME_COUNT);
+        const float yaw = XM_2PI * t;
+        const XMVECTOR eye = XMVectorSet(0.0f, EYE_HEIGHT, -FIELD_HALF_SIZE + 2.0f * FIELD_HALF_SIZE * t, 0.0f);
+        const XMVECTOR direction = XMVectorSet(std::sin(yaw), 0.0f, std::cos(yaw), 0.0f);
+
+        const XMMATRIX view = XMMatrixLookToLH(eye, direction, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        const XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 4.0f * FIELD_HALF_SIZE);
+        XMStoreFloat4x4(&viewProj, view * proj);
+
+        BoundingFrustum viewSpaceFrustum;
+        BoundingFrustum::CreateFromMatrix(viewSpaceFrustum, proj);
+        viewSpaceFrustum.Transform(frustum, XMMatrixInverse(nullptr, view));
+    }
+
+    struct RunResult {
+        double renderMicroseconds = 0.0;
+        double maxRenderMicroseconds = 0.0;
+        double testNanoseconds = 0.0;
+        size_t frustumVisible = 0;
+        size_t occluded = 0;
+        std::vector<bool> visibility;
+    };
+
+    RunResult run(const std::vector<OcclusionCuller::Occluder>& occluders, const std::vector<BoundingBox>& objects,
+        ThreadPool* threadPool) {
+        OcclusionCuller culler;
+        for (const auto& occluder : occluders) {
+            culler.addOccluder(occluder);
+        }
+
+        RunResult result;
+        double testMicroseconds = 0.0;
+        std::vector<size_t> frustumObjects;
+        for (size_t frame = 0; frame < FRAME_COUNT; ++frame) {
+            XMFLOAT4X4 viewProj;
+            BoundingFrustum frustum;
+            createCamera(frame, viewProj, frustum);
+
+            Clock::time_point start = Clock::now();
+            culler.render(viewProj, threadPool);
+            const double renderMicroseconds = elapsedMicroseconds(start);
+            result.renderMicroseconds += renderMicroseconds;
+            result.maxRenderMicroseconds = std::max(result.maxRenderMicroseconds, renderMicroseconds);
+
+            frustumObjects.clear();
+            for (size_t i = 0; i < objects.size(); ++i) {
+                if (frustum.Intersects(objects[i])) {
+                    frustumObjects.push_back(i);
+                }
+            }
+
+            start = Clock::now();
+            for (size_t i : frustumObjects) {
+                result.visibility.push_back(culler.isVisible(objects[i]));
+            }
+            testMicroseconds += elapsedMicroseconds(start);
+
+            result.frustumVisible += frustumObjects.size();
+            result.occluded += static_cast<size_t>(
+                std::count(result.visibility.end() - frustumObjects.size(), result.visibility.end(), false));
+        }
+
+        result.renderMicroseconds /= static_cast<double>(FRAME_COUNT);
+        result.testNanoseconds = 1000.0 * testMicroseconds / static_cast<double>(std::max<size_t>(result.frustumVisible, 1));
+        return result;
+    }
+}
+
+// Renders a synthetic city of block occluders along a street-level camera path and tests
+// scattered boxes against it, once on the calling thread and once on a thread pool. The
+// two runs must agree on every box.
+int main() {
+    std::vector<OcclusionCuller::Occluder> occluders;
+    std::vector<BoundingBox> objects;
+    createScene(occluders, objects);
+
+    ThreadPool threadPool;
+    const RunResult serial = run(occluders, objects, nullptr);
+    const RunResult parallel = run(occluders, objects, &threadPool);
+
+    const double frameCount = static_cast<double>(FRAME_COUNT);
+    std::cout << "occlusion culler (" << occluders.size() * 12 << " occluder triangles, " << objects.size() <<
+        " objects, " << FRAME_COUNT << " frames)\n";
+    std::cout << std::left << std::setw(14) << "threads" << std::right << std::setw(12) << "render us" <<
+        std::setw(12) << "max us" << std::setw(12) << "test ns" << std::setw(12) << "in frustum" <<
+        std::setw(12) << "occluded" << "\n";
+    const std::pair<std::string, const RunResult*> rows[] = {
+        { "1", &serial }, { std::to_string(threadPool.getThreadCount()), &parallel } };
+    for (const auto& row : rows) {
+        const RunResult& result = *row.second;
+        std::cout << std::left << std::setw(14) << row.first << std::right << std::fixed << std::setprecision(1) <<
+            std::setw(12) << result.renderMicroseconds << std::setw(12) << result.maxRenderMicroseconds <<
+            std::setw(12) << result.testNanoseconds <<
+            std::setw(12) << static_cast<double>(result.frustumVisible) / frameCount <<
+            std::setw(12) << static_cast<double>(result.occluded) / frameCount << "\n";
+    }
+
+    const bool identical = serial.visibility == parallel.visibility;
+    std::cout << "identical results: " << (identical ? "yes" : "no") << "\n";
+    return identical ? 0 : 1;
+}
\ No newline at end of file
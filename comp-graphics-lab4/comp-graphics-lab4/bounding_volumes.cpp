@@ -0,0 +1,175 @@
+#include "bounding_volumes.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+    // Points are fitted in double precision so nearly cospherical points do not break the
+    // boundary solves; the float result is padded afterwards to stay conservative.
+    struct Point {
+        double x, y, z;
+    };
+
+    struct Sphere {
+        Point center;
+        double radiusSquared;
+    };
+
+    constexpr double CONTAINMENT_TOLERANCE = 1e-10;
+    constexpr double DEGENERATE_TOLERANCE = 1e-14;
+    constexpr uint32_t SHUFFLE_SEED = 1;
+
+    Point subtract(const Point& a, const Point& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    Point add(const Point& a, const Point& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+    Point scale(const Point& a, double s) { return { a.x * s, a.y * s, a.z * s }; }
+    double dot(const Point& a, const Point& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    Point cross(const Point& a, const Point& b) {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    bool contains(const Sphere& sphere, const Point& point) {
+        const Point offset = subtract(point, sphere.center);
+        return dot(offset, offset) <= sphere.radiusSquared * (1.0 + CONTAINMENT_TOLERANCE) + DEGENERATE_TOLERANCE;
+    }
+
+    Sphere sphereFrom(const Point& a, const Point& b) {
+        const Point half = scale(subtract(b, a), 0.5);
+        return { add(a, half), dot(half, half) };
+    }
+
+    // Circumsphere of a triangle, centered in its plane; collinear points keep the widest pair.
+    Sphere sphereFrom(const Point& a, const Point& b, const Point& c) {
+        const Point ab = subtract(b, a);
+        const Point ac = subtract(c, a);
+        const Point normal = cross(ab, ac);
+        const double normalLengthSquared = dot(normal, normal);
+        if (normalLengthSquared <= DEGENERATE_TOLERANCE * dot(ab, ab) * dot(ac, ac)) {
+            Sphere sphere = sphereFrom(a, b);
+            for (const Sphere& candidate : { sphereFrom(a, c), sphereFrom(b, c) }) {
+                if (candidate.radiusSquared > sphere.radiusSquared) {
+                    sphere = candidate;
+                }
+            }
+            return sphere;
+        }
+
+        const Point offset = scale(add(scale(cross(normal, ab), dot(ac, ac)), scale(cross(ac, normal), dot(ab, ab))),
+            0.5 / normalLengthSquared);
+        return { add(a, offset), dot(offset, offset) };
+    }
+
+    // Circumsphere of a tetrahedron; a flat one keeps the widest face circle instead.
+    Sphere sphereFrom(const Point& a, const Point& b, const Point& c, const Point& d) {
+        const Point u = subtract(b, a);
+        const Point v = subtract(c, a);
+        const Point w = subtract(d, a);
+        const double determinant = dot(u, cross(v, w));
+        const double scaleCubed = std::sqrt(dot(u, u) * dot(v, v) * dot(w, w));
+        if (std::fabs(determinant) <= DEGENERATE_TOLERANCE * scaleCubed) {
+            Sphere sphere = sphereFrom(a, b, c);
+            for (const Sphere& candidate : { sphereFrom(a, b, d), sphereFrom(a, c, d), sphereFrom(b, c, d) }) {
+                if (candidate.radiusSquared > sphere.radiusSquared) {
+                    sphere = candidate;
+                }
+            }
+            return sphere;
+        }
+
+        const Point offset = scale(add(add(scale(cross(v, w), dot(u, u)), scale(cross(w, u), dot(v, v))),
+            scale(cross(u, v), dot(w, w))), 0.5 / determinant);
+        return { add(a, offset), dot(offset, offset) };
+    }
+
+    const XMFLOAT3& pointAt(const XMFLOAT3* points, size_t stride, size_t index) {
+        return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const char*>(points) + index * stride);
+    }
+
+    float getVolume(const XMFLOAT3& extents) {
+        return extents.x * extents.y * extents.z;
+    }
+}
+
+BoundingSphere computeMinimalSphere(size_t count, const XMFLOAT3* points, size_t stride) {
+    if (count == 0) {
+        return BoundingSphere(XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f);
+    }
+
+    std::vector<Point> shuffled(count);
+    for (size_t i = 0; i < count; ++i) {
+        const XMFLOAT3& point = pointAt(points, stride, i);
+        shuffled[i] = { point.x, point.y, point.z };
+    }
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(SHUFFLE_SEED));
+
+    // Each nested loop fixes one more point on the boundary of the sphere of the points
+    // seen so far; a random order makes the inner loops rare.
+    Sphere sphere = { shuffled[0], 0.0 };
+    for (size_t i = 1; i < count; ++i) {
+        if (contains(sphere, shuffled[i])) {
+            continue;
+        }
+        sphere = { shuffled[i], 0.0 };
+        for (size_t j = 0; j < i; ++j) {
+            if (contains(sphere, shuffled[j])) {
+                continue;
+            }
+            sphere = sphereFrom(shuffled[i], shuffled[j]);
+            for (size_t k = 0; k < j; ++k) {
+                if (contains(sphere, shuffled[k])) {
+                    continue;
+                }
+                sphere = sphereFrom(shuffled[i], shuffled[j], shuffled[k]);
+                for (size_t l = 0; l < k; ++l) {
+                    if (!contains(sphere, shuffled[l])) {
+                        sphere = sphereFrom(shuffled[i], shuffled[j], shuffled[k], shuffled[l]);
+                    }
+                }
+            }
+        }
+    }
+
+    // Rounding the center to float moves it by up to an ulp of its largest coordinate.
+    const XMFLOAT3 center(static_cast<float>(sphere.center.x), static_cast<float>(sphere.center.y),
+        static_cast<float>(sphere.center.z));
+    const double centerMagnitude = std::max({ std::fabs(sphere.center.x), std::fabs(sphere.center.y), std::fabs(sphere.center.z) });
+    const double radius = std::sqrt(sphere.radiusSquared) * (1.0 + CONTAINMENT_TOLERANCE) + 2.0 * FLT_EPSILON * centerMagnitude;
+    return BoundingSphere(center, static_cast<float>(radius) * (1.0f + FLT_EPSILON));
+}
+
+BoundingOrientedBox computeOrientedBox(size_t count, const XMFLOAT3* points, size_t stride) {
+    BoundingOrientedBox orientedBox;
+    if (count == 0) {
+        orientedBox.Extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+        return orientedBox;
+    }
+
+    BoundingBox axisAlignedBox;
+    BoundingBox::CreateFromPoints(axisAlignedBox, count, points, stride);
+    BoundingOrientedBox::CreateFromPoints(orientedBox, count, points, stride);
+    if (getVolume(axisAlignedBox.Extents) <= getVolume(orientedBox.Extents)) {
+        BoundingOrientedBox::CreateFromBoundingBox(orientedBox, axisAlignedBox);
+    }
+    return orientedBox;
+}
+
+void fitSubmeshBounds(Submesh& submesh, const Vertex* vertices, size_t vertexCount) {
+    BoundingBox::CreateFromPoints(submesh.bounds, vertexCount, &vertices[0].position, sizeof(Vertex));
+    submesh.sphereBounds = computeMinimalSphere(vertexCount, &vertices[0].position, sizeof(Vertex));
+    submesh.orientedBounds = computeOrientedBox(vertexCount, &vertices[0].position, sizeof(Vertex));
+}
+
+bool intersectsTightBounds(const BoundingFrustum& frustum, const Submesh& submesh) {
+    switch (frustum.Contains(submesh.sphereBounds)) {
+    case DISJOINT:
+        return false;
+    case CONTAINS:
+        return true;
+    default:
+        return frustum.Intersects(submesh.orientedBounds);
+    }
+}
\ No newline at end of file
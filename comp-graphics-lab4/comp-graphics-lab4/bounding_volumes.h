@@ -0,0 +1,24 @@
+#ifndef BOUNDING_VOLUMES_H
+#define BOUNDING_VOLUMES_H
+
+#include "mesh_data.h"
+
+#include <DirectXCollision.h>
+
+// Smallest sphere enclosing the points, found with Welzl's algorithm in its iterative
+// move-to-front form over a shuffled copy of the points (expected linear time).
+DirectX::BoundingSphere computeMinimalSphere(size_t count, const DirectX::XMFLOAT3* points, size_t stride);
+
+// Box aligned with the principal axes of the points. Falls back to the axis-aligned box when
+// that one is smaller, which happens for boxy geometry whose covariance has no clear axes.
+DirectX::BoundingOrientedBox computeOrientedBox(size_t count, const DirectX::XMFLOAT3* points, size_t stride);
+
+// Fits the axis-aligned box, the minimal sphere and the oriented box of a submesh to its vertices.
+void fitSubmeshBounds(Submesh& submesh, const Vertex* vertices, size_t vertexCount);
+
+// Second culling stage for submeshes whose axis-aligned box touches the frustum. The sphere
+// settles most of them: it is either outside, or inside and the submesh is visible. Only a
+// sphere straddling a frustum plane pays for the oriented box test.
+bool intersectsTightBounds(const DirectX::BoundingFrustum& frustum, const Submesh& submesh);
+
+#endif // BOUNDING_VOLUMES_H
\ No newline at end of file
@@ -3,6 +3,10 @@
 #include "model_loader.h"
 #include "DDSTextureLoader.h"
 #include "rendering_system.h"
+#include "meshlet_builder.h"
+#include "bounding_volumes.h"
+#include "index_pools.h"
+#include "scene_occluders.h"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -29,8 +33,19 @@ namespace {
         float padding;
     };
 
-    bool isColumnSubmesh(const Submesh& submesh) {
-        return submesh.material.diffuseTextureName.find("column") != std::string::npos;
+    const D3D_SHADER_MACRO PACKED_VERTEX_DEFINES[] = { { "PACKED_VERTICES", "1" }, { nullptr, nullptr } };
+    const D3D_SHADER_MACRO QUANTIZED_VERTEX_DEFINES[] = { { "QUANTIZED_VERTICES", "1" }, { nullptr, nullptr } };
+
+    const D3D_SHADER_MACRO* getVertexFormatDefines(VertexFormat format) {
+        switch (format) {
+        case VertexFormat::Packed:
+            return PACKED_VERTEX_DEFINES;
+        case VertexFormat::Quantized:
+            return QUANTIZED_VERTEX_DEFINES;
+        case VertexFormat::Full:
+        default:
+            return nullptr;
+        }
     }
 
     bool hasDisplacementTexture(const Submesh& submesh) {
@@ -72,6 +87,18 @@ namespace {
         }
     }
 
+    // byteSize is the size of the uploaded buffer, which must hold pools.createBuffer().
+    void setIndexPoolViews(ID3D12Resource* buffer, const IndexPools& pools, UINT byteSize, D3D12_INDEX_BUFFER_VIEW views[2]) {
+        const UINT longPoolOffset = static_cast<UINT>(pools.getLongPoolOffset());
+        views[0].BufferLocation = buffer->GetGPUVirtualAddress();
+        views[0].Format = DXGI_FORMAT_R16_UINT;
+        views[0].SizeInBytes = static_cast<UINT>(pools.shortIndices.size() * sizeof(uint16_t));
+
+        views[1].BufferLocation = buffer->GetGPUVirtualAddress() + longPoolOffset;
+        views[1].Format = DXGI_FORMAT_R32_UINT;
+        views[1].SizeInBytes = byteSize - longPoolOffset;
+    }
+
     void appendMesh(MeshData& destination, const MeshData& source, float maxTessFactor) {
         const UINT vertexOffset = static_cast<UINT>(destination.vertices.size());
         const UINT indexOffset = static_cast<UINT>(destination.indices.size());
@@ -113,6 +140,7 @@ void BoxApp::buildResources() {
     buildPso(L"main_shader.hlsl", mPSO);
     buildPso(L"main_shader.hlsl", mEarthTessPSO, true);
     buildPso(L"column_shader.hlsl", mColumnPSO);
+    buildDepthPso();
     buildPso(L"lighting_shader.hlsl", mLightingPSO);
     buildParticlePso();
     failCheck(mCommandList->Close());
@@ -130,10 +158,28 @@ void BoxApp::setObjectSize(Vertex& vertex, float scale) {
 
 void BoxApp::buildBuffers() {
     ModelLoader loader(SPONZA_SCALE);
-    MeshData mesh = loader.loadModel("sponza.obj");
+    MeshData mesh = loader.loadModel("sponza.obj", &mThreadPool);
+    const size_t sponzaSubmeshCount = mesh.submeshes.size();
+
+    // Baked with --bake-pvs. A missing or stale bake leaves PVS culling off.
+    if (!mPvs.load("sponza.pvs") || mPvs.getSubmeshCount() != sponzaSubmeshCount ||
+        mPvs.getSourceIndexCount() != mesh.indices.size()) {
+        mPvs = PotentiallyVisibleSet();
+    }
+    mPvsCell = PotentiallyVisibleSet::INVALID_CELL;
+
+    // Built with --bake-hlod and validated the same way.
+    if (!mHlod.load("sponza.hlod") || mHlod.getSourceSubmeshCount() != sponzaSubmeshCount ||
+        mHlod.getSourceIndexCount() != mesh.indices.size()) {
+        mHlod = HlodSet();
+    }
+
+    // Sponza submeshes keep their indices in mSubmeshes, so hits name them directly.
+    mSceneTriangles.build(mesh);
+    mPickedHit = {};
 
     ModelLoader earthLoader(1.0f);
-    MeshData earthMesh = earthLoader.loadModel("Earth.fbx");
+    MeshData earthMesh = earthLoader.loadModel("Earth.fbx", &mThreadPool);
     rotateMeshX(earthMesh, XM_PI);
     transformMesh(earthMesh, EARTH_SCALE, XMFLOAT3(0.f, 0.f, 0.f));
     appendMesh(mesh, earthMesh, 10.f);
@@ -155,17 +201,54 @@ void BoxApp::buildBuffers() {
 
     appendMesh(mesh, billboardMesh, 1.0f);
 
-    const UINT vbByteSize = static_cast<UINT>(mesh.vertices.size() * sizeof(Vertex));
-    const UINT ibByteSize = static_cast<UINT>(mesh.indices.size() * sizeof(uint32_t));
+    // The proxies come after the billboard and stay out of the spatial index; they are only
+    // drawn when HlodSet::select swaps them in for their children.
+    const size_t proxyMeshStart = mesh.submeshes.size();
+    appendMesh(mesh, mHlod.createProxyMesh(mesh), 1.0f);
+
+    // Columns are displaced in the vertex shader, so their triangles cannot be culled on the CPU.
+    MeshletBuilder meshletBuilder;
+    for (size_t submeshIndex = 0; submeshIndex < sponzaSubmeshCount; ++submeshIndex) {
+        if (!isColumnSubmesh(mesh.submeshes[submeshIndex])) {
+            meshletBuilder.build(mesh, submeshIndex);
+        }
+    }
+    mMeshlets = std::move(mesh.meshlets);
+
+    // The CPU keeps the full interleaved vertices; the GPU gets them split into streams.
+    // Quantizing also stores the mesh's position range in every submesh, which the copies
+    // below carry into mSubmeshes.
+    const VertexStreams streams = createVertexStreams(mesh, mVertexFormat);
+
+    // Indices are uploaded relative to each submesh's base vertex, in 16 bits where they fit.
+    assignIndexPools(mesh);
+    const IndexPools indexPools = createIndexPools(mesh, mesh.indices);
+    const std::vector<uint8_t> indexData = indexPools.createBuffer();
+    // Welding only points indices at earlier vertices of the same submesh, so the welded pools
+    // share the regular pools' offsets, widths and base vertices.
+    const IndexPools weldedIndexPools = createIndexPools(mesh, createPositionWeldedIndices(mesh));
+    const std::vector<uint8_t> weldedIndexData = weldedIndexPools.createBuffer();
 
-    mVertexBufferGPU = D3DUtil::createDefaultBuffer(md3dDevice.Get(), mCommandList.Get(),
-        mesh.vertices.data(), vbByteSize, mVertexBufferUploader);
+    const UINT positionByteSize = static_cast<UINT>(streams.positions.size());
+    const UINT attributeByteSize = static_cast<UINT>(streams.attributes.size());
+    const UINT ibByteSize = static_cast<UINT>(indexData.size());
+    const UINT weldedIbByteSize = static_cast<UINT>(weldedIndexData.size());
+
+    mPositionBufferGPU = D3DUtil::createDefaultBuffer(md3dDevice.Get(), mCommandList.Get(),
+        streams.positions.data(), positionByteSize, mPositionBufferUploader);
+
+    mAttributeBufferGPU = D3DUtil::createDefaultBuffer(md3dDevice.Get(), mCommandList.Get(),
+        streams.attributes.data(), attributeByteSize, mAttributeBufferUploader);
 
     mIndexBufferGPU = D3DUtil::createDefaultBuffer(md3dDevice.Get(), mCommandList.Get(),
-        mesh.indices.data(), ibByteSize, mIndexBufferUploader);
+        indexData.data(), ibByteSize, mIndexBufferUploader);
+
+    mWeldedIndexBufferGPU = D3DUtil::createDefaultBuffer(md3dDevice.Get(), mCommandList.Get(),
+        weldedIndexData.data(), weldedIbByteSize, mWeldedIndexBufferUploader);
 
     mSubmeshes.clear();
     mSubmeshWorlds.clear();
+    mHlodProxyStart = 0;
     std::vector<Submesh> earthSubmeshTemplates;
     earthSubmeshTemplates.reserve(earthMesh.submeshes.size());
 
@@ -173,13 +256,18 @@ void BoxApp::buildBuffers() {
         const auto& sm = mesh.submeshes[i];
         Submesh submesh(sm);
 
-        const UINT nextSubmeshStartVertex = (i + 1 < mesh.submeshes.size())
-            ? mesh.submeshes[i + 1].startVerticeIndex
-            : static_cast<UINT>(mesh.vertices.size());
-        const UINT submeshVertexCount = nextSubmeshStartVertex - submesh.startVerticeIndex;
-        const Vertex* submeshVertices = mesh.vertices.data() + submesh.startVerticeIndex;
-        BoundingBox::CreateFromPoints(submesh.bounds, submeshVertexCount,
-            &submeshVertices[0].position, sizeof(Vertex));
+        // The loader fitted the Sponza bounds; Earth was transformed and the proxies come unfitted.
+        if (i >= sponzaSubmeshCount) {
+            const UINT nextSubmeshStartVertex = (i + 1 < mesh.submeshes.size())
+                ? mesh.submeshes[i + 1].startVerticeIndex
+                : static_cast<UINT>(mesh.vertices.size());
+            const UINT submeshVertexCount = nextSubmeshStartVertex - submesh.startVerticeIndex;
+            const Vertex* submeshVertices = mesh.vertices.data() + submesh.startVerticeIndex;
+            fitSubmeshBounds(submesh, submeshVertices, submeshVertexCount);
+        }
+        if (i == proxyMeshStart) {
+            mHlodProxyStart = mSubmeshes.size();
+        }
 
         if (hasDisplacementTexture(submesh)) {
             earthSubmeshTemplates.push_back(submesh);
@@ -190,6 +278,8 @@ void BoxApp::buildBuffers() {
         if (isBillboard) {
             submesh.bounds.Center = mEarthPosition;
             submesh.bounds.Extents = XMFLOAT3(BILLBOARD_SIZE * 1.5f, BILLBOARD_SIZE * 1.5f, BILLBOARD_SIZE * 1.5f);
+            BoundingSphere::CreateFromBoundingBox(submesh.sphereBounds, submesh.bounds);
+            BoundingOrientedBox::CreateFromBoundingBox(submesh.orientedBounds, submesh.bounds);
             mBillboardIndex = mSubmeshes.size();
         }
 
@@ -209,45 +299,83 @@ void BoxApp::buildBuffers() {
     for (const auto& earthTemplate : earthSubmeshTemplates) {
         Submesh earthSubmesh(earthTemplate);
         earthTemplate.bounds.Transform(earthSubmesh.bounds, earthWorldMatrix);
+        earthTemplate.sphereBounds.Transform(earthSubmesh.sphereBounds, earthWorldMatrix);
+        earthTemplate.orientedBounds.Transform(earthSubmesh.orientedBounds, earthWorldMatrix);
         earthSubmesh.maxTessellationFactor = 1.0f;
         mEarthSubmeshIndices.push_back(mSubmeshes.size());
         mSubmeshes.push_back(earthSubmesh);
         mSubmeshWorlds.push_back(earthWorldTransform);
     }
 
-    buildOctree();
+    XMFLOAT4X4 identity;
+    XMStoreFloat4x4(&identity, XMMatrixIdentity());
+    mOcclusionCuller.clearOccluders();
+    for (size_t submeshIndex = 0; submeshIndex < mSubmeshes.size(); ++submeshIndex) {
+        const Submesh& submesh = mSubmeshes[submeshIndex];
+        if (!isHlodProxy(submeshIndex) && isOccluderSubmesh(submesh)) {
+            mOcclusionCuller.addOccluder(createOccluder(mesh, submesh, identity, OCCLUDER_MIN_TRIANGLE_AREA));
+        }
+    }
 
-    mInputLayout = {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "BINORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 36, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 48, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-    };
+    buildSpatialIndex();
+
+    // Must match PositionIn and VertexIn in vertex_input.hlsli.
+    const D3D12_INPUT_ELEMENT_DESC positionElement = mVertexFormat == VertexFormat::Quantized
+        ? D3D12_INPUT_ELEMENT_DESC{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+        : D3D12_INPUT_ELEMENT_DESC{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+    mDepthInputLayout = { positionElement };
+    if (mVertexFormat == VertexFormat::Full) {
+        mInputLayout = {
+            positionElement,
+            { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "BINORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 1, 36, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        };
+    }
+    else {
+        mInputLayout = {
+            positionElement,
+            { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TANGENT", 0, DXGI_FORMAT_R16G16_SINT, 1, 4, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 1, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        };
+    }
 
-    mVertexBufferView.BufferLocation = mVertexBufferGPU->GetGPUVirtualAddress();
-    mVertexBufferView.StrideInBytes = sizeof(Vertex);
-    mVertexBufferView.SizeInBytes = vbByteSize;
+    mVertexBufferViews[0].BufferLocation = mPositionBufferGPU->GetGPUVirtualAddress();
+    mVertexBufferViews[0].StrideInBytes = streams.positionStride;
+    mVertexBufferViews[0].SizeInBytes = positionByteSize;
 
-    mIndexBufferView.BufferLocation = mIndexBufferGPU->GetGPUVirtualAddress();
-    mIndexBufferView.Format = DXGI_FORMAT_R32_UINT;
-    mIndexBufferView.SizeInBytes = ibByteSize;
+    mVertexBufferViews[1].BufferLocation = mAttributeBufferGPU->GetGPUVirtualAddress();
+    mVertexBufferViews[1].StrideInBytes = streams.attributeStride;
+    mVertexBufferViews[1].SizeInBytes = attributeByteSize;
+
+    setIndexPoolViews(mIndexBufferGPU.Get(), indexPools, ibByteSize, mIndexBufferViews);
+    setIndexPoolViews(mWeldedIndexBufferGPU.Get(), weldedIndexPools, weldedIbByteSize, mWeldedIndexBufferViews);
 
     mIndexCount = static_cast<UINT>(mesh.indices.size());
 }
 
-void BoxApp::buildOctree() {
-    std::vector<Octree::Entry> entries;
+void BoxApp::buildSpatialIndex() {
+    std::vector<SpatialIndex::Entry> entries;
     entries.reserve(mSubmeshes.size());
 
+    // HLOD proxies are left out, so entry positions and submesh indices can differ.
+    mBillboardIndexHandle = SpatialIndex::INVALID_HANDLE;
     for (size_t submeshIndex = 0; submeshIndex < mSubmeshes.size(); ++submeshIndex) {
-        entries.push_back({ submeshIndex, mSubmeshes[submeshIndex].bounds });
+        if (!isHlodProxy(submeshIndex)) {
+            if (submeshIndex == mBillboardIndex) {
+                mBillboardIndexHandle = static_cast<SpatialIndex::Handle>(entries.size());
+            }
+            entries.push_back({ submeshIndex, mSubmeshes[submeshIndex].bounds });
+        }
     }
 
-    mSceneOctree.rebuild(entries, 24, 8);
+    mSceneIndex = SpatialIndex::create(mSpatialIndexType, &mThreadPool);
+    mSceneIndex->rebuild(entries);
 }
 
-std::vector<size_t> BoxApp::collectVisibleSubmeshes() const {
+BoundingFrustum BoxApp::computeWorldFrustum() const {
     XMMATRIX view = XMLoadFloat4x4(&mView);
     XMMATRIX proj = XMLoadFloat4x4(&mProj);
 
@@ -257,8 +385,101 @@ std::vector<size_t> BoxApp::collectVisibleSubmeshes() const {
     BoundingFrustum worldFrustum;
     const XMMATRIX invView = XMMatrixInverse(nullptr, view);
     viewSpaceFrustum.Transform(worldFrustum, invView);
+    return worldFrustum;
+}
+
+// Front-to-back order lets early depth testing reject hidden pixels of later submeshes.
+// Submeshes covering only a few pixels go to mImpostorSubmeshIndices instead.
+void BoxApp::collectVisibleSubmeshes(std::vector<size_t>& visibleSubmeshIndices, SpatialIndex::QueryStats* stats) {
+    const BoundingFrustum frustum = computeWorldFrustum();
+    const auto contribution = SpatialIndex::ContributionCulling::fromProjection(mEyePos, mProj, mViewport.Height,
+        mEnableContributionCulling ? MIN_CONTRIBUTION_PIXELS : 0.0f);
+
+    mImpostorSubmeshIndices.clear();
+    if (!mEnableFrontToBackOrder) {
+        mSceneIndex->query(frustum, contribution, visibleSubmeshIndices, &mImpostorSubmeshIndices, stats);
+    }
+    else {
+        mVisibleSubmeshDepths.clear();
+        mSceneIndex->queryFrontToBack(frustum, contribution, mVisibleSubmeshDepths, &mImpostorSubmeshIndices, stats);
+        for (const auto& visible : mVisibleSubmeshDepths) {
+            visibleSubmeshIndices.push_back(visible.objectIndex);
+        }
+    }
+
+    mTightBoundsCulledCount = removeOutsideTightBounds(frustum, visibleSubmeshIndices);
+    removeOutsideTightBounds(frustum, mImpostorSubmeshIndices);
+    mPvsCulledCount = removePvsHiddenSubmeshes(visibleSubmeshIndices);
+    removePvsHiddenSubmeshes(mImpostorSubmeshIndices);
+}
 
-    return mSceneOctree.query(worldFrustum);
+// The index only tests axis-aligned boxes, which reach far past long diagonal and round
+// geometry; the sphere and oriented box of the submesh drop most of those.
+size_t BoxApp::removeOutsideTightBounds(const BoundingFrustum& frustum, std::vector<size_t>& submeshIndices) const {
+    const size_t count = submeshIndices.size();
+    submeshIndices.erase(std::remove_if(submeshIndices.begin(), submeshIndices.end(),
+        [this, &frustum](size_t submeshIndex) { return !intersectsTightBounds(frustum, mSubmeshes[submeshIndex]); }),
+        submeshIndices.end());
+    return count - submeshIndices.size();
+}
+
+bool BoxApp::isHlodProxy(size_t submeshIndex) const {
+    return submeshIndex >= mHlodProxyStart && submeshIndex < mHlodProxyStart + mHlod.getProxyCount();
+}
+
+// Sponza submeshes come first in mSubmeshes, so the baked sets index them directly; the
+// Earth and the billboard are never culled. An eye outside the baked grid keeps everything.
+size_t BoxApp::removePvsHiddenSubmeshes(std::vector<size_t>& submeshIndices) {
+    const size_t cell = mPvs.findCell(mEyePos);
+    if (!mEnablePvsCulling || cell == PotentiallyVisibleSet::INVALID_CELL) {
+        return 0;
+    }
+
+    if (cell != mPvsCell) {
+        mPvs.getVisibleSet(cell, mPvsVisibleSet);
+        mPvsCell = cell;
+    }
+
+    const size_t pvsSubmeshCount = mPvs.getSubmeshCount();
+    const size_t count = submeshIndices.size();
+    submeshIndices.erase(std::remove_if(submeshIndices.begin(), submeshIndices.end(),
+        [this, pvsSubmeshCount](size_t submeshIndex) {
+            return submeshIndex < pvsSubmeshCount && !PotentiallyVisibleSet::isVisible(mPvsVisibleSet, submeshIndex);
+        }),
+        submeshIndices.end());
+    return count - submeshIndices.size();
+}
+
+// Hangs the light from the ceiling above the surface in the middle of the view. Where
+// nothing is above, the chain is anchored just high enough for the light to clear the
+// surface; with nothing in view the light is dropped at the eye as before.
+XMFLOAT3 BoxApp::findLightAnchor() const {
+    Ray viewRay;
+    viewRay.origin = mEyePos;
+    viewRay.direction = mLook;
+
+    TriangleBvh::RayHit surfaceHit;
+    if (!mSceneTriangles.intersect(viewRay, surfaceHit)) {
+        return mEyePos;
+    }
+
+    const XMVECTOR look = XMVector3Normalize(XMLoadFloat3(&mLook));
+    const XMVECTOR surfacePoint = XMVectorSubtract(
+        XMVectorAdd(XMLoadFloat3(&mEyePos), XMVectorScale(XMLoadFloat3(&mLook), surfaceHit.distance)),
+        XMVectorScale(look, LIGHT_SURFACE_OFFSET));
+
+    Ray upRay;
+    XMStoreFloat3(&upRay.origin, surfacePoint);
+    upRay.direction = XMFLOAT3(0.0f, 1.0f, 0.0f);
+    upRay.maxDistance = LIGHT_ANCHOR_MAX_HEIGHT;
+
+    TriangleBvh::RayHit ceilingHit;
+    const float anchorHeight = mSceneTriangles.intersect(upRay, ceilingHit) ?
+        ceilingHit.distance - LIGHT_SURFACE_OFFSET : LIGHT_CHAIN_LENGTH + LIGHT_SURFACE_OFFSET;
+
+    XMFLOAT3 anchor = upRay.origin;
+    anchor.y += anchorHeight;
+    return anchor;
 }
 
 void BoxApp::buildConstantBuffer()
@@ -271,16 +492,11 @@ void BoxApp::buildConstantBuffer()
 
 void BoxApp::update(const GameTimer& gt) {
     if ((GetAsyncKeyState(VK_SPACE) & 0x0001) && mLights.size() < MAX_LIGHTS) {
-        XMVECTOR anchorVec = XMLoadFloat3(&mEyePos);
-
-        const float chainLength = 0.9f;
-
-        XMFLOAT3 anchorPosition;
-        XMStoreFloat3(&anchorPosition, anchorVec);
+        const XMFLOAT3 anchorPosition = findLightAnchor();
 
         LightData spotLight;
         spotLight.Type = static_cast<UINT>(LightType::Spot);
-        spotLight.Position = XMFLOAT3(anchorPosition.x, anchorPosition.y - chainLength, anchorPosition.z);
+        spotLight.Position = XMFLOAT3(anchorPosition.x, anchorPosition.y - LIGHT_CHAIN_LENGTH, anchorPosition.z);
         spotLight.Direction = XMFLOAT3(0.0f, -1.0f, 0.0f);
         spotLight.Color = XMFLOAT3(1.0f, 0.92f, 0.78f);
         spotLight.Intensity = 30.0f;
@@ -305,11 +521,10 @@ void BoxApp::update(const GameTimer& gt) {
 
         const float swingAmplitude = XMConvertToRadians(40.0f);
         const float swingFrequency = 1.2f;
-        const float chainLength = 0.9f;
 
         const float swingAngle = swingAmplitude * std::sin(elapsed * swingFrequency + swinging.PhaseOffset);
 
-        XMVECTOR localPosition = XMVectorSet(0.0f, -chainLength, 0.0f, 0.0f);
+        XMVECTOR localPosition = XMVectorSet(0.0f, -LIGHT_CHAIN_LENGTH, 0.0f, 0.0f);
         XMMATRIX rotation = XMMatrixRotationRollPitchYaw(swingAngle, 0.0f, 0.0f);
         XMVECTOR offset = XMVector3TransformNormal(localPosition, rotation);
         XMVECTOR anchorVec = XMLoadFloat3(&swinging.AnchorPosition);
@@ -336,6 +551,36 @@ void BoxApp::update(const GameTimer& gt) {
     if (GetAsyncKeyState('F') & 0x0001) {
         mEnableFrustumCulling = !mEnableFrustumCulling;
     }
+    if (GetAsyncKeyState('O') & 0x0001) {
+        mEnableOcclusionCulling = !mEnableOcclusionCulling;
+    }
+    if (GetAsyncKeyState('M') & 0x0001) {
+        mEnableMeshletCulling = !mEnableMeshletCulling;
+    }
+    if (GetAsyncKeyState('B') & 0x0001) {
+        mEnableFrontToBackOrder = !mEnableFrontToBackOrder;
+    }
+    if (GetAsyncKeyState('C') & 0x0001) {
+        mEnableContributionCulling = !mEnableContributionCulling;
+    }
+    if (GetAsyncKeyState('P') & 0x0001) {
+        mEnablePvsCulling = !mEnablePvsCulling;
+    }
+    if (GetAsyncKeyState('H') & 0x0001) {
+        mEnableHlod = !mEnableHlod;
+    }
+    if (GetAsyncKeyState('Z') & 0x0001) {
+        mEnableDepthPrepass = !mEnableDepthPrepass;
+    }
+    if (GetAsyncKeyState('R') & 0x0001) {
+        mRecordingCameraPath = !mRecordingCameraPath;
+        if (mRecordingCameraPath) {
+            mRecordedCameraPath.clear();
+        }
+        else {
+            saveCameraPath("camera_path.txt", mRecordedCameraPath);
+        }
+    }
 
     float dt = gt.getDeltaTime();
     float speed = SPEED_FACTOR * dt;
@@ -375,6 +620,13 @@ void BoxApp::update(const GameTimer& gt) {
     XMMATRIX view = XMMatrixLookAtLH(pos, target, up);
     XMStoreFloat4x4(&mView, view);
 
+    if (mRecordingCameraPath) {
+        CameraPose pose;
+        pose.position = mEyePos;
+        XMStoreFloat3(&pose.target, target);
+        mRecordedCameraPath.push_back(pose);
+    }
+
     if (mBillboardIndex != static_cast<size_t>(-1)) {
         XMVECTOR camPos = XMLoadFloat3(&mEyePos);
         XMVECTOR billPos = XMLoadFloat3(&mEarthBillboardPosition);
@@ -387,6 +639,18 @@ void BoxApp::update(const GameTimer& gt) {
         XMMATRIX billboardWorld = XMMatrixInverse(nullptr, billboardView);
 
         XMStoreFloat4x4(&mSubmeshWorlds[mBillboardIndex], billboardWorld);
+
+        const BoundingBox billboardLocalBounds(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(BILLBOARD_SIZE, BILLBOARD_SIZE, 0.0f));
+        billboardLocalBounds.Transform(mSubmeshes[mBillboardIndex].bounds, billboardWorld);
+        BoundingSphere billboardLocalSphere;
+        BoundingSphere::CreateFromBoundingBox(billboardLocalSphere, billboardLocalBounds);
+        billboardLocalSphere.Transform(mSubmeshes[mBillboardIndex].sphereBounds, billboardWorld);
+        BoundingOrientedBox billboardLocalBox;
+        BoundingOrientedBox::CreateFromBoundingBox(billboardLocalBox, billboardLocalBounds);
+        billboardLocalBox.Transform(mSubmeshes[mBillboardIndex].orientedBounds, billboardWorld);
+        if (mBillboardIndexHandle != SpatialIndex::INVALID_HANDLE) {
+            mSceneIndex->update(mBillboardIndexHandle, mSubmeshes[mBillboardIndex].bounds);
+        }
     }
 
     XMMATRIX proj = XMLoadFloat4x4(&mProj);
@@ -408,6 +672,8 @@ void BoxApp::update(const GameTimer& gt) {
         objConstants.TextureAnimationEnabled = isColumn && mEnableColumnTextureAnimation ? 1.0f : 0.0f;
         objConstants.DisplacementScale = DISPLACEMENT_SCALE;
         objConstants.MaxTessellationFactor = submesh.maxTessellationFactor;
+        objConstants.PositionOrigin = submesh.positionOrigin;
+        objConstants.PositionExtent = submesh.positionExtent;
 
         mObjectCB->copyData(static_cast<int>(i), objConstants);
     }
@@ -459,6 +725,22 @@ BoxApp::~BoxApp()
     mParticleSimCB = nullptr;
 }
 
+// Right click picks the Sponza triangle under the cursor.
+void BoxApp::onMouseDown(WPARAM btnState, int x, int y) {
+    if ((btnState & MK_RBUTTON) != 0) {
+        const float viewX = (2.0f * static_cast<float>(x) / static_cast<float>(mClientWidth) - 1.0f) / mProj.m[0][0];
+        const float viewY = (1.0f - 2.0f * static_cast<float>(y) / static_cast<float>(mClientHeight)) / mProj.m[1][1];
+        const XMMATRIX invView = XMMatrixInverse(nullptr, XMLoadFloat4x4(&mView));
+
+        Ray ray;
+        ray.origin = mEyePos;
+        XMStoreFloat3(&ray.direction, XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(viewX, viewY, 1.0f, 0.0f), invView)));
+        mSceneTriangles.intersect(ray, mPickedHit);
+    }
+    mLastMousePos.x = x;
+    mLastMousePos.y = y;
+}
+
 void BoxApp::onMouseMove(WPARAM btnState, int x, int y) {
     if ((btnState & MK_LBUTTON) != 0) {
         float dx = XMConvertToRadians(0.15f * static_cast<float>(x - mLastMousePos.x));
@@ -539,21 +821,89 @@ void BoxApp::draw(const GameTimer& gt)
     mRenderingSystem->beginGeometryPass(mCommandList.Get(), getDepthStencilView());
 
     mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
-    mCommandList->IASetVertexBuffers(0, 1, &mVertexBufferView);
-    mCommandList->IASetIndexBuffer(&mIndexBufferView);
+    mCommandList->IASetVertexBuffers(0, _countof(mVertexBufferViews), mVertexBufferViews);
+
+    // Every submesh draws from its 16-bit or 32-bit index pool; only a switch rebinds.
+    const D3D12_INDEX_BUFFER_VIEW* boundIndexBufferView = nullptr;
+    auto bindIndexPool = [&](const D3D12_INDEX_BUFFER_VIEW* views, const Submesh& submesh) {
+        const D3D12_INDEX_BUFFER_VIEW* view = &views[submesh.shortIndices ? 0 : 1];
+        if (view != boundIndexBufferView) {
+            mCommandList->IASetIndexBuffer(view);
+            boundIndexBufferView = view;
+        }
+    };
 
-    std::vector<size_t> visibleSubmeshIndices;
+    // Reused every frame so culling does not allocate once the buffer has grown.
+    std::vector<size_t>& visibleSubmeshIndices = mVisibleSubmeshIndices;
+    visibleSubmeshIndices.clear();
     if (mEnableFrustumCulling) {
-        visibleSubmeshIndices = collectVisibleSubmeshes();
+        collectVisibleSubmeshes(visibleSubmeshIndices, &mCullingStats);
+        mMainWndCaption = L"The App    Nodes: " + std::to_wstring(mCullingStats.nodesVisited) +
+            L"    Plane tests: " + std::to_wstring(mCullingStats.planeTests) +
+            L"    Small: " + std::to_wstring(mCullingStats.entriesContributionCulled) +
+            L"    Tight: " + std::to_wstring(mTightBoundsCulledCount) +
+            L"    PVS: " + std::to_wstring(mPvsCulledCount);
+
+        if (mEnableOcclusionCulling) {
+            XMFLOAT4X4 viewProj;
+            XMStoreFloat4x4(&viewProj, XMLoadFloat4x4(&mView) * XMLoadFloat4x4(&mProj));
+            mOcclusionCuller.render(viewProj, &mThreadPool);
+
+            const size_t frustumVisibleCount = visibleSubmeshIndices.size();
+            visibleSubmeshIndices.erase(std::remove_if(visibleSubmeshIndices.begin(), visibleSubmeshIndices.end(),
+                [this](size_t submeshIndex) { return !mOcclusionCuller.isVisible(mSubmeshes[submeshIndex].bounds); }),
+                visibleSubmeshIndices.end());
+
+            mMainWndCaption += L"    Occluded: " + std::to_wstring(frustumVisibleCount - visibleSubmeshIndices.size());
+        }
     }
     else {
+        mCullingStats = {};
+        mImpostorSubmeshIndices.clear();
         visibleSubmeshIndices.reserve(mSubmeshes.size());
         for (size_t submeshIndex = 0; submeshIndex < mSubmeshes.size(); ++submeshIndex) {
-            visibleSubmeshIndices.push_back(submeshIndex);
+            if (!isHlodProxy(submeshIndex)) {
+                visibleSubmeshIndices.push_back(submeshIndex);
+            }
+        }
+    }
+
+    if (mEnableHlod && !mHlod.empty()) {
+        const float pixelsPerUnit = 0.5f * mViewport.Height * mProj.m[1][1];
+        mHlod.select(mEyePos, mHlod.getSwitchDistance(pixelsPerUnit, HLOD_MAX_PIXEL_ERROR), visibleSubmeshIndices,
+            mHlodProxyStart, mSubmeshes, mHlodSelection);
+        visibleSubmeshIndices.swap(mHlodSelection.submeshIndices);
+        if (mEnableFrustumCulling) {
+            mMainWndCaption += L"    HLOD: " + std::to_wstring(mHlodSelection.clustersReplaced) +
+                L" (" + std::to_wstring(mHlodSelection.drawCallsSaved) + L" draws)";
         }
     }
     const float earthDistance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&mEyePos), XMLoadFloat3(&mEarthPosition))));
-    const bool drawEarthMesh = earthDistance <= EARTH_BILLBOARD_SWITCH_DISTANCE;
+    // The billboard doubles as the impostor of the Earth once it shrinks below the pixel threshold.
+    const bool earthIsImpostor = std::any_of(mImpostorSubmeshIndices.begin(), mImpostorSubmeshIndices.end(),
+        [this](size_t submeshIndex) { return std::binary_search(mEarthSubmeshIndices.begin(), mEarthSubmeshIndices.end(), submeshIndex); });
+    const bool drawEarthMesh = earthDistance <= EARTH_BILLBOARD_SWITCH_DISTANCE && !earthIsImpostor;
+    mMeshletCuller.setView(computeWorldFrustum(), mEyePos);
+
+    if (mEnableDepthPrepass) {
+        // Lays down depth from the position stream alone so the G-buffer pass shades every pixel
+        // once. Anything that clips or moves its vertices in its own shaders is left to that pass.
+        mCommandList->SetPipelineState(mDepthPrepassPSO.Get());
+        mCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        for (size_t submeshIndex : visibleSubmeshIndices) {
+            const auto& submesh = mSubmeshes[submeshIndex];
+            if (submeshIndex == mBillboardIndex || submesh.material.alphaTested ||
+                isColumnSubmesh(submesh) || hasDisplacementTexture(submesh)) {
+                continue;
+            }
+
+            CD3DX12_GPU_DESCRIPTOR_HANDLE cbvHandle(mCbvSrvHeap->GetGPUDescriptorHandleForHeapStart());
+            cbvHandle.Offset(submesh.objectCbvHeapIndex, mCbvSrvDescriptorSize);
+            mCommandList->SetGraphicsRootDescriptorTable(0, cbvHandle);
+            bindIndexPool(mWeldedIndexBufferViews, submesh);
+            mCommandList->DrawIndexedInstanced(submesh.indexCount, 1, submesh.poolStartIndex, static_cast<INT>(submesh.baseVertex), 0);
+        }
+    }
 
     for (size_t submeshIndex : visibleSubmeshIndices) {
         const auto& submesh = mSubmeshes[submeshIndex];
@@ -567,6 +917,17 @@ void BoxApp::draw(const GameTimer& gt)
             continue;
         }
 
+        mMeshletRanges.clear();
+        if (mEnableMeshletCulling && submesh.meshletCount > 0) {
+            mMeshletCuller.cull(mMeshlets, submesh, mMeshletRanges);
+            if (mMeshletRanges.empty()) {
+                continue;
+            }
+        }
+        else {
+            mMeshletRanges.push_back({ submesh.startIndiceIndex, submesh.indexCount });
+        }
+
         const bool isColumn = isColumnSubmesh(submesh);
         const bool useTessellation = !isColumn && hasDisplacementTexture(submesh);
 
@@ -599,7 +960,22 @@ void BoxApp::draw(const GameTimer& gt)
         displacementSrvHandle.Offset(submesh.material.displacementSrvHeapIndex, mCbvSrvDescriptorSize);
         mCommandList->SetGraphicsRootDescriptorTable(4, displacementSrvHandle);
 
-        mCommandList->DrawIndexedInstanced(submesh.indexCount, 1, submesh.startIndiceIndex, 0, 0);
+        // Meshlet ranges index mesh.indices; the pool keeps each submesh's order.
+        bindIndexPool(mIndexBufferViews, submesh);
+        for (const auto& range : mMeshletRanges) {
+            const UINT poolStartIndex = submesh.poolStartIndex + (range.startIndex - submesh.startIndiceIndex);
+            mCommandList->DrawIndexedInstanced(range.indexCount, 1, poolStartIndex, static_cast<INT>(submesh.baseVertex), 0);
+        }
+    }
+
+    if (mEnableFrustumCulling && mEnableMeshletCulling) {
+        const MeshletCuller::Stats& meshletStats = mMeshletCuller.getStats();
+        mMainWndCaption += L"    Triangles: " + std::to_wstring(meshletStats.trianglesDrawn) +
+            L"/" + std::to_wstring(meshletStats.trianglesSubmitted);
+    }
+    if (mEnableFrustumCulling && mPickedHit.isHit()) {
+        mMainWndCaption += L"    Picked: " + std::to_wstring(mPickedHit.submeshIndex) +
+            L"/" + std::to_wstring(mPickedHit.triangleIndex);
     }
 
     mRenderingSystem->endGeometryPass(mCommandList.Get());
@@ -799,11 +1175,12 @@ void BoxApp::buildPso(const std::wstring& shaderName, ComPtr<ID3D12PipelineState
     ComPtr<ID3DBlob> mhsByteCode;
     ComPtr<ID3DBlob> mdsByteCode;
 
-    mvsByteCode = D3DUtil::compileShader(shaderName, nullptr, enableTessellation ? "VS_Tess" : "VS", "vs_5_0");
-    mpsByteCode = D3DUtil::compileShader(shaderName, nullptr, "PS", "ps_5_0");
+    const D3D_SHADER_MACRO* defines = getVertexFormatDefines(mVertexFormat);
+    mvsByteCode = D3DUtil::compileShader(shaderName, defines, enableTessellation ? "VS_Tess" : "VS", "vs_5_0");
+    mpsByteCode = D3DUtil::compileShader(shaderName, defines, "PS", "ps_5_0");
     if (enableTessellation) {
-        mhsByteCode = D3DUtil::compileShader(shaderName, nullptr, "HS", "hs_5_0");
-        mdsByteCode = D3DUtil::compileShader(shaderName, nullptr, "DS", "ds_5_0");
+        mhsByteCode = D3DUtil::compileShader(shaderName, defines, "HS", "hs_5_0");
+        mdsByteCode = D3DUtil::compileShader(shaderName, defines, "DS", "ds_5_0");
     }
 
     D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
@@ -836,6 +1213,8 @@ void BoxApp::buildPso(const std::wstring& shaderName, ComPtr<ID3D12PipelineState
     psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
     psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
     psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+    // Passes the pixels the depth prepass already wrote.
+    psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
     psoDesc.SampleMask = UINT_MAX;
     psoDesc.PrimitiveTopologyType = enableTessellation ? D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH : D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
     if (isLightingPass) {
@@ -859,6 +1238,33 @@ void BoxApp::buildPso(const std::wstring& shaderName, ComPtr<ID3D12PipelineState
     failCheck(md3dDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pso)));
 }
 
+void BoxApp::buildDepthPso() {
+    ComPtr<ID3DBlob> vsByteCode = D3DUtil::compileShader(L"main_shader.hlsl", getVertexFormatDefines(mVertexFormat), "VS_Depth", "vs_5_0");
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+    psoDesc.pRootSignature = mRootSignature.Get();
+    psoDesc.VS = {
+        reinterpret_cast<BYTE*>(vsByteCode->GetBufferPointer()),
+        vsByteCode->GetBufferSize()
+    };
+    psoDesc.InputLayout = { mDepthInputLayout.data(), (UINT)mDepthInputLayout.size() };
+    psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+    // The G-buffer stays bound during the prepass, so the formats match but nothing is written.
+    psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+    for (int i = 0; i < GBuffer::mTexturesNum; ++i) {
+        psoDesc.BlendState.RenderTarget[i].RenderTargetWriteMask = 0;
+        psoDesc.RTVFormats[i] = mRenderingSystem->getGBuffer()->getFormat(i);
+    }
+    psoDesc.NumRenderTargets = GBuffer::mTexturesNum;
+    psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+    psoDesc.DSVFormat = mDepthStencilFormat;
+    psoDesc.SampleMask = UINT_MAX;
+    psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    psoDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
+    psoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
+    failCheck(md3dDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&mDepthPrepassPSO)));
+}
+
 void BoxApp::buildParticlePso() {
     ComPtr<ID3DBlob> vsByteCode = D3DUtil::compileShader(L"particle_shader.hlsl", nullptr, "VS", "vs_5_0");
     ComPtr<ID3DBlob> gsByteCode = D3DUtil::compileShader(L"particle_shader.hlsl", nullptr, "GS", "gs_5_0");
@@ -8,7 +8,15 @@
 #include "model_loader.h"
 #include "texture.h"
 #include "rendering_system.h"
-#include "octree.h"
+#include "spatial_index.h"
+#include "occlusion_culler.h"
+#include "meshlet_culler.h"
+#include "pvs.h"
+#include "hlod.h"
+#include "triangle_bvh.h"
+#include "camera_path.h"
+#include "thread_pool.h"
+#include "vertex_format.h"
 
 #include <DirectXColors.h>
 #include <DirectXMath.h>
@@ -25,7 +33,9 @@ struct ObjectConstants {
     float TextureAnimationEnabled;
     float DisplacementScale;
     float MaxTessellationFactor;
-    XMFLOAT3 Padding = { 0.0f, 0.0f, 0.0f };
+    XMFLOAT3 PositionOrigin = { 0.0f, 0.0f, 0.0f };
+    XMFLOAT3 PositionExtent = { 1.0f, 1.0f, 1.0f };
+    float Padding = 0.0f;
 };
 
 struct PassConstants {
@@ -92,6 +102,9 @@ public:
     void onResize() override;
     ~BoxApp();
     BoxApp(HINSTANCE hInstance) : D3DApp(hInstance) { initializeConstants(); };
+
+    void setSpatialIndexType(SpatialIndexType type) { mSpatialIndexType = type; }
+    void setVertexFormat(VertexFormat format) { mVertexFormat = format; }
 private:
     static constexpr UINT PARTICLE_COUNT = 65536;
     static constexpr UINT PARTICLE_CS_GROUP_SIZE = 256;
@@ -102,6 +115,12 @@ private:
     const float DISPLACEMENT_SCALE = 0.4f;
     const float EARTH_BILLBOARD_SWITCH_DISTANCE = 60.0f;
     const float BILLBOARD_SIZE = 10.0f;
+    const float OCCLUDER_MIN_TRIANGLE_AREA = 0.01f;
+    const float MIN_CONTRIBUTION_PIXELS = 2.0f;
+    const float HLOD_MAX_PIXEL_ERROR = 4.0f;
+    const float LIGHT_CHAIN_LENGTH = 0.9f;
+    const float LIGHT_ANCHOR_MAX_HEIGHT = 12.0f;
+    const float LIGHT_SURFACE_OFFSET = 0.05f;
     const Vector3 TEXTURE_SCALE = Vector3(1.f, 1.f, 1.f);
     void setObjectSize(Vertex& vertex, float scale);
 
@@ -112,6 +131,7 @@ private:
     void buildParticleComputeRootSignature();
     void buildLightingRootSignature();
     void buildPso(const std::wstring& shaderName, ComPtr<ID3D12PipelineState>& pso, bool enableTessellation = false);
+    void buildDepthPso();
     void buildParticlePso();
     void buildParticleResources();
     void buildParticleDescriptors();
@@ -120,8 +140,13 @@ private:
     void loadTextures();
     void buildCbvSrvHeap();
     void bindMaterialsToTextures();
-    void buildOctree();
-    std::vector<size_t> collectVisibleSubmeshes() const;
+    void buildSpatialIndex();
+    BoundingFrustum computeWorldFrustum() const;
+    void collectVisibleSubmeshes(std::vector<size_t>& visibleSubmeshIndices, SpatialIndex::QueryStats* stats = nullptr);
+    size_t removeOutsideTightBounds(const BoundingFrustum& frustum, std::vector<size_t>& submeshIndices) const;
+    size_t removePvsHiddenSubmeshes(std::vector<size_t>& submeshIndices);
+    bool isHlodProxy(size_t submeshIndex) const;
+    XMFLOAT3 findLightAnchor() const;
 
     UINT getPassCbvIndex() const;
     UINT getLightingCbvIndex() const;
@@ -135,16 +160,21 @@ private:
 
     void update(const GameTimer& gt) override;
     void draw(const GameTimer& gt) override;
+    void onMouseDown(WPARAM btnState, int x, int y) override;
     void onMouseMove(WPARAM btnState, int x, int y) override;
 
     void createDefaultTextures();
 
-    ComPtr<ID3D12Resource> mVertexBufferGPU;
-    ComPtr<ID3D12Resource> mVertexBufferUploader;
+    ComPtr<ID3D12Resource> mPositionBufferGPU;
+    ComPtr<ID3D12Resource> mPositionBufferUploader;
+    ComPtr<ID3D12Resource> mAttributeBufferGPU;
+    ComPtr<ID3D12Resource> mAttributeBufferUploader;
 
 
     ComPtr<ID3D12Resource> mIndexBufferGPU;
     ComPtr<ID3D12Resource> mIndexBufferUploader;
+    ComPtr<ID3D12Resource> mWeldedIndexBufferGPU;
+    ComPtr<ID3D12Resource> mWeldedIndexBufferUploader;
 
     UploadBuffer<ObjectConstants>* mObjectCB = nullptr;
     UploadBuffer<PassConstants>* mPassCB = nullptr;
@@ -158,6 +188,7 @@ private:
     ComPtr<ID3D12PipelineState> mPSO;
     ComPtr<ID3D12PipelineState> mEarthTessPSO;
     ComPtr<ID3D12PipelineState> mColumnPSO;
+    ComPtr<ID3D12PipelineState> mDepthPrepassPSO;
     ComPtr<ID3D12PipelineState> mLightingPSO;
     ComPtr<ID3D12PipelineState> mParticlePSO;
     ComPtr<ID3D12PipelineState> mParticleEmitPSO;
@@ -167,6 +198,7 @@ private:
     UINT mCbvSrvDescriptorSize = 0;
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
+    std::vector<D3D12_INPUT_ELEMENT_DESC> mDepthInputLayout;
 
     XMFLOAT4X4 mWorld;
     XMFLOAT4X4 mView;
@@ -184,12 +216,37 @@ private:
 
     UINT mIndexCount = 0;
 
-    D3D12_VERTEX_BUFFER_VIEW mVertexBufferView;
-    D3D12_INDEX_BUFFER_VIEW mIndexBufferView;
+    // Positions in slot 0, the other attributes in slot 1.
+    D3D12_VERTEX_BUFFER_VIEW mVertexBufferViews[2];
+    // The 16-bit index pool, then the 32-bit one.
+    D3D12_INDEX_BUFFER_VIEW mIndexBufferViews[2];
+    D3D12_INDEX_BUFFER_VIEW mWeldedIndexBufferViews[2];
 
     std::vector<Submesh> mSubmeshes;
     std::vector<XMFLOAT4X4> mSubmeshWorlds;
-    Octree mSceneOctree;
+    ThreadPool mThreadPool;
+    SpatialIndexType mSpatialIndexType = SpatialIndexType::Octree;
+    VertexFormat mVertexFormat = VertexFormat::Full;
+    std::unique_ptr<SpatialIndex> mSceneIndex;
+    SpatialIndex::QueryStats mCullingStats;
+    std::vector<size_t> mVisibleSubmeshIndices;
+    std::vector<SpatialIndex::DepthVisibility> mVisibleSubmeshDepths;
+    std::vector<size_t> mImpostorSubmeshIndices;
+    OcclusionCuller mOcclusionCuller;
+    std::vector<Meshlet> mMeshlets;
+    MeshletCuller mMeshletCuller;
+    std::vector<MeshletCuller::IndexRange> mMeshletRanges;
+    PotentiallyVisibleSet mPvs;
+    size_t mPvsCell = PotentiallyVisibleSet::INVALID_CELL;
+    std::vector<uint8_t> mPvsVisibleSet;
+    size_t mPvsCulledCount = 0;
+    size_t mTightBoundsCulledCount = 0;
+    HlodSet mHlod;
+    HlodSet::Selection mHlodSelection;
+    size_t mHlodProxyStart = 0;
+    TriangleBvh mSceneTriangles;
+    TriangleBvh::RayHit mPickedHit;
+    std::vector<CameraPose> mRecordedCameraPath;
     std::vector<LightData> mLights;
     std::vector<SwingingSpotLight> mSwingingSpotLights;
     std::unordered_map<std::wstring, std::unique_ptr<Texture>> mTextures;
@@ -212,6 +269,7 @@ private:
     D3D12_VERTEX_BUFFER_VIEW mParticleIndexBufferView = {};
 
     size_t mBillboardIndex = static_cast<size_t>(-1);
+    SpatialIndex::Handle mBillboardIndexHandle = SpatialIndex::INVALID_HANDLE;
     DirectX::XMFLOAT3 mEarthPosition = { 0.0f, 12.0f, 0.0f };
     DirectX::XMFLOAT3 mEarthBillboardPosition = { 0.0f, 24.0f, 0.0f };
     std::vector<size_t> mEarthSubmeshIndices;
@@ -219,6 +277,14 @@ private:
     bool mEnableColumnVertexAnimation = true;
     bool mEnableColumnTextureAnimation = true;
     bool mEnableFrustumCulling = true;
+    bool mEnableOcclusionCulling = true;
+    bool mEnableMeshletCulling = true;
+    bool mEnableFrontToBackOrder = true;
+    bool mEnableContributionCulling = true;
+    bool mEnablePvsCulling = true;
+    bool mEnableHlod = true;
+    bool mEnableDepthPrepass = false;
+    bool mRecordingCameraPath = false;
 };
 
 #endif // BOX_APP_H
\ No newline at end of file
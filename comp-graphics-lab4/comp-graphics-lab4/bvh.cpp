@@ -0,0 +1,503 @@
+#include "bvh.h"
+#include "frustum_planes.h"
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cfloat>
+
+using namespace DirectX;
+
+namespace {
+    constexpr uint32_t BATCH_WIDTH = FrustumPlanes::BATCH_WIDTH;
+    constexpr size_t MAX_BIN_COUNT = 32;
+    // Cost of visiting a node relative to testing one entry.
+    constexpr float TRAVERSAL_COST = 1.0f;
+
+    struct Aabb {
+        XMFLOAT3 min = { FLT_MAX, FLT_MAX, FLT_MAX };
+        XMFLOAT3 max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+        void grow(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax) {
+            min = { std::min(min.x, boxMin.x), std::min(min.y, boxMin.y), std::min(min.z, boxMin.z) };
+            max = { std::max(max.x, boxMax.x), std::max(max.y, boxMax.y), std::max(max.z, boxMax.z) };
+        }
+
+        void grow(const XMFLOAT3& point) {
+            grow(point, point);
+        }
+
+        void grow(const Aabb& other) {
+            grow(other.min, other.max);
+        }
+
+        void grow(const BoundingBox& box) {
+            grow(XMFLOAT3(box.Center.x - box.Extents.x, box.Center.y - box.Extents.y, box.Center.z - box.Extents.z),
+                XMFLOAT3(box.Center.x + box.Extents.x, box.Center.y + box.Extents.y, box.Center.z + box.Extents.z));
+        }
+
+        float surfaceArea() const {
+            if (min.x > max.x) {
+                return 0.0f;
+            }
+            const float dx = max.x - min.x;
+            const float dy = max.y - min.y;
+            const float dz = max.z - min.z;
+            return 2.0f * (dx * dy + dy * dz + dz * dx);
+        }
+
+        BoundingBox toBox() const {
+            BoundingBox box;
+            BoundingBox::CreateFromPoints(box, XMLoadFloat3(&min), XMLoadFloat3(&max));
+            return box;
+        }
+    };
+
+    float component(const XMFLOAT3& value, int axis) {
+        return axis == 0 ? value.x : (axis == 1 ? value.y : value.z);
+    }
+
+    float centerDistanceSquared(const BoundingBox& bounds, const XMFLOAT3& point) {
+        const float dx = bounds.Center.x - point.x;
+        const float dy = bounds.Center.y - point.y;
+        const float dz = bounds.Center.z - point.z;
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    // Converts through int since float to unsigned 64-bit conversion is slow on x64.
+    size_t getBin(float value, float axisMin, float binScale, size_t binCount) {
+        const int bin = static_cast<int>((value - axisMin) * binScale);
+        return std::min(binCount - 1, static_cast<size_t>(bin));
+    }
+}
+
+Bvh::Bvh(const BuildSettings& settings) : mSettings(settings) {
+    mSettings.maxEntriesPerLeaf = std::max<size_t>(settings.maxEntriesPerLeaf, 1);
+    mSettings.binCount = std::clamp<size_t>(settings.binCount, 2, MAX_BIN_COUNT);
+}
+
+void Bvh::rebuild(const std::vector<Entry>& entries) {
+    mHandles.clear();
+    mFreeHandles.clear();
+    mHandles.reserve(entries.size());
+
+    for (const auto& entry : entries) {
+        HandleRecord record;
+        record.entry = entry;
+        record.live = true;
+        mHandles.push_back(record);
+    }
+
+    rebuildFromHandles();
+}
+
+// Calls visitor(objectIndex, bounds) for every visible entry. The front-to-back walk
+// descends into the child whose center is nearer to the eye first; overflow entries come last.
+template <bool FrontToBack, typename Visitor>
+void Bvh::traverse(const BoundingFrustum& frustum, const XMFLOAT3& eye, Visitor&& visitor, QueryStats& counters) const {
+    const FrustumPlanes planes = FrustumPlanes::fromFrustum(frustum);
+    const auto visit = [&](size_t objectIndex, const BoundingBox& bounds) {
+        visitor(objectIndex, bounds);
+        ++counters.entriesAccepted;
+    };
+
+    std::array<QueryItem, QUERY_STACK_SIZE> stack;
+    size_t stackSize = 0;
+    if (!mNodes.empty()) {
+        stack[stackSize++] = { 0, FrustumPlanes::ALL_PLANES };
+    }
+
+    while (stackSize > 0) {
+        const QueryItem item = stack[--stackSize];
+        const Node& node = mNodes[item.node];
+        uint32_t planeMask = item.planeMask;
+        ++counters.nodesVisited;
+
+        if (planeMask != 0 && !planes.classifyBox(node.bounds, planeMask, node.lastRejectingPlane, counters.planeTests)) {
+            continue;
+        }
+
+        if (!node.isLeaf()) {
+            uint32_t nearChild = node.firstChild;
+            if (FrontToBack && centerDistanceSquared(mNodes[node.firstChild + 1].bounds, eye) <
+                centerDistanceSquared(mNodes[node.firstChild].bounds, eye)) {
+                nearChild = node.firstChild + 1;
+            }
+            stack[stackSize++] = { (2 * node.firstChild + 1) - nearChild, planeMask };
+            stack[stackSize++] = { nearChild, planeMask };
+            continue;
+        }
+
+        const uint32_t entryEnd = node.firstEntry + node.entryCount;
+        if (planeMask == 0) {
+            for (uint32_t slot = node.firstEntry; slot < entryEnd; ++slot) {
+                if (mEntryHandles[slot] != INVALID_HANDLE) {
+                    visit(mEntryObjects[slot], mEntryBounds.get(slot));
+                }
+            }
+            continue;
+        }
+
+        counters.entriesTested += node.entryCount;
+        counters.planeTests += std::bitset<6>(planeMask).count() * node.entryCount;
+
+        for (uint32_t batchStart = node.firstEntry; batchStart < entryEnd; batchStart += BATCH_WIDTH) {
+            uint32_t mask = planes.intersectsBatch(planeMask,
+                &mEntryBounds.centerX[batchStart], &mEntryBounds.centerY[batchStart], &mEntryBounds.centerZ[batchStart],
+                &mEntryBounds.extentX[batchStart], &mEntryBounds.extentY[batchStart], &mEntryBounds.extentZ[batchStart]);
+
+            const uint32_t remaining = entryEnd - batchStart;
+            if (remaining < BATCH_WIDTH) {
+                mask &= (1u << remaining) - 1u;
+            }
+
+            for (uint32_t lane = 0; mask != 0; ++lane, mask >>= 1) {
+                if ((mask & 1u) && mEntryHandles[batchStart + lane] != INVALID_HANDLE) {
+                    visit(mEntryObjects[batchStart + lane], mEntryBounds.get(batchStart + lane));
+                }
+            }
+        }
+    }
+
+    for (Handle handle : mOverflowHandles) {
+        const HandleRecord& record = mHandles[handle];
+        ++counters.entriesTested;
+        counters.planeTests += 6;
+
+        if (planes.intersectsBox(record.entry.bounds, FrustumPlanes::ALL_PLANES)) {
+            visit(record.entry.objectIndex, record.entry.bounds);
+        }
+    }
+}
+
+void Bvh::query(const BoundingFrustum& frustum, std::vector<size_t>& visibleObjects, QueryStats* stats) const {
+    QueryStats counters;
+    traverse<false>(frustum, XMFLOAT3(0.0f, 0.0f, 0.0f),
+        [&visibleObjects](size_t objectIndex, const BoundingBox&) { visibleObjects.push_back(objectIndex); }, counters);
+
+    if (stats) {
+        *stats = counters;
+    }
+}
+
+void Bvh::queryFrontToBack(const BoundingFrustum& frustum, const XMFLOAT3& eye, std::vector<DepthVisibility>& visibleObjects,
+    QueryStats* stats) const {
+    QueryStats counters;
+    traverse<true>(frustum, eye, [&visibleObjects, &eye](size_t objectIndex, const BoundingBox& bounds) {
+        visibleObjects.push_back({ objectIndex, getViewDepth(bounds, eye) });
+    }, counters);
+
+    if (stats) {
+        *stats = counters;
+    }
+}
+
+void Bvh::query(const BoundingFrustum& frustum, const ContributionCulling& contribution, std::vector<size_t>& visibleObjects,
+    std::vector<size_t>* impostorObjects, QueryStats* stats) const {
+    QueryStats counters;
+    traverse<false>(frustum, contribution.eye, [&](size_t objectIndex, const BoundingBox& bounds) {
+        if (passesContribution(contribution, objectIndex, bounds, impostorObjects, counters)) {
+            visibleObjects.push_back(objectIndex);
+        }
+    }, counters);
+
+    if (stats) {
+        *stats = counters;
+    }
+}
+
+void Bvh::queryFrontToBack(const BoundingFrustum& frustum, const ContributionCulling& contribution,
+    std::vector<DepthVisibility>& visibleObjects, std::vector<size_t>* impostorObjects, QueryStats* stats) const {
+    QueryStats counters;
+    traverse<true>(frustum, contribution.eye, [&](size_t objectIndex, const BoundingBox& bounds) {
+        if (passesContribution(contribution, objectIndex, bounds, impostorObjects, counters)) {
+            visibleObjects.push_back({ objectIndex, getViewDepth(bounds, contribution.eye) });
+        }
+    }, counters);
+
+    if (stats) {
+        *stats = counters;
+    }
+}
+
+Bvh::Handle Bvh::insert(const Entry& entry) {
+    Handle handle;
+    if (!mFreeHandles.empty()) {
+        handle = mFreeHandles.back();
+        mFreeHandles.pop_back();
+    }
+    else {
+        handle = static_cast<Handle>(mHandles.size());
+        mHandles.emplace_back();
+    }
+
+    HandleRecord& record = mHandles[handle];
+    record.entry = entry;
+    record.live = true;
+    record.node = OVERFLOW_NODE;
+    record.slot = static_cast<uint32_t>(mOverflowHandles.size());
+    mOverflowHandles.push_back(handle);
+    ++mLiveEntryCount;
+
+    rebuildIfNeeded();
+    return handle;
+}
+
+void Bvh::remove(Handle handle) {
+    if (handle >= mHandles.size() || !mHandles[handle].live) {
+        return;
+    }
+
+    HandleRecord& record = mHandles[handle];
+    if (record.node == OVERFLOW_NODE) {
+        const Handle moved = mOverflowHandles.back();
+        mOverflowHandles[record.slot] = moved;
+        mHandles[moved].slot = record.slot;
+        mOverflowHandles.pop_back();
+    }
+    else {
+        mEntryHandles[record.slot] = INVALID_HANDLE;
+        ++mEmptySlotCount;
+    }
+
+    record.live = false;
+    mFreeHandles.push_back(handle);
+    --mLiveEntryCount;
+
+    rebuildIfNeeded();
+}
+
+void Bvh::update(Handle handle, const BoundingBox& bounds) {
+    if (handle >= mHandles.size() || !mHandles[handle].live) {
+        return;
+    }
+
+    HandleRecord& record = mHandles[handle];
+    record.entry.bounds = bounds;
+    if (record.node == OVERFLOW_NODE) {
+        return;
+    }
+
+    mEntryBounds.set(record.slot, bounds);
+    refit(record.node);
+    ++mRefitCount;
+
+    rebuildIfNeeded();
+}
+
+size_t Bvh::getMemoryUsage() const {
+    return mNodes.capacity() * sizeof(Node) + mEntryBounds.getMemoryUsage() +
+        mEntryObjects.capacity() * sizeof(size_t) + mEntryHandles.capacity() * sizeof(Handle) +
+        mHandles.capacity() * sizeof(HandleRecord) + mFreeHandles.capacity() * sizeof(Handle) +
+        mOverflowHandles.capacity() * sizeof(Handle) + mBuildEntries.capacity() * sizeof(BuildEntry);
+}
+
+void Bvh::rebuildFromHandles() {
+    mNodes.clear();
+    mEntryBounds.clear();
+    mEntryObjects.clear();
+    mEntryHandles.clear();
+    mOverflowHandles.clear();
+    mBuildEntries.clear();
+    mEmptySlotCount = 0;
+    mRefitCount = 0;
+
+    for (Handle handle = 0; handle < mHandles.size(); ++handle) {
+        if (!mHandles[handle].live) {
+            continue;
+        }
+
+        const BoundingBox& bounds = mHandles[handle].entry.bounds;
+        BuildEntry buildEntry;
+        buildEntry.min = XMFLOAT3(bounds.Center.x - bounds.Extents.x, bounds.Center.y - bounds.Extents.y, bounds.Center.z - bounds.Extents.z);
+        buildEntry.max = XMFLOAT3(bounds.Center.x + bounds.Extents.x, bounds.Center.y + bounds.Extents.y, bounds.Center.z + bounds.Extents.z);
+        buildEntry.centroid = bounds.Center;
+        buildEntry.handle = handle;
+        mBuildEntries.push_back(buildEntry);
+    }
+
+    mLiveEntryCount = mBuildEntries.size();
+    if (mBuildEntries.empty()) {
+        return;
+    }
+
+    mNodes.reserve(2 * (mBuildEntries.size() / mSettings.maxEntriesPerLeaf) + 1);
+    mNodes.emplace_back();
+    buildNode(0, 0, mBuildEntries.size(), 0);
+
+    const size_t count = mBuildEntries.size();
+    mEntryObjects.resize(count);
+    mEntryHandles.resize(count);
+    mEntryBounds.resize(count + BATCH_WIDTH);
+
+    for (uint32_t nodeIndex = 0; nodeIndex < mNodes.size(); ++nodeIndex) {
+        const Node& node = mNodes[nodeIndex];
+        if (!node.isLeaf()) {
+            continue;
+        }
+
+        for (uint32_t slot = node.firstEntry; slot < node.firstEntry + node.entryCount; ++slot) {
+            const Handle handle = mBuildEntries[slot].handle;
+            HandleRecord& record = mHandles[handle];
+            record.node = nodeIndex;
+            record.slot = slot;
+
+            mEntryBounds.set(slot, record.entry.bounds);
+            mEntryObjects[slot] = record.entry.objectIndex;
+            mEntryHandles[slot] = handle;
+        }
+    }
+}
+
+// Bins entry centroids along each axis and splits where the surface area heuristic
+// is cheapest. Entries are partitioned in place, so every leaf ends up owning a
+// contiguous range of mBuildEntries that becomes its slot range.
+void Bvh::buildNode(uint32_t nodeIndex, size_t begin, size_t end, size_t depth) {
+    Aabb bounds;
+    Aabb centroidBounds;
+    for (size_t i = begin; i < end; ++i) {
+        const BuildEntry& buildEntry = mBuildEntries[i];
+        bounds.grow(buildEntry.min, buildEntry.max);
+        centroidBounds.grow(buildEntry.centroid);
+    }
+
+    mNodes[nodeIndex].bounds = bounds.toBox();
+    const size_t count = end - begin;
+
+    auto makeLeaf = [&]() {
+        mNodes[nodeIndex].firstEntry = static_cast<uint32_t>(begin);
+        mNodes[nodeIndex].entryCount = static_cast<uint32_t>(count);
+    };
+
+    if (count <= mSettings.maxEntriesPerLeaf || depth >= MAX_DEPTH) {
+        makeLeaf();
+        return;
+    }
+
+    const size_t binCount = mSettings.binCount;
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    size_t bestSplit = 0;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        const float axisMin = component(centroidBounds.min, axis);
+        const float axisExtent = component(centroidBounds.max, axis) - axisMin;
+        if (!(axisExtent > 0.0f)) {
+            continue;
+        }
+
+        std::array<Aabb, MAX_BIN_COUNT> binBounds;
+        std::array<size_t, MAX_BIN_COUNT> binCounts = {};
+        const float binScale = static_cast<float>(binCount) / axisExtent;
+
+        for (size_t i = begin; i < end; ++i) {
+            const BuildEntry& buildEntry = mBuildEntries[i];
+            const size_t bin = getBin(component(buildEntry.centroid, axis), axisMin, binScale, binCount);
+            binBounds[bin].grow(buildEntry.min, buildEntry.max);
+            ++binCounts[bin];
+        }
+
+        std::array<float, MAX_BIN_COUNT> rightAreas = {};
+        std::array<size_t, MAX_BIN_COUNT> rightCounts = {};
+        Aabb right;
+        size_t rightCount = 0;
+        for (size_t bin = binCount - 1; bin > 0; --bin) {
+            right.grow(binBounds[bin]);
+            rightCount += binCounts[bin];
+            rightAreas[bin] = right.surfaceArea();
+            rightCounts[bin] = rightCount;
+        }
+
+        Aabb left;
+        size_t leftCount = 0;
+        for (size_t split = 1; split < binCount; ++split) {
+            left.grow(binBounds[split - 1]);
+            leftCount += binCounts[split - 1];
+            if (leftCount == 0 || rightCounts[split] == 0) {
+                continue;
+            }
+
+            const float cost = left.surfaceArea() * leftCount + rightAreas[split] * rightCounts[split];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    size_t middle = begin + count / 2;
+    if (bestAxis >= 0) {
+        const float leafCost = bounds.surfaceArea() * count;
+        const float splitCost = TRAVERSAL_COST * bounds.surfaceArea() + bestCost;
+        if (splitCost >= leafCost && count <= 2 * mSettings.maxEntriesPerLeaf) {
+            makeLeaf();
+            return;
+        }
+
+        const float axisMin = component(centroidBounds.min, bestAxis);
+        const float binScale = static_cast<float>(binCount) / (component(centroidBounds.max, bestAxis) - axisMin);
+        const auto partitionEnd = std::partition(mBuildEntries.begin() + begin, mBuildEntries.begin() + end, [&](const BuildEntry& buildEntry) {
+            return getBin(component(buildEntry.centroid, bestAxis), axisMin, binScale, binCount) < bestSplit;
+        });
+        middle = static_cast<size_t>(partitionEnd - mBuildEntries.begin());
+    }
+
+    if (middle == begin || middle == end) {
+        middle = begin + count / 2;
+    }
+
+    const uint32_t firstChild = static_cast<uint32_t>(mNodes.size());
+    mNodes[nodeIndex].firstChild = firstChild;
+
+    Node child;
+    child.parent = nodeIndex;
+    mNodes.push_back(child);
+    mNodes.push_back(child);
+
+    buildNode(firstChild, begin, middle, depth + 1);
+    buildNode(firstChild + 1, middle, end, depth + 1);
+}
+
+// Recomputes the leaf bounds from its remaining entries and propagates the change up
+// until an ancestor's bounds stop changing.
+void Bvh::refit(uint32_t nodeIndex) {
+    Aabb leafBounds;
+    const Node& leaf = mNodes[nodeIndex];
+    for (uint32_t slot = leaf.firstEntry; slot < leaf.firstEntry + leaf.entryCount; ++slot) {
+        if (mEntryHandles[slot] != INVALID_HANDLE) {
+            leafBounds.grow(mHandles[mEntryHandles[slot]].entry.bounds);
+        }
+    }
+
+    if (leafBounds.min.x > leafBounds.max.x) {
+        return;
+    }
+    mNodes[nodeIndex].bounds = leafBounds.toBox();
+
+    while (nodeIndex != 0) {
+        nodeIndex = mNodes[nodeIndex].parent;
+        Node& node = mNodes[nodeIndex];
+
+        Aabb merged;
+        merged.grow(mNodes[node.firstChild].bounds);
+        merged.grow(mNodes[node.firstChild + 1].bounds);
+        const BoundingBox refitted = merged.toBox();
+
+        if (refitted.Center.x == node.bounds.Center.x && refitted.Center.y == node.bounds.Center.y &&
+            refitted.Center.z == node.bounds.Center.z && refitted.Extents.x == node.bounds.Extents.x &&
+            refitted.Extents.y == node.bounds.Extents.y && refitted.Extents.z == node.bounds.Extents.z) {
+            return;
+        }
+        node.bounds = refitted;
+    }
+}
+
+void Bvh::rebuildIfNeeded() {
+    const size_t budget = std::max(MIN_REBUILD_CHANGES, mLiveEntryCount / 4);
+
+    if (mOverflowHandles.size() > budget || mEmptySlotCount > budget || mRefitCount > std::max(MIN_REBUILD_CHANGES, mLiveEntryCount)) {
+        rebuildFromHandles();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "frustum_planes.h"
+#include "packed_bounds.h"
+#include "spatial_index.h"
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <vector>
+
+// Bounding volume hierarchy built top-down with the binned surface area heuristic.
+// Inserted entries wait in an overflow list and moved entries refit their ancestors
+// until enough changes accumulate to justify a rebuild.
+class Bvh : public SpatialIndex {
+public:
+    struct BuildSettings {
+        size_t maxEntriesPerLeaf = 8;
+        size_t binCount = 16;
+    };
+
+    static constexpr size_t MAX_DEPTH = 48;
+
+    Bvh() = default;
+    explicit Bvh(const BuildSettings& settings);
+
+    void rebuild(const std::vector<Entry>& entries) override;
+    using SpatialIndex::query;
+    void query(const DirectX::BoundingFrustum& frustum, std::vector<size_t>& visibleObjects,
+        QueryStats* stats = nullptr) const override;
+    void queryFrontToBack(const DirectX::BoundingFrustum& frustum, const DirectX::XMFLOAT3& eye,
+        std::vector<DepthVisibility>& visibleObjects, QueryStats* stats = nullptr) const override;
+    void query(const DirectX::BoundingFrustum& frustum, const ContributionCulling& contribution,
+        std::vector<size_t>& visibleObjects, std::vector<size_t>* impostorObjects, QueryStats* stats = nullptr) const override;
+    void queryFrontToBack(const DirectX::BoundingFrustum& frustum, const ContributionCulling& contribution,
+        std::vector<DepthVisibility>& visibleObjects, std::vector<size_t>* impostorObjects, QueryStats* stats = nullptr) const override;
+
+    Handle insert(const Entry& entry) override;
+    void remove(Handle handle) override;
+    void update(Handle handle, const DirectX::BoundingBox& bounds) override;
+
+    size_t getNodeCount() const { return mNodes.size(); }
+    size_t getEntryCount() const override { return mLiveEntryCount; }
+    size_t getMemoryUsage() const override;
+
+private:
+    // The children of an internal node are stored at firstChild and firstChild + 1; the
+    // root is never a child, so firstChild == 0 marks a leaf. A leaf owns the entry slots
+    // [firstEntry, firstEntry + entryCount); removed entries leave their slot empty.
+    struct Node {
+        DirectX::BoundingBox bounds = {};
+        uint32_t parent = 0;
+        uint32_t firstChild = 0;
+        uint32_t firstEntry = 0;
+        uint32_t entryCount = 0;
+        RejectingPlaneHint lastRejectingPlane;
+
+        bool isLeaf() const { return firstChild == 0; }
+    };
+
+    struct HandleRecord {
+        Entry entry = {};
+        uint32_t node = 0;
+        uint32_t slot = 0;
+        bool live = false;
+    };
+
+    // Build-time copy of an entry's bounds so the binning passes stream through memory.
+    struct BuildEntry {
+        DirectX::XMFLOAT3 min = {};
+        DirectX::XMFLOAT3 max = {};
+        DirectX::XMFLOAT3 centroid = {};
+        Handle handle = 0;
+    };
+
+    struct QueryItem {
+        uint32_t node = 0;
+        uint32_t planeMask = 0;
+    };
+
+    static constexpr uint32_t OVERFLOW_NODE = ~0u;
+    static constexpr size_t QUERY_STACK_SIZE = MAX_DEPTH + 2;
+    static constexpr size_t MIN_REBUILD_CHANGES = 64;
+
+    BuildSettings mSettings;
+    std::vector<Node> mNodes;
+    PackedBounds mEntryBounds;
+    std::vector<size_t> mEntryObjects;
+    std::vector<Handle> mEntryHandles;
+    std::vector<HandleRecord> mHandles;
+    std::vector<Handle> mFreeHandles;
+    std::vector<Handle> mOverflowHandles;
+    std::vector<BuildEntry> mBuildEntries;
+    size_t mLiveEntryCount = 0;
+    size_t mEmptySlotCount = 0;
+    size_t mRefitCount = 0;
+
+    template <bool FrontToBack, typename Visitor>
+    void traverse(const DirectX::BoundingFrustum& frustum, const DirectX::XMFLOAT3& eye, Visitor&& visitor,
+        QueryStats& counters) const;
+    void rebuildFromHandles();
+    void buildNode(uint32_t nodeIndex, size_t begin, size_t end, size_t depth);
+    void refit(uint32_t nodeIndex);
+    void rebuildIfNeeded();
+};
+
+#endif // BVH_H
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "camera_path.h"
+
+#include <cmath>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace {
+    XMMATRIX createViewMatrix(const CameraPose& pose) {
+        return XMMatrixLookAtLH(XMLoadFloat3(&pose.position), XMLoadFloat3(&pose.target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    }
+}
+
+std::vector<CameraPose> createOrbitCameraPath(const BoundingBox& sceneBounds, size_t poseCount) {
+    std::vector<CameraPose> path;
+    path.reserve(poseCount);
+
+    const XMFLOAT3& center = sceneBounds.Center;
+    const XMFLOAT3& extents = sceneBounds.Extents;
+    for (size_t i = 0; i < poseCount; ++i) {
+        const float angle = XM_2PI * static_cast<float>(i) / static_cast<float>(poseCount);
+
+        CameraPose pose;
+        pose.position = XMFLOAT3(
+            center.x + 0.5f * extents.x * std::cos(angle),
+            center.y + 0.25f * extents.y * std::sin(2.0f * angle),
+            center.z + 0.5f * extents.z * std::sin(angle));
+        pose.target = XMFLOAT3(
+            center.x - 0.5f * extents.x * std::sin(angle),
+            center.y,
+            center.z + 0.5f * extents.z * std::cos(angle));
+        path.push_back(pose);
+    }
+
+    return path;
+}
+
+bool loadCameraPath(const std::string& fileName, std::vector<CameraPose>& path) {
+    std::ifstream in(fileName);
+    if (!in) {
+        return false;
+    }
+
+    path.clear();
+    CameraPose pose;
+    while (in >> pose.position.x >> pose.position.y >> pose.position.z >> pose.target.x >> pose.target.y >> pose.target.z) {
+        path.push_back(pose);
+    }
+
+    return in.eof() && !path.empty();
+}
+
+bool saveCameraPath(const std::string& fileName, const std::vector<CameraPose>& path) {
+    std::ofstream out(fileName);
+    // Nine significant digits round-trip a float exactly.
+    out.precision(9);
+    for (const auto& pose : path) {
+        out << pose.position.x << ' ' << pose.position.y << ' ' << pose.position.z << ' ' <<
+            pose.target.x << ' ' << pose.target.y << ' ' << pose.target.z << '\n';
+    }
+
+    return static_cast<bool>(out);
+}
+
+BoundingFrustum createCameraFrustum(const CameraPose& pose, float fovY, float aspectRatio, float nearZ, float farZ) {
+    BoundingFrustum viewSpaceFrustum;
+    BoundingFrustum::CreateFromMatrix(viewSpaceFrustum, XMMatrixPerspectiveFovLH(fovY, aspectRatio, nearZ, farZ));
+
+    BoundingFrustum worldFrustum;
+    viewSpaceFrustum.Transform(worldFrustum, XMMatrixInverse(nullptr, createViewMatrix(pose)));
+    return worldFrustum;
+}
+
+XMFLOAT4X4 createCameraViewProj(const CameraPose& pose, float fovY, float aspectRatio, float nearZ, float farZ) {
+    XMFLOAT4X4 viewProj;
+    XMStoreFloat4x4(&viewProj, createViewMatrix(pose) * XMMatrixPerspectiveFovLH(fovY, aspectRatio, nearZ, farZ));
+    return viewProj;
+}
\ No newline at end of file
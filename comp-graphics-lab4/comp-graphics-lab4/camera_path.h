@@ -0,0 +1,28 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <string>
+#include <vector>
+
+struct CameraPose {
+    DirectX::XMFLOAT3 position = { 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT3 target = { 0.0f, 0.0f, 1.0f };
+};
+
+// Scripted path for the headless benchmarks: the camera orbits the scene center at half the
+// scene extent and looks across the scene, bobbing up and down twice per lap.
+std::vector<CameraPose> createOrbitCameraPath(const DirectX::BoundingBox& sceneBounds, size_t poseCount);
+
+// Paths are stored as text, one pose per line: position x y z followed by target x y z.
+bool loadCameraPath(const std::string& fileName, std::vector<CameraPose>& path);
+bool saveCameraPath(const std::string& fileName, const std::vector<CameraPose>& path);
+
+// World-space frustum of a left-handed perspective camera at the pose.
+DirectX::BoundingFrustum createCameraFrustum(const CameraPose& pose, float fovY, float aspectRatio, float nearZ, float farZ);
+// View times projection of the same camera, as the renderer multiplies them.
+DirectX::XMFLOAT4X4 createCameraViewProj(const CameraPose& pose, float fovY, float aspectRatio, float nearZ, float farZ);
+
+#endif // CAMERA_PATH_H
\ No newline at end of file
@@ -8,21 +8,16 @@ cbuffer cbPerObject : register(b0)
     float gTextureAnimationEnabled;
     float gDisplacementScale;
     float gMaxTessellationFactor;
-    float3 gPadding;
+    float3 gPositionOrigin;
+    float3 gPositionExtent;
+    float gPadding;
 };
 
 Texture2D gDiffuseMap : register(t0);
 Texture2D gNormalMap : register(t1);
 SamplerState gSampler : register(s0);
 
-struct VertexIn
-{
-    float3 PosL : POSITION;
-    float3 NormalL : NORMAL;
-    float3 TangentL : TANGENT;
-    float3 BitangentL : BINORMAL;
-    float2 TexC : TEXCOORD;
-};
+#include "vertex_input.hlsli"
 
 struct VertexOut
 {
@@ -40,9 +35,10 @@ struct GBufferOut
     float Depth : SV_Target2;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut VS(VertexIn input)
 {
     VertexOut vout;
+    VertexAttributes vin = decodeVertex(input);
 
     float speed = 4.f;
     float frequency = .5f;
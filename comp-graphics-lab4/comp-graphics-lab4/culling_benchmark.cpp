@@ -0,0 +1,156 @@
+#include "culling_benchmark.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+
+using namespace DirectX;
+
+namespace {
+    constexpr SpatialIndexType BACKENDS[] = {
+        SpatialIndexType::Octree, SpatialIndexType::LooseOctree, SpatialIndexType::Bvh, SpatialIndexType::Grid };
+    constexpr size_t QUERY_REPEAT_COUNT = 8;
+    // Matches the projection BoxApp::onResize builds.
+    constexpr float FOV_Y = 0.25f * XM_PI;
+    constexpr float ASPECT_RATIO = 16.0f / 9.0f;
+    constexpr float NEAR_Z = 1.0f;
+    constexpr float FAR_Z = 1000.0f;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct BackendResult {
+        double buildMilliseconds = 0.0;
+        double nanosecondsPerQuery = 0.0;
+        double maxNanosecondsPerQuery = 0.0;
+        SpatialIndex::QueryStats totals;
+        size_t falsePositives = 0;
+        size_t falseNegatives = 0;
+        size_t memoryBytes = 0;
+    };
+
+    BackendResult benchmarkBackend(SpatialIndexType type, const std::vector<SpatialIndex::Entry>& entries,
+        const std::vector<BoundingFrustum>& frustums, const std::vector<std::vector<char>>& exactVisibility, ThreadPool* threadPool) {
+        BackendResult result;
+        std::unique_ptr<SpatialIndex> index = SpatialIndex::create(type, threadPool);
+
+        Clock::time_point start = Clock::now();
+        index->rebuild(entries);
+        result.buildMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        result.memoryBytes = index->getMemoryUsage();
+
+        double totalNanoseconds = 0.0;
+        for (size_t pose = 0; pose < frustums.size(); ++pose) {
+            start = Clock::now();
+            for (size_t repeat = 0; repeat < QUERY_REPEAT_COUNT; ++repeat) {
+                index->query(frustums[pose]);
+            }
+            const double poseNanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / QUERY_REPEAT_COUNT;
+            totalNanoseconds += poseNanoseconds;
+            result.maxNanosecondsPerQuery = std::max(result.maxNanosecondsPerQuery, poseNanoseconds);
+
+            SpatialIndex::QueryStats stats;
+            const std::vector<size_t> visible = index->query(frustums[pose], &stats);
+            result.totals.nodesVisited += stats.nodesVisited;
+            result.totals.planeTests += stats.planeTests;
+            result.totals.entriesTested += stats.entriesTested;
+            result.totals.entriesAccepted += stats.entriesAccepted;
+
+            std::vector<char> accepted(entries.size(), 0);
+            for (size_t objectIndex : visible) {
+                accepted[objectIndex] = 1;
+            }
+            for (size_t i = 0; i < entries.size(); ++i) {
+                result.falsePositives += accepted[i] && !exactVisibility[pose][i];
+                result.falseNegatives += !accepted[i] && exactVisibility[pose][i];
+            }
+        }
+
+        result.nanosecondsPerQuery = frustums.empty() ? 0.0 : totalNanoseconds / frustums.size();
+        return result;
+    }
+}
+
+size_t runCullingBenchmark(const std::vector<SpatialIndex::Entry>& entries, const std::vector<CameraPose>& path,
+    std::ostream& out, ThreadPool* threadPool) {
+    // Object indices double as positions in the per-pose visibility arrays.
+    std::vector<SpatialIndex::Entry> indexedEntries(entries);
+    for (size_t i = 0; i < indexedEntries.size(); ++i) {
+        indexedEntries[i].objectIndex = i;
+    }
+
+    std::vector<BoundingFrustum> frustums;
+    std::vector<std::vector<char>> exactVisibility;
+    size_t exactVisibleCount = 0;
+    for (const auto& pose : path) {
+        frustums.push_back(createCameraFrustum(pose, FOV_Y, ASPECT_RATIO, NEAR_Z, FAR_Z));
+
+        std::vector<char> visible(indexedEntries.size(), 0);
+        for (size_t i = 0; i < indexedEntries.size(); ++i) {
+            visible[i] = frustums.back().Intersects(indexedEntries[i].bounds) ? 1 : 0;
+            exactVisibleCount += visible[i];
+        }
+        exactVisibility.push_back(std::move(visible));
+    }
+
+    const double poseCount = std::max<double>(static_cast<double>(path.size()), 1.0);
+    out << "{\n";
+    out << "  \"entries\": " << indexedEntries.size() << ",\n";
+    out << "  \"poses\": " << path.size() << ",\n";
+    out << "  \"exact_visible_per_query\": " << exactVisibleCount / poseCount << ",\n";
+    out << "  \"backends\": [\n";
+
+    size_t falseNegatives = 0;
+
+    for (size_t backend = 0; backend < std::size(BACKENDS); ++backend) {
+        const BackendResult result = benchmarkBackend(BACKENDS[backend], indexedEntries, frustums, exactVisibility, threadPool);
+        falseNegatives += result.falseNegatives;
+
+        out << "    {\n";
+        out << "      \"name\": \"" << SpatialIndex::getTypeName(BACKENDS[backend]) << "\",\n";
+        out << "      \"build_ms\": " << result.buildMilliseconds << ",\n";
+        out << "      \"memory_bytes\": " << result.memoryBytes << ",\n";
+        out << "      \"ns_per_query\": " << result.nanosecondsPerQuery << ",\n";
+        out << "      \"max_ns_per_query\": " << result.maxNanosecondsPerQuery << ",\n";
+        out << "      \"nodes_visited_per_query\": " << result.totals.nodesVisited / poseCount << ",\n";
+        out << "      \"plane_tests_per_query\": " << result.totals.planeTests / poseCount << ",\n";
+        out << "      \"entries_tested_per_query\": " << result.totals.entriesTested / poseCount << ",\n";
+        out << "      \"entries_accepted_per_query\": " << result.totals.entriesAccepted / poseCount << ",\n";
+        out << "      \"false_positives_per_query\": " << result.falsePositives / poseCount << ",\n";
+        out << "      \"false_negatives\": " << result.falseNegatives << "\n";
+        out << "    }" << (backend + 1 < std::size(BACKENDS) ? "," : "") << "\n";
+    }
+
+    out << "  ]\n";
+    out << "}\n";
+    return falseNegatives;
+}
+
+bool loadCullingEntries(const std::string& fileName, std::vector<SpatialIndex::Entry>& entries) {
+    std::ifstream in(fileName);
+    if (!in) {
+        return false;
+    }
+
+    entries.clear();
+    SpatialIndex::Entry entry;
+    while (in >> entry.bounds.Center.x >> entry.bounds.Center.y >> entry.bounds.Center.z >>
+        entry.bounds.Extents.x >> entry.bounds.Extents.y >> entry.bounds.Extents.z) {
+        entry.objectIndex = entries.size();
+        entries.push_back(entry);
+    }
+
+    return in.eof() && !entries.empty();
+}
+
+bool saveCullingEntries(const std::string& fileName, const std::vector<SpatialIndex::Entry>& entries) {
+    std::ofstream out(fileName);
+    // Nine significant digits round-trip a float exactly.
+    out.precision(9);
+    for (const auto& entry : entries) {
+        out << entry.bounds.Center.x << ' ' << entry.bounds.Center.y << ' ' << entry.bounds.Center.z << ' ' <<
+            entry.bounds.Extents.x << ' ' << entry.bounds.Extents.y << ' ' << entry.bounds.Extents.z << '\n';
+    }
+    return static_cast<bool>(out);
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef CULLING_BENCHMARK_H
+#define CULLING_BENCHMARK_H
+
+#include "camera_path.h"
+#include "spatial_index.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Replays the camera path through SpatialIndex::query on every backend and writes JSON with
+// the build time, query time and traversal statistics. Query results are compared with an
+// exact BoundingFrustum::Intersects test of every entry, so false positives from the
+// conservative plane tests are reported as well. Returns the false negatives summed over all
+// backends, which must be zero.
+size_t runCullingBenchmark(const std::vector<SpatialIndex::Entry>& entries, const std::vector<CameraPose>& path,
+    std::ostream& out, ThreadPool* threadPool = nullptr);
+
+// Entries are stored as text, one box per line: center x y z followed by extents x y z.
+// Object indices follow the line order.
+bool loadCullingEntries(const std::string& fileName, std::vector<SpatialIndex::Entry>& entries);
+bool saveCullingEntries(const std::string& fileName, const std::vector<SpatialIndex::Entry>& entries);
+
+#endif // CULLING_BENCHMARK_H
\ No newline at end of file
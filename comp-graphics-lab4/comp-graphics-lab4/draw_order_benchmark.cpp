@@ -0,0 +1,116 @@
+#include "draw_order_benchmark.h"
+#include "camera_path.h"
+#include "mesh_data.h"
+#include "overdraw_estimator.h"
+#include "spatial_index_benchmark.h"
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
+using namespace DirectX;
+
+namespace {
+    constexpr size_t CAMERA_VIEW_COUNT = 32;
+    constexpr SpatialIndexType BACKENDS[] = {
+        SpatialIndexType::Octree, SpatialIndexType::LooseOctree, SpatialIndexType::Bvh, SpatialIndexType::Grid };
+    // Matches the projection BoxApp::onResize builds.
+    constexpr float FOV_Y = 0.25f * XM_PI;
+    constexpr float ASPECT_RATIO = 16.0f / 9.0f;
+    constexpr float NEAR_Z = 1.0f;
+    constexpr float FAR_Z = 1000.0f;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct OrderResult {
+        OverdrawEstimator::Stats overdraw;
+        double queryMicroseconds = 0.0;
+    };
+
+    double elapsedMicroseconds(Clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    void drawInOrder(OverdrawEstimator& estimator, const MeshData& mesh, const XMFLOAT4X4& viewProj,
+        const std::vector<size_t>& submeshIndices, OrderResult& result) {
+        estimator.begin(viewProj);
+        for (size_t submeshIndex : submeshIndices) {
+            estimator.drawSubmesh(mesh, mesh.submeshes[submeshIndex]);
+        }
+
+        const OverdrawEstimator::Stats stats = estimator.getStats();
+        result.overdraw.pixelsShaded += stats.pixelsShaded;
+        result.overdraw.pixelsCovered += stats.pixelsCovered;
+    }
+}
+
+void runDrawOrderBenchmark(const MeshData& mesh, std::ostream& out, ThreadPool* threadPool) {
+    const std::vector<SpatialIndex::Entry> entries = createSubmeshEntries(mesh);
+    if (entries.empty()) {
+        return;
+    }
+
+    BoundingBox sceneBounds = entries.front().bounds;
+    for (const auto& entry : entries) {
+        BoundingBox::CreateMerged(sceneBounds, sceneBounds, entry.bounds);
+    }
+    const std::vector<CameraPose> path = createOrbitCameraPath(sceneBounds, CAMERA_VIEW_COUNT);
+    const XMMATRIX proj = XMMatrixPerspectiveFovLH(FOV_Y, ASPECT_RATIO, NEAR_Z, FAR_Z);
+
+    OverdrawEstimator estimator;
+    out << std::left << std::setw(14) << "backend" << std::right << std::setw(14) << "query order" <<
+        std::setw(14) << "front-back" << std::setw(14) << "sorted" << std::setw(12) << "query us" <<
+        std::setw(12) << "f2b us" << "\n";
+
+    for (SpatialIndexType type : BACKENDS) {
+        std::unique_ptr<SpatialIndex> index = SpatialIndex::create(type, threadPool);
+        index->rebuild(entries);
+
+        OrderResult queryOrder;
+        OrderResult frontToBack;
+        OrderResult sorted;
+        std::vector<size_t> visibleObjects;
+        std::vector<SpatialIndex::DepthVisibility> visibleDepths;
+        std::vector<size_t> drawOrder;
+        const auto depthOrder = [&]() -> const std::vector<size_t>& {
+            drawOrder.clear();
+            for (const auto& visible : visibleDepths) {
+                drawOrder.push_back(visible.objectIndex);
+            }
+            return drawOrder;
+        };
+
+        for (const auto& pose : path) {
+            const BoundingFrustum frustum = createCameraFrustum(pose, FOV_Y, ASPECT_RATIO, NEAR_Z, FAR_Z);
+            const XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&pose.position), XMLoadFloat3(&pose.target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+            XMFLOAT4X4 viewProj;
+            XMStoreFloat4x4(&viewProj, view * proj);
+
+            visibleObjects.clear();
+            Clock::time_point start = Clock::now();
+            index->query(frustum, visibleObjects);
+            queryOrder.queryMicroseconds += elapsedMicroseconds(start);
+
+            visibleDepths.clear();
+            start = Clock::now();
+            index->queryFrontToBack(frustum, pose.position, visibleDepths);
+            frontToBack.queryMicroseconds += elapsedMicroseconds(start);
+
+            drawInOrder(estimator, mesh, viewProj, visibleObjects, queryOrder);
+            drawInOrder(estimator, mesh, viewProj, depthOrder(), frontToBack);
+
+            std::stable_sort(visibleDepths.begin(), visibleDepths.end(),
+                [](const SpatialIndex::DepthVisibility& a, const SpatialIndex::DepthVisibility& b) { return a.viewDepth < b.viewDepth; });
+            drawInOrder(estimator, mesh, viewProj, depthOrder(), sorted);
+        }
+
+        const double poseCount = static_cast<double>(path.size());
+        out << std::left << std::setw(14) << SpatialIndex::getTypeName(type) << std::right << std::fixed <<
+            std::setprecision(3) << std::setw(14) << queryOrder.overdraw.getOverdraw() <<
+            std::setw(14) << frontToBack.overdraw.getOverdraw() <<
+            std::setw(14) << sorted.overdraw.getOverdraw() <<
+            std::setprecision(1) << std::setw(12) << queryOrder.queryMicroseconds / poseCount <<
+            std::setw(12) << frontToBack.queryMicroseconds / poseCount << "\n";
+    }
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#ifndef DRAW_ORDER_BENCHMARK_H
+#define DRAW_ORDER_BENCHMARK_H
+
+#include <ostream>
+
+struct MeshData;
+class ThreadPool;
+
+// Culls the scene along an orbiting camera path and rasterizes the visible submeshes with
+// OverdrawEstimator in three orders: as the query returns them, in the order of
+// queryFrontToBack, and fully sorted by view depth. Reports overdraw and query time per
+// backend.
+void runDrawOrderBenchmark(const MeshData& mesh, std::ostream& out, ThreadPool* threadPool = nullptr);
+
+#endif // DRAW_ORDER_BENCHMARK_H
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "frustum_planes.h"
+
+#include <cmath>
+
+using namespace DirectX;
+
+FrustumPlanes FrustumPlanes::fromFrustum(const BoundingFrustum& frustum) {
+    XMVECTOR planes[6];
+    frustum.GetPlanes(&planes[0], &planes[1], &planes[2], &planes[3], &planes[4], &planes[5]);
+
+    FrustumPlanes result;
+    for (size_t i = 0; i < 6; ++i) {
+        XMFLOAT4 plane;
+        XMStoreFloat4(&plane, planes[i]);
+        result.nx[i] = plane.x;
+        result.ny[i] = plane.y;
+        result.nz[i] = plane.z;
+        result.d[i] = plane.w;
+    }
+
+    return result;
+}
+
+bool FrustumPlanes::isOutsidePlane(size_t plane, const BoundingBox& box, bool& inside) const {
+    const float distance = nx[plane] * box.Center.x + ny[plane] * box.Center.y + nz[plane] * box.Center.z + d[plane];
+    const float radius = std::fabs(nx[plane]) * box.Extents.x + std::fabs(ny[plane]) * box.Extents.y + std::fabs(nz[plane]) * box.Extents.z;
+    inside = distance < -radius;
+    return distance > radius;
+}
+
+bool FrustumPlanes::intersectsBox(const BoundingBox& box, uint32_t planeMask) const {
+    for (size_t plane = 0; plane < 6; ++plane) {
+        bool inside = false;
+        if ((planeMask & (1u << plane)) != 0 && isOutsidePlane(plane, box, inside)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool FrustumPlanes::intersectsSphere(const BoundingSphere& sphere) const {
+    for (size_t plane = 0; plane < 6; ++plane) {
+        const float distance = nx[plane] * sphere.Center.x + ny[plane] * sphere.Center.y + nz[plane] * sphere.Center.z + d[plane];
+        if (distance > sphere.Radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool FrustumPlanes::classifyBox(const BoundingBox& box, uint32_t& planeMask, uint8_t& rejectingPlane, size_t& planeTests) const {
+    const size_t firstPlane = rejectingPlane;
+
+    for (size_t i = 0; i < 6; ++i) {
+        const size_t plane = (firstPlane + i) % 6;
+        if ((planeMask & (1u << plane)) == 0) {
+            continue;
+        }
+
+        ++planeTests;
+        bool inside = false;
+        if (isOutsidePlane(plane, box, inside)) {
+            rejectingPlane = static_cast<uint8_t>(plane);
+            return false;
+        }
+
+        if (inside) {
+            planeMask &= ~(1u << plane);
+        }
+    }
+
+    return true;
+}
+
+bool FrustumPlanes::classifyBox(const BoundingBox& box, uint32_t& planeMask, const RejectingPlaneHint& hint, size_t& planeTests) const {
+    const uint8_t hintedPlane = hint.get();
+    uint8_t rejectingPlane = hintedPlane;
+    const bool intersects = classifyBox(box, planeMask, rejectingPlane, planeTests);
+    if (rejectingPlane != hintedPlane) {
+        hint.set(rejectingPlane);
+    }
+    return intersects;
+}
+
+uint32_t FrustumPlanes::intersectsBatch(uint32_t planeMask, const float* cx, const float* cy, const float* cz,
+    const float* ex, const float* ey, const float* ez) const {
+#if defined(_XM_AVX_INTRINSICS_)
+    const __m256 centerX = _mm256_loadu_ps(cx);
+    const __m256 centerY = _mm256_loadu_ps(cy);
+    const __m256 centerZ = _mm256_loadu_ps(cz);
+    const __m256 extentX = _mm256_loadu_ps(ex);
+    const __m256 extentY = _mm256_loadu_ps(ey);
+    const __m256 extentZ = _mm256_loadu_ps(ez);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+    __m256 outside = _mm256_setzero_ps();
+    for (size_t i = 0; i < 6; ++i) {
+        if ((planeMask & (1u << i)) == 0) {
+            continue;
+        }
+
+        const __m256 planeX = _mm256_set1_ps(nx[i]);
+        const __m256 planeY = _mm256_set1_ps(ny[i]);
+        const __m256 planeZ = _mm256_set1_ps(nz[i]);
+
+        __m256 distance = _mm256_add_ps(_mm256_mul_ps(planeX, centerX), _mm256_set1_ps(d[i]));
+        distance = _mm256_add_ps(_mm256_mul_ps(planeY, centerY), distance);
+        distance = _mm256_add_ps(_mm256_mul_ps(planeZ, centerZ), distance);
+
+        __m256 radius = _mm256_mul_ps(_mm256_andnot_ps(signMask, planeX), extentX);
+        radius = _mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, planeY), extentY), radius);
+        radius = _mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, planeZ), extentZ), radius);
+
+        outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, radius, _CMP_GT_OQ));
+    }
+
+    return static_cast<uint32_t>(~_mm256_movemask_ps(outside)) & 0xFFu;
+#elif defined(_XM_SSE_INTRINSICS_)
+    const __m128 centerX = _mm_loadu_ps(cx);
+    const __m128 centerY = _mm_loadu_ps(cy);
+    const __m128 centerZ = _mm_loadu_ps(cz);
+    const __m128 extentX = _mm_loadu_ps(ex);
+    const __m128 extentY = _mm_loadu_ps(ey);
+    const __m128 extentZ = _mm_loadu_ps(ez);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    __m128 outside = _mm_setzero_ps();
+    for (size_t i = 0; i < 6; ++i) {
+        if ((planeMask & (1u << i)) == 0) {
+            continue;
+        }
+
+        const __m128 planeX = _mm_set1_ps(nx[i]);
+        const __m128 planeY = _mm_set1_ps(ny[i]);
+        const __m128 planeZ = _mm_set1_ps(nz[i]);
+
+        __m128 distance = _mm_add_ps(_mm_mul_ps(planeX, centerX), _mm_set1_ps(d[i]));
+        distance = _mm_add_ps(_mm_mul_ps(planeY, centerY), distance);
+        distance = _mm_add_ps(_mm_mul_ps(planeZ, centerZ), distance);
+
+        __m128 radius = _mm_mul_ps(_mm_andnot_ps(signMask, planeX), extentX);
+        radius = _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, planeY), extentY), radius);
+        radius = _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, planeZ), extentZ), radius);
+
+        outside = _mm_or_ps(outside, _mm_cmpgt_ps(distance, radius));
+    }
+
+    return static_cast<uint32_t>(~_mm_movemask_ps(outside)) & 0xFu;
+#else
+    uint32_t mask = 0;
+    for (uint32_t lane = 0; lane < BATCH_WIDTH; ++lane) {
+        const BoundingBox box(XMFLOAT3(cx[lane], cy[lane], cz[lane]), XMFLOAT3(ex[lane], ey[lane], ez[lane]));
+        if (intersectsBox(box, planeMask)) {
+            mask |= 1u << lane;
+        }
+    }
+
+    return mask;
+#endif
+}
\ No newline at end of file
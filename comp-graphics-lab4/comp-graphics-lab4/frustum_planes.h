@@ -0,0 +1,66 @@
+#ifndef FRUSTUM_PLANES_H
+#define FRUSTUM_PLANES_H
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Plane that last rejected a node, stored in the node so the next query tests it first.
+// Const queries may run concurrently on one structure and share the hint, so it is a relaxed
+// atomic: a stale or overwritten plane only changes the order the planes are tested in.
+class RejectingPlaneHint {
+public:
+    RejectingPlaneHint() = default;
+    RejectingPlaneHint(const RejectingPlaneHint& other) : mPlane(other.get()) {}
+    RejectingPlaneHint& operator=(const RejectingPlaneHint& other) {
+        set(other.get());
+        return *this;
+    }
+
+    uint8_t get() const { return mPlane.load(std::memory_order_relaxed); }
+    void set(uint8_t plane) const { mPlane.store(plane, std::memory_order_relaxed); }
+
+private:
+    mutable std::atomic<uint8_t> mPlane{ 0 };
+};
+
+// Frustum planes with outward-facing normals, as returned by BoundingFrustum::GetPlanes,
+// laid out for the box tests shared by the spatial index backends.
+// A box lies outside a plane when dot(n, center) + d > dot(|n|, extents).
+struct FrustumPlanes {
+#if defined(_XM_AVX_INTRINSICS_)
+    static constexpr uint32_t BATCH_WIDTH = 8;
+#else
+    static constexpr uint32_t BATCH_WIDTH = 4;
+#endif
+    static constexpr uint32_t ALL_PLANES = 0x3Fu;
+
+    float nx[6];
+    float ny[6];
+    float nz[6];
+    float d[6];
+
+    static FrustumPlanes fromFrustum(const DirectX::BoundingFrustum& frustum);
+
+    bool isOutsidePlane(size_t plane, const DirectX::BoundingBox& box, bool& inside) const;
+    bool intersectsBox(const DirectX::BoundingBox& box, uint32_t planeMask) const;
+    bool intersectsSphere(const DirectX::BoundingSphere& sphere) const;
+
+    // Tests the box against the planes still set in planeMask, starting with the plane
+    // that rejected this box last time. Planes the box lies completely inside are
+    // cleared from the mask since nothing contained in the box can cross them.
+    bool classifyBox(const DirectX::BoundingBox& box, uint32_t& planeMask, uint8_t& rejectingPlane, size_t& planeTests) const;
+    // Same, reading and updating the hint stored in a node. The hint is only written when
+    // the rejecting plane changes, so concurrent queries do not keep dirtying its cache line.
+    bool classifyBox(const DirectX::BoundingBox& box, uint32_t& planeMask, const RejectingPlaneHint& hint, size_t& planeTests) const;
+
+    // Returns a bitmask of the BATCH_WIDTH boxes read from the SoA pointers that are not
+    // entirely outside any frustum plane in planeMask.
+    uint32_t intersectsBatch(uint32_t planeMask, const float* cx, const float* cy, const float* cz,
+        const float* ex, const float* ey, const float* ez) const;
+};
+
+#endif // FRUSTUM_PLANES_H
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "hlod.h"
+#include "spatial_index.h"
+
+#include <fstream>
+#include <type_traits>
+#include <utility>
+
+using namespace DirectX;
+
+namespace {
+    // "HLD0" read as a little-endian integer.
+    constexpr uint32_t FILE_MAGIC = 0x30444c48;
+
+    struct FileHeader {
+        uint32_t magic = FILE_MAGIC;
+        uint32_t version = HlodSet::FILE_VERSION;
+        uint32_t sourceSubmeshCount = 0;
+        uint32_t sourceIndexCount = 0;
+        float simplificationError = 0.0f;
+        uint32_t clusterCount = 0;
+        uint32_t childCount = 0;
+        uint32_t proxyCount = 0;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+    };
+
+    static_assert(std::is_trivially_copyable<Vertex>::value, "proxy vertices are stored as raw bytes");
+
+    template <typename T>
+    void readArray(std::istream& in, std::vector<T>& values, size_t count) {
+        values.resize(count);
+        in.read(reinterpret_cast<char*>(values.data()), count * sizeof(T));
+    }
+
+    template <typename T>
+    void writeArray(std::ostream& out, const std::vector<T>& values) {
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+}
+
+HlodSet::HlodSet(std::vector<Cluster> clusters, std::vector<uint32_t> children, std::vector<Proxy> proxies,
+    std::vector<Vertex> proxyVertices, std::vector<uint32_t> proxyIndices, float simplificationError,
+    size_t sourceSubmeshCount, size_t sourceIndexCount)
+    : mClusters(std::move(clusters)), mChildren(std::move(children)), mProxies(std::move(proxies)),
+    mProxyVertices(std::move(proxyVertices)), mProxyIndices(std::move(proxyIndices)),
+    mSimplificationError(simplificationError), mSourceSubmeshCount(sourceSubmeshCount), mSourceIndexCount(sourceIndexCount) {
+    buildSubmeshClusters();
+}
+
+bool HlodSet::load(const std::string& fileName) {
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    FileHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != FILE_MAGIC || header.version != FILE_VERSION || header.simplificationError < 0.0f) {
+        return false;
+    }
+
+    HlodSet loaded;
+    readArray(in, loaded.mClusters, header.clusterCount);
+    readArray(in, loaded.mChildren, header.childCount);
+    readArray(in, loaded.mProxies, header.proxyCount);
+    readArray(in, loaded.mProxyVertices, header.vertexCount);
+    readArray(in, loaded.mProxyIndices, header.indexCount);
+    if (!in) {
+        return false;
+    }
+
+    loaded.mSimplificationError = header.simplificationError;
+    loaded.mSourceSubmeshCount = header.sourceSubmeshCount;
+    loaded.mSourceIndexCount = header.sourceIndexCount;
+    if (!loaded.buildSubmeshClusters()) {
+        return false;
+    }
+
+    *this = std::move(loaded);
+    return true;
+}
+
+bool HlodSet::save(const std::string& fileName) const {
+    std::ofstream out(fileName, std::ios::binary);
+
+    FileHeader header;
+    header.sourceSubmeshCount = static_cast<uint32_t>(mSourceSubmeshCount);
+    header.sourceIndexCount = static_cast<uint32_t>(mSourceIndexCount);
+    header.simplificationError = mSimplificationError;
+    header.clusterCount = static_cast<uint32_t>(mClusters.size());
+    header.childCount = static_cast<uint32_t>(mChildren.size());
+    header.proxyCount = static_cast<uint32_t>(mProxies.size());
+    header.vertexCount = static_cast<uint32_t>(mProxyVertices.size());
+    header.indexCount = static_cast<uint32_t>(mProxyIndices.size());
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeArray(out, mClusters);
+    writeArray(out, mChildren);
+    writeArray(out, mProxies);
+    writeArray(out, mProxyVertices);
+    writeArray(out, mProxyIndices);
+    return static_cast<bool>(out);
+}
+
+// Also validates the ranges, so a damaged file cannot index out of bounds later.
+bool HlodSet::buildSubmeshClusters() {
+    mSubmeshClusters.assign(mSourceSubmeshCount, INVALID_CLUSTER);
+    for (size_t clusterIndex = 0; clusterIndex < mClusters.size(); ++clusterIndex) {
+        const Cluster& cluster = mClusters[clusterIndex];
+        if (static_cast<size_t>(cluster.firstChild) + cluster.childCount > mChildren.size() ||
+            static_cast<size_t>(cluster.firstProxy) + cluster.proxyCount > mProxies.size()) {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < cluster.childCount; ++i) {
+            const uint32_t submeshIndex = mChildren[cluster.firstChild + i];
+            if (submeshIndex >= mSourceSubmeshCount || mSubmeshClusters[submeshIndex] != INVALID_CLUSTER) {
+                return false;
+            }
+            mSubmeshClusters[submeshIndex] = static_cast<uint32_t>(clusterIndex);
+        }
+    }
+
+    for (const Proxy& proxy : mProxies) {
+        if (proxy.materialSubmesh >= mSourceSubmeshCount || proxy.startVertex > mProxyVertices.size() ||
+            static_cast<size_t>(proxy.startIndex) + proxy.indexCount > mProxyIndices.size()) {
+            return false;
+        }
+    }
+    for (uint32_t index : mProxyIndices) {
+        if (index >= mProxyVertices.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+MeshData HlodSet::createProxyMesh(const MeshData& sourceMesh) const {
+    MeshData proxyMesh;
+    proxyMesh.vertices = mProxyVertices;
+    proxyMesh.indices = mProxyIndices;
+    proxyMesh.submeshes.reserve(mProxies.size());
+
+    for (const Proxy& proxy : mProxies) {
+        Submesh submesh;
+        submesh.indexCount = proxy.indexCount;
+        submesh.startIndiceIndex = proxy.startIndex;
+        submesh.startVerticeIndex = proxy.startVertex;
+        submesh.material = sourceMesh.submeshes[proxy.materialSubmesh].material;
+        proxyMesh.submeshes.push_back(submesh);
+    }
+    return proxyMesh;
+}
+
+void HlodSet::select(const XMFLOAT3& eye, float switchDistance, const std::vector<size_t>& visibleSubmeshIndices,
+    size_t proxySubmeshOffset, const std::vector<Submesh>& submeshes, Selection& selection) const {
+    selection.submeshIndices.clear();
+    selection.clusterStates.assign(mClusters.size(), CLUSTER_UNKNOWN);
+    selection.clustersReplaced = 0;
+    selection.drawCallsSaved = 0;
+    selection.trianglesSaved = 0;
+
+    for (size_t submeshIndex : visibleSubmeshIndices) {
+        const uint32_t clusterIndex = submeshIndex < mSubmeshClusters.size() ? mSubmeshClusters[submeshIndex] : INVALID_CLUSTER;
+        if (clusterIndex == INVALID_CLUSTER) {
+            selection.submeshIndices.push_back(submeshIndex);
+            continue;
+        }
+
+        const Cluster& cluster = mClusters[clusterIndex];
+        uint8_t& state = selection.clusterStates[clusterIndex];
+        if (state == CLUSTER_UNKNOWN) {
+            state = SpatialIndex::getViewDepth(cluster.bounds, eye) > switchDistance ? CLUSTER_FAR : CLUSTER_NEAR;
+        }
+        if (state == CLUSTER_NEAR) {
+            selection.submeshIndices.push_back(submeshIndex);
+            continue;
+        }
+
+        ++selection.drawCallsSaved;
+        selection.trianglesSaved += submeshes[submeshIndex].indexCount / 3;
+        if (state == CLUSTER_FAR) {
+            state = CLUSTER_REPLACED;
+            ++selection.clustersReplaced;
+            for (uint32_t i = 0; i < cluster.proxyCount; ++i) {
+                const uint32_t proxyIndex = cluster.firstProxy + i;
+                selection.submeshIndices.push_back(proxySubmeshOffset + proxyIndex);
+                --selection.drawCallsSaved;
+                selection.trianglesSaved -= mProxies[proxyIndex].indexCount / 3;
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef HLOD_H
+#define HLOD_H
+
+#include "mesh_data.h"
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Hierarchical level of detail for static geometry. Small submeshes are grouped into spatial
+// clusters, and every cluster owns simplified proxy geometry: one proxy per distinct material
+// of its children, so a proxy binds the textures of the children it replaces and no atlas is
+// needed. Beyond the switch distance the proxies are drawn instead of the children.
+class HlodSet {
+public:
+    static constexpr uint32_t FILE_VERSION = 1;
+    static constexpr uint32_t INVALID_CLUSTER = ~0u;
+
+    // Children are submesh indices of the source mesh in mChildren[firstChild, firstChild + childCount).
+    struct Cluster {
+        DirectX::BoundingBox bounds = {};
+        uint32_t firstChild = 0;
+        uint32_t childCount = 0;
+        uint32_t firstProxy = 0;
+        uint32_t proxyCount = 0;
+    };
+
+    // A proxy is an index range into the proxy vertices. It takes its material from
+    // materialSubmesh of the source mesh.
+    struct Proxy {
+        uint32_t materialSubmesh = 0;
+        uint32_t startIndex = 0;
+        uint32_t indexCount = 0;
+        uint32_t startVertex = 0;
+    };
+
+    // Scratch and result of select, kept by the caller so selection does not allocate once
+    // the buffers have grown.
+    struct Selection {
+        std::vector<size_t> submeshIndices;
+        std::vector<uint8_t> clusterStates;
+        size_t clustersReplaced = 0;
+        ptrdiff_t drawCallsSaved = 0;
+        ptrdiff_t trianglesSaved = 0;
+    };
+
+    HlodSet() = default;
+
+    // proxyVertices and proxyIndices hold the geometry of every proxy; indices are relative to
+    // the start of proxyVertices. sourceIndexCount identifies the geometry the set was built from.
+    HlodSet(std::vector<Cluster> clusters, std::vector<uint32_t> children, std::vector<Proxy> proxies,
+        std::vector<Vertex> proxyVertices, std::vector<uint32_t> proxyIndices, float simplificationError,
+        size_t sourceSubmeshCount, size_t sourceIndexCount);
+
+    bool load(const std::string& fileName);
+    bool save(const std::string& fileName) const;
+
+    bool empty() const { return mClusters.empty(); }
+    size_t getClusterCount() const { return mClusters.size(); }
+    size_t getChildCount() const { return mChildren.size(); }
+    size_t getProxyCount() const { return mProxies.size(); }
+    size_t getProxyTriangleCount() const { return mProxyIndices.size() / 3; }
+    size_t getSourceSubmeshCount() const { return mSourceSubmeshCount; }
+    size_t getSourceIndexCount() const { return mSourceIndexCount; }
+    float getSimplificationError() const { return mSimplificationError; }
+
+    // Distance beyond which the proxies differ from their children by less than maxPixelError
+    // pixels, where pixelsPerUnit is the projected size of a unit length at distance 1.
+    float getSwitchDistance(float pixelsPerUnit, float maxPixelError) const {
+        return mSimplificationError * pixelsPerUnit / maxPixelError;
+    }
+
+    // Submesh i of the result is proxy i, with its material copied from the source mesh.
+    MeshData createProxyMesh(const MeshData& sourceMesh) const;
+
+    // Replaces the children in visibleSubmeshIndices of every cluster whose bounds are farther
+    // from the eye than switchDistance with the cluster's proxies. The proxies are numbered from
+    // proxySubmeshOffset and take the place of the first visible child, so a front-to-back order
+    // stays roughly intact. Clusters with no visible child draw nothing.
+    void select(const DirectX::XMFLOAT3& eye, float switchDistance, const std::vector<size_t>& visibleSubmeshIndices,
+        size_t proxySubmeshOffset, const std::vector<Submesh>& submeshes, Selection& selection) const;
+
+private:
+    enum ClusterState : uint8_t {
+        CLUSTER_UNKNOWN,
+        CLUSTER_NEAR,
+        CLUSTER_FAR,
+        CLUSTER_REPLACED,
+    };
+
+    std::vector<Cluster> mClusters;
+    std::vector<uint32_t> mChildren;
+    std::vector<Proxy> mProxies;
+    std::vector<Vertex> mProxyVertices;
+    std::vector<uint32_t> mProxyIndices;
+    // INVALID_CLUSTER for source submeshes that belong to no cluster.
+    std::vector<uint32_t> mSubmeshClusters;
+    float mSimplificationError = 0.0f;
+    size_t mSourceSubmeshCount = 0;
+    size_t mSourceIndexCount = 0;
+
+    bool buildSubmeshClusters();
+};
+
+#endif // HLOD_H
\ No newline at end of file
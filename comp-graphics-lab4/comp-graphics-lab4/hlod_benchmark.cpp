@@ -0,0 +1,75 @@
+#include "hlod_benchmark.h"
+#include "hlod.h"
+#include "mesh_data.h"
+#include "spatial_index_benchmark.h"
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+using namespace DirectX;
+
+namespace {
+    constexpr float MAX_PIXEL_ERRORS[] = { 1.0f, 2.0f, 4.0f, 8.0f };
+    // Matches the default window and the projection BoxApp::onResize builds.
+    constexpr float FOV_Y = 0.25f * XM_PI;
+    constexpr float VIEWPORT_WIDTH = 800.0f;
+    constexpr float VIEWPORT_HEIGHT = 600.0f;
+    constexpr float NEAR_Z = 1.0f;
+    constexpr float FAR_Z = 1000.0f;
+}
+
+void runHlodBenchmark(const MeshData& mesh, const HlodSet& hlod, const std::vector<CameraPose>& path, std::ostream& out) {
+    // Proxies are numbered after the source submeshes, as they are in BoxApp.
+    std::vector<Submesh> submeshes(mesh.submeshes);
+    const MeshData proxyMesh = hlod.createProxyMesh(mesh);
+    submeshes.insert(submeshes.end(), proxyMesh.submeshes.begin(), proxyMesh.submeshes.end());
+
+    const std::vector<SpatialIndex::Entry> entries = createSubmeshEntries(mesh);
+    std::vector<std::vector<size_t>> visibleSets;
+    visibleSets.reserve(path.size());
+    size_t baseDrawCalls = 0;
+    size_t baseTriangles = 0;
+    for (const auto& pose : path) {
+        const BoundingFrustum frustum = createCameraFrustum(pose, FOV_Y, VIEWPORT_WIDTH / VIEWPORT_HEIGHT, NEAR_Z, FAR_Z);
+        std::vector<size_t> visible;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (frustum.Intersects(entries[i].bounds)) {
+                visible.push_back(i);
+                baseTriangles += mesh.submeshes[i].indexCount / 3;
+            }
+        }
+        baseDrawCalls += visible.size();
+        visibleSets.push_back(std::move(visible));
+    }
+
+    const double poseCount = std::max<double>(static_cast<double>(path.size()), 1.0);
+    const float pixelsPerUnit = 0.5f * VIEWPORT_HEIGHT / std::tan(0.5f * FOV_Y);
+    out << "hlod: " << hlod.getClusterCount() << " clusters, " << hlod.getChildCount() << " children, " <<
+        hlod.getProxyCount() << " proxies, " << hlod.getProxyTriangleCount() << " proxy triangles\n";
+    out << path.size() << " poses, " << std::fixed << std::setprecision(1) << baseDrawCalls / poseCount <<
+        " draw calls and " << baseTriangles / poseCount << " triangles per frame without proxies\n";
+    out << std::setw(10) << "max px" << std::setw(12) << "switch m" << std::setw(12) << "clusters" <<
+        std::setw(12) << "draws" << std::setw(14) << "draws saved" << std::setw(14) << "triangles" <<
+        std::setw(16) << "tris saved" << "\n";
+
+    HlodSet::Selection selection;
+    for (float maxPixelError : MAX_PIXEL_ERRORS) {
+        const float switchDistance = hlod.getSwitchDistance(pixelsPerUnit, maxPixelError);
+        size_t clustersReplaced = 0;
+        double drawCallsSaved = 0.0;
+        double trianglesSaved = 0.0;
+        for (size_t pose = 0; pose < path.size(); ++pose) {
+            hlod.select(path[pose].position, switchDistance, visibleSets[pose], mesh.submeshes.size(), submeshes, selection);
+            clustersReplaced += selection.clustersReplaced;
+            drawCallsSaved += static_cast<double>(selection.drawCallsSaved);
+            trianglesSaved += static_cast<double>(selection.trianglesSaved);
+        }
+
+        out << std::setprecision(1) << std::setw(10) << maxPixelError << std::setw(12) << switchDistance <<
+            std::setw(12) << clustersReplaced / poseCount <<
+            std::setw(12) << (baseDrawCalls - drawCallsSaved) / poseCount << std::setw(14) << drawCallsSaved / poseCount <<
+            std::setw(14) << (baseTriangles - trianglesSaved) / poseCount << std::setw(16) << trianglesSaved / poseCount << "\n";
+    }
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#ifndef HLOD_BENCHMARK_H
+#define HLOD_BENCHMARK_H
+
+#include "camera_path.h"
+
+#include <ostream>
+#include <vector>
+
+struct MeshData;
+class HlodSet;
+
+// Replays the camera path with frustum culling of the submesh boxes and reports, for a range
+// of pixel error thresholds, the draw calls and triangles with and without the HLOD proxies.
+void runHlodBenchmark(const MeshData& mesh, const HlodSet& hlod, const std::vector<CameraPose>& path, std::ostream& out);
+
+#endif // HLOD_BENCHMARK_H
\ No newline at end of file
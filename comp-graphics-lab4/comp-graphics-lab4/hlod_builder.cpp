@@ -0,0 +1,262 @@
+#include "hlod_builder.h"
+#include "mesh_data.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace {
+    constexpr uint32_t CELL_BITS = 20;
+    constexpr uint32_t MAX_CELL = (1u << CELL_BITS) - 1;
+
+    struct ProxyGeometry {
+        uint32_t materialSubmesh = 0;
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    struct VertexSum {
+        XMFLOAT3 position = { 0.0f, 0.0f, 0.0f };
+        XMFLOAT3 normal = { 0.0f, 0.0f, 0.0f };
+        XMFLOAT3 tangent = { 0.0f, 0.0f, 0.0f };
+        XMFLOAT3 bitangent = { 0.0f, 0.0f, 0.0f };
+        XMFLOAT2 texCoord = { 0.0f, 0.0f };
+        uint32_t count = 0;
+    };
+
+    std::string getMaterialKey(const Material& material) {
+        return material.diffuseTextureName + '|' + material.normalTextureName + '|' + material.displacementTextureName;
+    }
+
+    // 0..5 for +x, -x, +y, -y, +z, -z; keeps the two sides of thin walls apart.
+    uint32_t getDominantAxis(const Vector3& normal) {
+        const float ax = std::fabs(normal.x);
+        const float ay = std::fabs(normal.y);
+        const float az = std::fabs(normal.z);
+        if (ax >= ay && ax >= az) {
+            return normal.x >= 0.0f ? 0 : 1;
+        }
+        if (ay >= az) {
+            return normal.y >= 0.0f ? 2 : 3;
+        }
+        return normal.z >= 0.0f ? 4 : 5;
+    }
+
+    uint64_t getCellKey(const Vertex& vertex, const XMFLOAT3& origin, float cellSize) {
+        const auto cell = [cellSize](float value, float start) {
+            return static_cast<uint64_t>(std::min(std::max(std::floor((value - start) / cellSize), 0.0f), static_cast<float>(MAX_CELL)));
+        };
+        return cell(vertex.position.x, origin.x) | (cell(vertex.position.y, origin.y) << CELL_BITS) |
+            (cell(vertex.position.z, origin.z) << (2 * CELL_BITS)) | (static_cast<uint64_t>(getDominantAxis(vertex.normal)) << (3 * CELL_BITS));
+    }
+
+    void accumulate(XMFLOAT3& sum, const Vector3& value) {
+        sum.x += value.x;
+        sum.y += value.y;
+        sum.z += value.z;
+    }
+
+    Vector3 normalizeOr(const XMFLOAT3& value, const Vector3& fallback) {
+        const float lengthSquared = value.x * value.x + value.y * value.y + value.z * value.z;
+        if (lengthSquared <= FLT_MIN) {
+            return fallback;
+        }
+        const float scale = 1.0f / std::sqrt(lengthSquared);
+        return Vector3(value.x * scale, value.y * scale, value.z * scale);
+    }
+
+    void simplify(const MeshData& mesh, const std::vector<uint32_t>& submeshes, const XMFLOAT3& origin, float cellSize,
+        ProxyGeometry& proxy) {
+        std::unordered_map<uint64_t, uint32_t> cellVertices;
+        std::unordered_map<uint32_t, uint32_t> sourceVertices;
+        std::vector<VertexSum> sums;
+        std::vector<Vector3> fallbackNormals;
+        std::set<std::array<uint32_t, 3>> triangles;
+
+        const auto mapVertex = [&](uint32_t sourceIndex) {
+            const auto found = sourceVertices.find(sourceIndex);
+            if (found != sourceVertices.end()) {
+                return found->second;
+            }
+
+            const Vertex& vertex = mesh.vertices[sourceIndex];
+            const auto inserted = cellVertices.emplace(getCellKey(vertex, origin, cellSize), static_cast<uint32_t>(sums.size()));
+            if (inserted.second) {
+                sums.emplace_back();
+                fallbackNormals.push_back(vertex.normal);
+            }
+
+            const uint32_t proxyIndex = inserted.first->second;
+            VertexSum& sum = sums[proxyIndex];
+            accumulate(sum.position, vertex.position);
+            accumulate(sum.normal, vertex.normal);
+            accumulate(sum.tangent, vertex.tangent);
+            accumulate(sum.bitangent, vertex.bitangent);
+            sum.texCoord.x += vertex.texCoord.x;
+            sum.texCoord.y += vertex.texCoord.y;
+            ++sum.count;
+            sourceVertices.emplace(sourceIndex, proxyIndex);
+            return proxyIndex;
+        };
+
+        for (uint32_t submeshIndex : submeshes) {
+            const Submesh& submesh = mesh.submeshes[submeshIndex];
+            for (UINT i = 0; i + 2 < submesh.indexCount; i += 3) {
+                const uint32_t* source = &mesh.indices[submesh.startIndiceIndex + i];
+                std::array<uint32_t, 3> triangle = { mapVertex(source[0]), mapVertex(source[1]), mapVertex(source[2]) };
+                if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) {
+                    continue;
+                }
+
+                // Rotated so the smallest index comes first, which keeps the winding and makes
+                // repeated triangles compare equal.
+                std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+                if (triangles.insert(triangle).second) {
+                    proxy.indices.insert(proxy.indices.end(), triangle.begin(), triangle.end());
+                }
+            }
+        }
+
+        proxy.vertices.resize(sums.size());
+        for (size_t i = 0; i < sums.size(); ++i) {
+            const VertexSum& sum = sums[i];
+            const float scale = 1.0f / static_cast<float>(sum.count);
+            Vertex& vertex = proxy.vertices[i];
+            vertex.position = Vector3(sum.position.x * scale, sum.position.y * scale, sum.position.z * scale);
+            vertex.normal = normalizeOr(sum.normal, fallbackNormals[i]);
+            vertex.tangent = normalizeOr(sum.tangent, Vector3(1.0f, 0.0f, 0.0f));
+            vertex.bitangent = normalizeOr(sum.bitangent, Vector3(0.0f, 1.0f, 0.0f));
+            vertex.texCoord = Vector2(sum.texCoord.x * scale, sum.texCoord.y * scale);
+        }
+    }
+}
+
+HlodBuilder::HlodBuilder(const Settings& settings) : mSettings(settings) {}
+
+HlodSet HlodBuilder::build(const MeshData& mesh, ThreadPool* threadPool, BuildStats* stats) const {
+    const size_t submeshCount = mesh.submeshes.size();
+    std::vector<BoundingBox> submeshBounds(submeshCount);
+    // Ordered by cell, so the cluster order does not depend on hashing.
+    std::map<std::tuple<int, int, int>, std::vector<uint32_t>> cells;
+
+    for (size_t submeshIndex = 0; submeshIndex < submeshCount; ++submeshIndex) {
+        const Submesh& submesh = mesh.submeshes[submeshIndex];
+        if (submesh.indexCount < 3 || isColumnSubmesh(submesh)) {
+            continue;
+        }
+
+        XMVECTOR submeshMin = XMVectorReplicate(FLT_MAX);
+        XMVECTOR submeshMax = XMVectorReplicate(-FLT_MAX);
+        for (UINT i = 0; i < submesh.indexCount; ++i) {
+            const XMVECTOR position = XMLoadFloat3(&mesh.vertices[mesh.indices[submesh.startIndiceIndex + i]].position);
+            submeshMin = XMVectorMin(submeshMin, position);
+            submeshMax = XMVectorMax(submeshMax, position);
+        }
+
+        BoundingBox& bounds = submeshBounds[submeshIndex];
+        BoundingBox::CreateFromPoints(bounds, submeshMin, submeshMax);
+        if (XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Extents))) > mSettings.maxChildRadius) {
+            continue;
+        }
+
+        const auto cell = std::make_tuple(static_cast<int>(std::floor(bounds.Center.x / mSettings.clusterSize)),
+            static_cast<int>(std::floor(bounds.Center.y / mSettings.clusterSize)),
+            static_cast<int>(std::floor(bounds.Center.z / mSettings.clusterSize)));
+        cells[cell].push_back(static_cast<uint32_t>(submeshIndex));
+    }
+
+    std::vector<HlodSet::Cluster> clusters;
+    std::vector<uint32_t> children;
+    std::vector<std::vector<std::vector<uint32_t>>> clusterMaterialGroups;
+    for (const auto& cell : cells) {
+        if (cell.second.size() < mSettings.minChildren) {
+            continue;
+        }
+
+        HlodSet::Cluster cluster;
+        cluster.bounds = submeshBounds[cell.second.front()];
+        cluster.firstChild = static_cast<uint32_t>(children.size());
+        cluster.childCount = static_cast<uint32_t>(cell.second.size());
+
+        std::vector<std::vector<uint32_t>> materialGroups;
+        std::vector<std::string> materialKeys;
+        for (uint32_t submeshIndex : cell.second) {
+            BoundingBox::CreateMerged(cluster.bounds, cluster.bounds, submeshBounds[submeshIndex]);
+            children.push_back(submeshIndex);
+
+            const std::string key = getMaterialKey(mesh.submeshes[submeshIndex].material);
+            const size_t group = std::find(materialKeys.begin(), materialKeys.end(), key) - materialKeys.begin();
+            if (group == materialKeys.size()) {
+                materialKeys.push_back(key);
+                materialGroups.emplace_back();
+            }
+            materialGroups[group].push_back(submeshIndex);
+        }
+
+        clusters.push_back(cluster);
+        clusterMaterialGroups.push_back(std::move(materialGroups));
+    }
+
+    std::vector<std::vector<ProxyGeometry>> clusterProxies(clusters.size());
+    ThreadPool::run(threadPool, clusters.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t clusterIndex = begin; clusterIndex < end; ++clusterIndex) {
+            const BoundingBox& bounds = clusters[clusterIndex].bounds;
+            const XMFLOAT3 origin(bounds.Center.x - bounds.Extents.x, bounds.Center.y - bounds.Extents.y,
+                bounds.Center.z - bounds.Extents.z);
+            for (const auto& group : clusterMaterialGroups[clusterIndex]) {
+                ProxyGeometry proxy;
+                proxy.materialSubmesh = group.front();
+                simplify(mesh, group, origin, mSettings.simplifyCellSize, proxy);
+                if (!proxy.indices.empty()) {
+                    clusterProxies[clusterIndex].push_back(std::move(proxy));
+                }
+            }
+        }
+    });
+
+    std::vector<HlodSet::Proxy> proxies;
+    std::vector<Vertex> proxyVertices;
+    std::vector<uint32_t> proxyIndices;
+    for (size_t clusterIndex = 0; clusterIndex < clusters.size(); ++clusterIndex) {
+        clusters[clusterIndex].firstProxy = static_cast<uint32_t>(proxies.size());
+        clusters[clusterIndex].proxyCount = static_cast<uint32_t>(clusterProxies[clusterIndex].size());
+
+        for (const ProxyGeometry& geometry : clusterProxies[clusterIndex]) {
+            HlodSet::Proxy proxy;
+            proxy.materialSubmesh = geometry.materialSubmesh;
+            proxy.startIndex = static_cast<uint32_t>(proxyIndices.size());
+            proxy.indexCount = static_cast<uint32_t>(geometry.indices.size());
+            proxy.startVertex = static_cast<uint32_t>(proxyVertices.size());
+            for (uint32_t index : geometry.indices) {
+                proxyIndices.push_back(proxy.startVertex + index);
+            }
+            proxyVertices.insert(proxyVertices.end(), geometry.vertices.begin(), geometry.vertices.end());
+            proxies.push_back(proxy);
+        }
+    }
+
+    if (stats) {
+        *stats = {};
+        stats->clusterCount = clusters.size();
+        stats->childCount = children.size();
+        stats->proxyCount = proxies.size();
+        stats->proxyTriangles = proxyIndices.size() / 3;
+        for (uint32_t submeshIndex : children) {
+            stats->childTriangles += mesh.submeshes[submeshIndex].indexCount / 3;
+        }
+    }
+
+    // A vertex moves to the average of its cell, so by at most the cell diagonal.
+    const float simplificationError = mSettings.simplifyCellSize * std::sqrt(3.0f);
+    return HlodSet(std::move(clusters), std::move(children), std::move(proxies), std::move(proxyVertices),
+        std::move(proxyIndices), simplificationError, submeshCount, mesh.indices.size());
+}
\ No newline at end of file
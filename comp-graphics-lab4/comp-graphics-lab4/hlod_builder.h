@@ -0,0 +1,43 @@
+#ifndef HLOD_BUILDER_H
+#define HLOD_BUILDER_H
+
+#include "hlod.h"
+
+#include <cstdint>
+
+struct MeshData;
+class ThreadPool;
+
+// Offline build of an HlodSet. Submeshes no larger than maxChildRadius are bucketed by the
+// center of their bounds into a uniform grid of clusterSize cells, the fixed-depth nodes of
+// an octree over the scene. Children of a cluster that share a material are merged and
+// simplified by vertex clustering: vertices falling in the same cell of simplifyCellSize and
+// facing the same dominant axis collapse into their average, and triangles that collapse or
+// repeat are dropped. Column submeshes are displaced in the vertex shader and never merged.
+class HlodBuilder {
+public:
+    struct Settings {
+        float clusterSize = 4.0f;
+        float maxChildRadius = 1.5f;
+        uint32_t minChildren = 2;
+        float simplifyCellSize = 0.03f;
+    };
+
+    struct BuildStats {
+        size_t clusterCount = 0;
+        size_t childCount = 0;
+        size_t proxyCount = 0;
+        size_t childTriangles = 0;
+        size_t proxyTriangles = 0;
+    };
+
+    explicit HlodBuilder(const Settings& settings);
+
+    // Clusters are simplified in parallel; the result does not depend on the thread count.
+    HlodSet build(const MeshData& mesh, ThreadPool* threadPool = nullptr, BuildStats* stats = nullptr) const;
+
+private:
+    Settings mSettings;
+};
+
+#endif // HLOD_BUILDER_H
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "index_pools.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+namespace {
+    constexpr uint32_t SHORT_INDEX_MAX = std::numeric_limits<uint16_t>::max();
+}
+
+size_t IndexPools::getLongPoolOffset() const {
+    const size_t shortBytes = shortIndices.size() * sizeof(uint16_t);
+    return (shortBytes + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+}
+
+size_t IndexPools::getByteSize() const {
+    return getLongPoolOffset() + longIndices.size() * sizeof(uint32_t);
+}
+
+std::vector<uint8_t> IndexPools::createBuffer() const {
+    std::vector<uint8_t> buffer(getByteSize(), 0);
+    if (!shortIndices.empty()) {
+        std::memcpy(buffer.data(), shortIndices.data(), shortIndices.size() * sizeof(uint16_t));
+    }
+    if (!longIndices.empty()) {
+        std::memcpy(buffer.data() + getLongPoolOffset(), longIndices.data(), longIndices.size() * sizeof(uint32_t));
+    }
+    return buffer;
+}
+
+void assignIndexPools(MeshData& mesh) {
+    UINT shortCount = 0;
+    UINT longCount = 0;
+    for (Submesh& submesh : mesh.submeshes) {
+        // Submeshes own the vertices from their startVerticeIndex on, so the minimum only
+        // matters for an index that points before it.
+        uint32_t minIndex = submesh.startVerticeIndex;
+        uint32_t maxIndex = submesh.startVerticeIndex;
+        for (UINT i = 0; i < submesh.indexCount; ++i) {
+            const uint32_t index = mesh.indices[submesh.startIndiceIndex + i];
+            minIndex = std::min(minIndex, index);
+            maxIndex = std::max(maxIndex, index);
+        }
+
+        submesh.baseVertex = minIndex;
+        submesh.shortIndices = maxIndex - minIndex <= SHORT_INDEX_MAX;
+        UINT& poolCount = submesh.shortIndices ? shortCount : longCount;
+        submesh.poolStartIndex = poolCount;
+        poolCount += submesh.indexCount;
+    }
+}
+
+IndexPools createIndexPools(const MeshData& mesh, const std::vector<uint32_t>& indices) {
+    IndexPools pools;
+    for (const Submesh& submesh : mesh.submeshes) {
+        const uint32_t* source = indices.data() + submesh.startIndiceIndex;
+        // Pools built from remapped indices reuse the placement assignIndexPools chose for
+        // mesh.indices, so every index must still fit the submesh's base vertex and width.
+        for (UINT i = 0; i < submesh.indexCount; ++i) {
+            assert(source[i] >= submesh.baseVertex);
+            assert(!submesh.shortIndices || source[i] - submesh.baseVertex <= SHORT_INDEX_MAX);
+        }
+        if (submesh.shortIndices) {
+            pools.shortIndices.resize(std::max<size_t>(pools.shortIndices.size(), submesh.poolStartIndex + submesh.indexCount));
+            for (UINT i = 0; i < submesh.indexCount; ++i) {
+                pools.shortIndices[submesh.poolStartIndex + i] = static_cast<uint16_t>(source[i] - submesh.baseVertex);
+            }
+        }
+        else {
+            pools.longIndices.resize(std::max<size_t>(pools.longIndices.size(), submesh.poolStartIndex + submesh.indexCount));
+            for (UINT i = 0; i < submesh.indexCount; ++i) {
+                pools.longIndices[submesh.poolStartIndex + i] = source[i] - submesh.baseVertex;
+            }
+        }
+    }
+    return pools;
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#ifndef INDEX_POOLS_H
+#define INDEX_POOLS_H
+
+#include "mesh_data.h"
+
+#include <cstdint>
+#include <vector>
+
+// GPU index buffer split into a 16-bit and a 32-bit pool. Every submesh's indices are stored
+// relative to its Submesh::baseVertex, which the draws pass as BaseVertexLocation, so any
+// submesh spanning at most 65536 vertices fits the 16-bit pool.
+struct IndexPools {
+    std::vector<uint16_t> shortIndices;
+    std::vector<uint32_t> longIndices;
+
+    // The 32-bit pool follows the 16-bit one, aligned to its index size.
+    size_t getLongPoolOffset() const;
+    size_t getByteSize() const;
+    std::vector<uint8_t> createBuffer() const;
+};
+
+// Chooses the pool, the pool offset and the base vertex of every submesh from mesh.indices.
+void assignIndexPools(MeshData& mesh);
+
+// Lays out indices, ordered like mesh.indices, in the pools assigned by assignIndexPools. Any
+// per submesh remapping of the indices must stay within the vertices mesh.indices references.
+IndexPools createIndexPools(const MeshData& mesh, const std::vector<uint32_t>& indices);
+
+#endif // INDEX_POOLS_H
\ No newline at end of file
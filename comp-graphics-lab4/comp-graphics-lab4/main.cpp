@@ -1,12 +1,276 @@
 #include "box_app.h"
+#include "spatial_index_benchmark.h"
+#include "meshlet_benchmark.h"
+#include "culling_benchmark.h"
+#include "mesh_culling_benchmark.h"
+#include "draw_order_benchmark.h"
+#include "pvs_baker.h"
+#include "hlod_builder.h"
+#include "hlod_benchmark.h"
+#include "ray_benchmark.h"
+#include "vertex_format_benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace {
+    const std::string BENCHMARK_SPATIAL_INDEX_ARG = "--benchmark-spatial-index";
+    const std::string BENCHMARK_MESHLETS_ARG = "--benchmark-meshlets";
+    const std::string BENCHMARK_BOUNDING_VOLUMES_ARG = "--benchmark-bounding-volumes";
+    const std::string BENCHMARK_OCCLUSION_ARG = "--benchmark-occlusion";
+    const std::string BENCHMARK_DRAW_ORDER_ARG = "--benchmark-draw-order";
+    const std::string BENCHMARK_PARALLEL_QUERY_ARG = "--benchmark-parallel-query";
+    const std::string BENCHMARK_RAYS_ARG = "--benchmark-rays";
+    const std::string BENCHMARK_VERTEX_FORMAT_ARG = "--benchmark-vertex-format";
+    const std::string BAKE_PVS_ARG = "--bake-pvs";
+    const std::string BAKE_HLOD_ARG = "--bake-hlod";
+    const std::string EXPORT_CULLING_ENTRIES_ARG = "--export-culling-entries";
+    const std::string CAMERA_PATH_ARG = "--camera-path=";
+    const std::string SPATIAL_INDEX_ARG = "--spatial-index=";
+    const std::string VERTEX_FORMAT_ARG = "--vertex-format=";
+    const size_t DEFAULT_CAMERA_PATH_POSES = 256;
+
+    int runSpatialIndexBenchmarkMode() {
+        ThreadPool threadPool;
+        ModelLoader loader(0.01f);
+        const MeshData mesh = loader.loadModel("sponza.obj", &threadPool);
+
+        std::ofstream out("spatial_index_benchmark.txt");
+        const std::vector<SpatialIndex::Entry> entries = createSubmeshEntries(mesh);
+        runSpatialIndexBenchmark(entries, out, &threadPool);
+        runOctreeLayoutBenchmark(entries, out);
+        runOctreeUpdateBenchmark(out);
+        runOctreeBuildBenchmark(out, &threadPool);
+        runMultiViewQueryBenchmark(out);
+        return out ? 0 : 1;
+    }
+
+    int runMeshletBenchmarkMode() {
+        ThreadPool threadPool;
+        ModelLoader loader(0.01f);
+        MeshData mesh = loader.loadModel("sponza.obj", &threadPool);
+
+        std::ofstream out("meshlet_benchmark.txt");
+        runMeshletBenchmark(mesh, out);
+        return out ? 0 : 1;
+    }
+
+    int runDrawOrderBenchmarkMode() {
+        ThreadPool threadPool;
+        ModelLoader loader(0.01f);
+        const MeshData mesh = loader.loadModel("sponza.obj", &threadPool);
+
+        std::ofstream out("draw_order_benchmark.txt");
+        runDrawOrderBenchmark(mesh, out, &threadPool);
+        return out ? 0 : 1;
+    }
+
+    int runParallelQueryBenchmarkMode() {
+        std::ofstream out("parallel_query_benchmark.txt");
+        runParallelQueryBenchmark(out, std::max(std::thread::hardware_concurrency(), 1u));
+        return out ? 0 : 1;
+    }
+
+    int runRayBenchmarkMode() {
+        ThreadPool threadPool;
+        ModelLoader loader(0.01f);
+        const MeshData mesh = loader.loadModel("sponza.obj", &threadPool);
+
+        std::ofstream out("ray_benchmark.txt");
+        runRayBenchmark(mesh, out, &threadPool);
+        return out ? 0 : 1;
+    }
+
+    int runVertexFormatBenchmarkMode() {
+        ThreadPool threadPool;
+        ModelLoader loader(0.01f);
+        MeshData mesh = loader.loadModel("sponza.obj", &threadPool);
+
+        std::ofstream out("vertex_format_benchmark.txt");
+        runVertexFormatBenchmark(mesh, out);
+        return out ? 0 : 1;
+    }
+
+    // Writes sponza.pvs, which the app loads at startup, and a summary of the bake.
+    int runPvsBakeMode() {
+        ThreadPool threadPool;
+        ModelLoader loader(0.01f);
+        const MeshData mesh = loader.loadModel("sponza.obj", &threadPool);
+
+        PvsBaker::BakeStats stats;
+        const auto start = std::chrono::steady_clock::now();
+        const PotentiallyVisibleSet pvs = PvsBaker(PvsBaker::Settings()).bake(mesh, &threadPool, &stats);
+        const std::chrono::duration<double> bakeTime = std::chrono::steady_clock::now() - start;
+
+        std::ofstream out("pvs_bake.txt");
+        out << "Cells: " << stats.cellCount << '\n' <<
+            "Rays: " << stats.rayCount << '\n' <<
+            "Triangle tests: " << stats.triangleTests << '\n' <<
+            "Visible submeshes per cell: " << stats.averageVisibleSubmeshes << " of " << pvs.getSubmeshCount() << '\n' <<
+            "Compressed size: " << pvs.getCompressedSize() << " bytes\n" <<
+            "Bake time: " << bakeTime.count() << " s\n";
+        return pvs.save("sponza.pvs") && out ? 0 : 1;
+    }
+
+    // Writes sponza.hlod, which the app loads at startup, and reports the proxies along the
+    // orbiting camera path.
+    int runHlodBakeMode() {
+        ThreadPool threadPool;
+        ModelLoader loader(0.01f);
+        const MeshData mesh = loader.loadModel("sponza.obj", &threadPool);
+
+        HlodBuilder::BuildStats stats;
+        const auto start = std::chrono::steady_clock::now();
+        const HlodSet hlod = HlodBuilder(HlodBuilder::Settings()).build(mesh, &threadPool, &stats);
+        const std::chrono::duration<double> buildTime = std::chrono::steady_clock::now() - start;
+
+        const std::vector<SpatialIndex::Entry> entries = createSubmeshEntries(mesh);
+        if (entries.empty()) {
+            return 1;
+        }
+        BoundingBox sceneBounds = entries.front().bounds;
+        for (const auto& entry : entries) {
+            BoundingBox::CreateMerged(sceneBounds, sceneBounds, entry.bounds);
+        }
+
+        std::ofstream out("hlod_bake.txt");
+        out << "Clusters: " << stats.clusterCount << '\n' <<
+            "Children: " << stats.childCount << '\n' <<
+            "Proxies: " << stats.proxyCount << '\n' <<
+            "Triangles: " << stats.childTriangles << " -> " << stats.proxyTriangles << '\n' <<
+            "Build time: " << buildTime.count() << " s\n\n";
+        runHlodBenchmark(mesh, hlod, createOrbitCameraPath(sceneBounds, DEFAULT_CAMERA_PATH_POSES), out);
+        return hlod.save("sponza.hlod") && out ? 0 : 1;
+    }
+
+    // The path recorded in the app with 'R' and passed with --camera-path, or an orbit around
+    // the entries when none is given.
+    bool createBenchmarkCameraPath(const std::string& cameraPathFile, const std::vector<SpatialIndex::Entry>& entries,
+        std::vector<CameraPose>& path) {
+        if (!cameraPathFile.empty()) {
+            return loadCameraPath(cameraPathFile, path);
+        }
+
+        BoundingBox sceneBounds = entries.front().bounds;
+        for (const auto& entry : entries) {
+            BoundingBox::CreateMerged(sceneBounds, sceneBounds, entry.bounds);
+        }
+        path = createOrbitCameraPath(sceneBounds, DEFAULT_CAMERA_PATH_POSES);
+        return true;
+    }
+
+    int runBoundingVolumeBenchmarkMode(const std::string& cameraPathFile) {
+        ThreadPool threadPool;
+        ModelLoader loader(0.01f);
+        const MeshData mesh = loader.loadModel("sponza.obj", &threadPool);
+        const std::vector<SpatialIndex::Entry> entries = createSubmeshEntries(mesh);
+        std::vector<CameraPose> path;
+        if (entries.empty() || !createBenchmarkCameraPath(cameraPathFile, entries, path)) {
+            return 1;
+        }
+
+        std::ofstream out("bounding_volume_benchmark.json");
+        runBoundingVolumeBenchmark(mesh, path, out, &threadPool);
+        return out ? 0 : 1;
+    }
+
+    // Writes the submesh boxes for the standalone culling_benchmark tool, which has no model
+    // loader of its own.
+    int runExportCullingEntriesMode() {
+        ThreadPool threadPool;
+        ModelLoader loader(0.01f);
+        const MeshData mesh = loader.loadModel("sponza.obj", &threadPool);
+        return saveCullingEntries("sponza_culling_entries.txt", createSubmeshEntries(mesh)) ? 0 : 1;
+    }
+
+    int runOcclusionBenchmarkMode(const std::string& cameraPathFile) {
+        ThreadPool threadPool;
+        ModelLoader loader(0.01f);
+        const MeshData mesh = loader.loadModel("sponza.obj", &threadPool);
+        const std::vector<SpatialIndex::Entry> entries = createSubmeshEntries(mesh);
+        std::vector<CameraPose> path;
+        if (entries.empty() || !createBenchmarkCameraPath(cameraPathFile, entries, path)) {
+            return 1;
+        }
+
+        std::ofstream out("occlusion_benchmark.json");
+        runOcclusionBenchmark(mesh, path, out, &threadPool);
+        return out ? 0 : 1;
+    }
+}
+
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, PSTR cmdLine, int showCmd) {
+    SpatialIndexType spatialIndexType = SpatialIndexType::Octree;
+    VertexFormat vertexFormat = VertexFormat::Full;
+    std::string cameraPathFile;
+    bool benchmarkBoundingVolumes = false;
+    bool benchmarkOcclusion = false;
+
+    std::istringstream args(cmdLine ? cmdLine : "");
+    std::string arg;
+    while (args >> arg) {
+        if (arg == BENCHMARK_SPATIAL_INDEX_ARG) {
+            return runSpatialIndexBenchmarkMode();
+        }
+        if (arg == BENCHMARK_MESHLETS_ARG) {
+            return runMeshletBenchmarkMode();
+        }
+        if (arg == BENCHMARK_DRAW_ORDER_ARG) {
+            return runDrawOrderBenchmarkMode();
+        }
+        if (arg == BENCHMARK_PARALLEL_QUERY_ARG) {
+            return runParallelQueryBenchmarkMode();
+        }
+        if (arg == BENCHMARK_RAYS_ARG) {
+            return runRayBenchmarkMode();
+        }
+        if (arg == BENCHMARK_VERTEX_FORMAT_ARG) {
+            return runVertexFormatBenchmarkMode();
+        }
+        if (arg == BAKE_PVS_ARG) {
+            return runPvsBakeMode();
+        }
+        if (arg == BAKE_HLOD_ARG) {
+            return runHlodBakeMode();
+        }
+        if (arg == EXPORT_CULLING_ENTRIES_ARG) {
+            return runExportCullingEntriesMode();
+        }
+        if (arg == BENCHMARK_BOUNDING_VOLUMES_ARG) {
+            benchmarkBoundingVolumes = true;
+        }
+        if (arg == BENCHMARK_OCCLUSION_ARG) {
+            benchmarkOcclusion = true;
+        }
+        if (arg.compare(0, CAMERA_PATH_ARG.size(), CAMERA_PATH_ARG) == 0) {
+            cameraPathFile = arg.substr(CAMERA_PATH_ARG.size());
+        }
+        if (arg.compare(0, SPATIAL_INDEX_ARG.size(), SPATIAL_INDEX_ARG) == 0) {
+            SpatialIndex::parseType(arg.substr(SPATIAL_INDEX_ARG.size()), spatialIndexType);
+        }
+        if (arg.compare(0, VERTEX_FORMAT_ARG.size(), VERTEX_FORMAT_ARG) == 0) {
+            parseVertexFormat(arg.substr(VERTEX_FORMAT_ARG.size()), vertexFormat);
+        }
+    }
+
+    if (benchmarkBoundingVolumes) {
+        return runBoundingVolumeBenchmarkMode(cameraPathFile);
+    }
+    if (benchmarkOcclusion) {
+        return runOcclusionBenchmarkMode(cameraPathFile);
+    }
 
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, PSTR, int showCmd) {
     ComPtr<ID3D12Debug> debugController;
     if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debugController)))) {
         debugController->EnableDebugLayer();
     }
 
     BoxApp app(hInstance);
+    app.setSpatialIndexType(spatialIndexType);
+    app.setVertexFormat(vertexFormat);
     if (!app.initMainWindow(hInstance, showCmd))
         return 0;
 
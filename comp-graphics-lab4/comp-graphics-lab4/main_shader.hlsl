@@ -8,7 +8,9 @@ cbuffer cbPerObject : register(b0)
     float gTextureAnimationEnabled;
     float gDisplacementScale;
     float gMaxTessellationFactor;
-    float3 gPadding;
+    float3 gPositionOrigin;
+    float3 gPositionExtent;
+    float gPadding;
 };
 
 cbuffer cbPass : register(b1)
@@ -26,14 +28,7 @@ Texture2D gNormalMap : register(t1);
 Texture2D gDisplacementMap : register(t2);
 SamplerState gSampler : register(s0);
 
-struct VertexIn
-{
-    float3 PosL : POSITION;
-    float3 NormalL : NORMAL;
-    float3 TangentL : TANGENT;
-    float3 BitangentL : BINORMAL;
-    float2 TexC : TEXCOORD;
-};
+#include "vertex_input.hlsli"
 
 struct VertexOut
 {
@@ -66,15 +61,16 @@ struct GBufferOut
     float Depth : SV_Target2;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut VS(VertexIn input)
 {
     VertexOut vout;
+    VertexAttributes vin = decodeVertex(input);
 
     float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
     vout.NormalW = mul(vin.NormalL, (float3x3) gWorld);
     vout.TangentW = mul(vin.TangentL, (float3x3) gWorld);
     vout.BitangentW = mul(vin.BitangentL, (float3x3) gWorld);
-    vout.PosH = mul(float4(vin.PosL, 1.0f), gWorldViewProj);
+    vout.PosH = projectPosition(vin.PosL);
 
     float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
     vout.TexC = texC.xy;
@@ -82,9 +78,15 @@ VertexOut VS(VertexIn vin)
     return vout;
 }
 
-TessControlPoint VS_Tess(VertexIn vin)
+float4 VS_Depth(PositionIn pin) : SV_POSITION
+{
+    return projectPosition(decodePosition(pin));
+}
+
+TessControlPoint VS_Tess(VertexIn input)
 {
     TessControlPoint vout;
+    VertexAttributes vin = decodeVertex(input);
     vout.PosL = vin.PosL;
     vout.NormalL = vin.NormalL;
     vout.TangentL = vin.TangentL;
@@ -0,0 +1,32 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only view of a whole file mapped into memory. Pages are read from disk on first touch,
+// so opening is cheap and the data is never copied into a separate buffer.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& fileName);
+    void close();
+
+    bool isOpen() const { return mData != nullptr; }
+    const uint8_t* getData() const { return mData; }
+    size_t getSize() const { return mSize; }
+
+private:
+    void* mFile = nullptr;
+    void* mMapping = nullptr;
+    const uint8_t* mData = nullptr;
+    size_t mSize = 0;
+};
+
+#endif // MAPPED_FILE_H
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "mesh_cache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+using namespace DirectX;
+
+namespace {
+    // "MSH0" read as a little-endian integer.
+    constexpr uint32_t FILE_MAGIC = 0x3048534d;
+    constexpr uint64_t SECTION_ALIGNMENT = 16;
+    constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    constexpr uint64_t FNV_PRIME = 1099511628211ull;
+    constexpr size_t MATERIAL_NAME_COUNT = 3;
+
+    static_assert(std::is_trivially_copyable<Vertex>::value, "vertices are stored as raw bytes");
+
+    struct FileHeader {
+        uint32_t magic = FILE_MAGIC;
+        uint32_t version = MeshCache::FILE_VERSION;
+        uint32_t vertexStride = sizeof(Vertex);
+        uint32_t postProcessFlags = 0;
+        uint64_t sourceHash = 0;
+        float scale = 0.0f;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+        uint32_t submeshCount = 0;
+        uint32_t stringSize = 0;
+        uint32_t padding = 0;
+        uint64_t vertexOffset = 0;
+        uint64_t indexOffset = 0;
+        uint64_t submeshOffset = 0;
+        uint64_t stringOffset = 0;
+        uint64_t fileSize = 0;
+    };
+
+    // Material names live in the string table as offset and length pairs, in the order
+    // diffuse, normal, displacement.
+    struct SubmeshRecord {
+        uint32_t indexCount = 0;
+        uint32_t startIndex = 0;
+        uint32_t startVertex = 0;
+        float shininess = 0.0f;
+        uint32_t alphaTested = 0;
+        BoundingBox bounds = {};
+        BoundingSphere sphereBounds = {};
+        BoundingOrientedBox orientedBounds = {};
+        uint32_t nameOffsets[MATERIAL_NAME_COUNT] = {};
+        uint32_t nameSizes[MATERIAL_NAME_COUNT] = {};
+    };
+
+    uint64_t alignOffset(uint64_t offset) {
+        return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+    }
+
+    bool hashFile(const std::string& fileName, uint64_t& hash) {
+        MappedFile file;
+        if (!file.open(fileName)) {
+            return false;
+        }
+
+        const uint8_t* data = file.getData();
+        for (size_t i = 0; i < file.getSize(); ++i) {
+            hash = (hash ^ data[i]) * FNV_PRIME;
+        }
+        return true;
+    }
+
+    template <typename MaterialType>
+    auto& getMaterialName(MaterialType& material, size_t name) {
+        switch (name) {
+        case 0:
+            return material.diffuseTextureName;
+        case 1:
+            return material.normalTextureName;
+        default:
+            return material.displacementTextureName;
+        }
+    }
+
+    const FileHeader& getHeader(const MappedFile& file) {
+        return *reinterpret_cast<const FileHeader*>(file.getData());
+    }
+}
+
+bool MeshCache::computeKey(const std::string& sourceFileName, float scale, uint32_t postProcessFlags, Key& key) {
+    key = {};
+    key.scale = scale;
+    key.postProcessFlags = postProcessFlags;
+    key.sourceHash = FNV_OFFSET_BASIS;
+    if (!hashFile(sourceFileName, key.sourceHash)) {
+        return false;
+    }
+
+    std::filesystem::path materialLibrary(sourceFileName);
+    if (materialLibrary.extension() == ".obj") {
+        materialLibrary.replace_extension(".mtl");
+        hashFile(materialLibrary.string(), key.sourceHash);
+    }
+    return true;
+}
+
+bool MeshCache::save(const std::string& fileName, const Key& key, const MeshData& mesh) {
+    std::string strings;
+    std::vector<SubmeshRecord> records;
+    records.reserve(mesh.submeshes.size());
+    for (const Submesh& submesh : mesh.submeshes) {
+        SubmeshRecord record;
+        record.indexCount = submesh.indexCount;
+        record.startIndex = submesh.startIndiceIndex;
+        record.startVertex = submesh.startVerticeIndex;
+        record.shininess = submesh.material.shininess;
+        record.alphaTested = submesh.material.alphaTested ? 1 : 0;
+        record.bounds = submesh.bounds;
+        record.sphereBounds = submesh.sphereBounds;
+        record.orientedBounds = submesh.orientedBounds;
+
+        for (size_t name = 0; name < MATERIAL_NAME_COUNT; ++name) {
+            const std::string& value = getMaterialName(submesh.material, name);
+            record.nameOffsets[name] = static_cast<uint32_t>(strings.size());
+            record.nameSizes[name] = static_cast<uint32_t>(value.size());
+            strings += value;
+        }
+        records.push_back(record);
+    }
+
+    FileHeader header;
+    header.postProcessFlags = key.postProcessFlags;
+    header.sourceHash = key.sourceHash;
+    header.scale = key.scale;
+    header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    header.submeshCount = static_cast<uint32_t>(records.size());
+    header.stringSize = static_cast<uint32_t>(strings.size());
+    header.vertexOffset = alignOffset(sizeof(FileHeader));
+    header.indexOffset = alignOffset(header.vertexOffset + mesh.vertices.size() * sizeof(Vertex));
+    header.submeshOffset = alignOffset(header.indexOffset + mesh.indices.size() * sizeof(uint32_t));
+    header.stringOffset = header.submeshOffset + records.size() * sizeof(SubmeshRecord);
+    header.fileSize = header.stringOffset + strings.size();
+
+    std::ofstream out(fileName, std::ios::binary);
+    const auto writeSection = [&out](uint64_t offset, const void* data, size_t size) {
+        static const char zeros[SECTION_ALIGNMENT] = {};
+        const uint64_t position = static_cast<uint64_t>(out.tellp());
+        out.write(zeros, static_cast<std::streamsize>(offset - position));
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeSection(header.vertexOffset, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+    writeSection(header.indexOffset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+    writeSection(header.submeshOffset, records.data(), records.size() * sizeof(SubmeshRecord));
+    writeSection(header.stringOffset, strings.data(), strings.size());
+    return static_cast<bool>(out);
+}
+
+bool MeshCache::open(const std::string& fileName, const Key& key) {
+    if (!mFile.open(fileName) || mFile.getSize() < sizeof(FileHeader)) {
+        close();
+        return false;
+    }
+
+    const FileHeader& header = getHeader(mFile);
+    const bool valid = header.magic == FILE_MAGIC && header.version == FILE_VERSION &&
+        header.vertexStride == sizeof(Vertex) && header.sourceHash == key.sourceHash &&
+        header.scale == key.scale && header.postProcessFlags == key.postProcessFlags &&
+        header.fileSize == mFile.getSize() &&
+        header.vertexOffset % SECTION_ALIGNMENT == 0 && header.indexOffset % SECTION_ALIGNMENT == 0 &&
+        header.submeshOffset % SECTION_ALIGNMENT == 0 &&
+        header.vertexOffset + static_cast<uint64_t>(header.vertexCount) * sizeof(Vertex) <= header.indexOffset &&
+        header.indexOffset + static_cast<uint64_t>(header.indexCount) * sizeof(uint32_t) <= header.submeshOffset &&
+        header.submeshOffset + static_cast<uint64_t>(header.submeshCount) * sizeof(SubmeshRecord) <= header.stringOffset &&
+        header.stringOffset + header.stringSize <= header.fileSize;
+    if (!valid) {
+        close();
+        return false;
+    }
+
+    const SubmeshRecord* records = reinterpret_cast<const SubmeshRecord*>(mFile.getData() + header.submeshOffset);
+    for (uint32_t i = 0; i < header.submeshCount; ++i) {
+        const SubmeshRecord& record = records[i];
+        bool recordValid = static_cast<uint64_t>(record.startIndex) + record.indexCount <= header.indexCount &&
+            record.startVertex <= header.vertexCount;
+        for (size_t name = 0; name < MATERIAL_NAME_COUNT; ++name) {
+            recordValid = recordValid && static_cast<uint64_t>(record.nameOffsets[name]) + record.nameSizes[name] <= header.stringSize;
+        }
+        if (!recordValid) {
+            close();
+            return false;
+        }
+    }
+
+    // The index section goes to the GPU as is, so an out of range index would read past the
+    // vertex buffer instead of failing here.
+    const uint32_t* indices = getIndices();
+    for (uint32_t i = 0; i < header.indexCount; ++i) {
+        if (indices[i] >= header.vertexCount) {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void MeshCache::close() {
+    mFile.close();
+}
+
+const Vertex* MeshCache::getVertices() const {
+    return reinterpret_cast<const Vertex*>(mFile.getData() + getHeader(mFile).vertexOffset);
+}
+
+size_t MeshCache::getVertexCount() const {
+    return getHeader(mFile).vertexCount;
+}
+
+const uint32_t* MeshCache::getIndices() const {
+    return reinterpret_cast<const uint32_t*>(mFile.getData() + getHeader(mFile).indexOffset);
+}
+
+size_t MeshCache::getIndexCount() const {
+    return getHeader(mFile).indexCount;
+}
+
+MeshData MeshCache::createMeshData() const {
+    MeshData mesh;
+    if (!isOpen()) {
+        return mesh;
+    }
+
+    const FileHeader& header = getHeader(mFile);
+    mesh.vertices.assign(getVertices(), getVertices() + header.vertexCount);
+    mesh.indices.assign(getIndices(), getIndices() + header.indexCount);
+
+    const SubmeshRecord* records = reinterpret_cast<const SubmeshRecord*>(mFile.getData() + header.submeshOffset);
+    const char* strings = reinterpret_cast<const char*>(mFile.getData() + header.stringOffset);
+    mesh.submeshes.resize(header.submeshCount);
+    for (uint32_t i = 0; i < header.submeshCount; ++i) {
+        const SubmeshRecord& record = records[i];
+        Submesh& submesh = mesh.submeshes[i];
+        submesh.indexCount = record.indexCount;
+        submesh.startIndiceIndex = record.startIndex;
+        submesh.startVerticeIndex = record.startVertex;
+        submesh.bounds = record.bounds;
+        submesh.sphereBounds = record.sphereBounds;
+        submesh.orientedBounds = record.orientedBounds;
+        submesh.material.shininess = record.shininess;
+        submesh.material.alphaTested = record.alphaTested != 0;
+        for (size_t name = 0; name < MATERIAL_NAME_COUNT; ++name) {
+            getMaterialName(submesh.material, name).assign(strings + record.nameOffsets[name], record.nameSizes[name]);
+        }
+    }
+    return mesh;
+}
\ No newline at end of file
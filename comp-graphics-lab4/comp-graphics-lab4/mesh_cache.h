@@ -0,0 +1,48 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "mapped_file.h"
+#include "mesh_data.h"
+
+#include <cstdint>
+#include <string>
+
+// Binary snapshot of a loaded MeshData, so later launches skip Assimp and its post-processing.
+// The vertex and index arrays are stored exactly as the GPU buffers expect them, and the file
+// is memory mapped: nothing is parsed, and the payload can be copied straight into an upload
+// buffer. A cache is only used when its key matches the source file contents and the loader
+// parameters it was written with.
+class MeshCache {
+public:
+    static constexpr uint32_t FILE_VERSION = 3;
+
+    struct Key {
+        uint64_t sourceHash = 0;
+        float scale = 1.0f;
+        uint32_t postProcessFlags = 0;
+    };
+
+    // Hashes the source file and, for OBJ files, the material library next to it, since the
+    // material names come from there. Returns false when the source cannot be read.
+    static bool computeKey(const std::string& sourceFileName, float scale, uint32_t postProcessFlags, Key& key);
+
+    static bool save(const std::string& fileName, const Key& key, const MeshData& mesh);
+
+    // Maps the cache and checks its header, key, section sizes and submesh ranges, and that
+    // every index refers to a stored vertex.
+    bool open(const std::string& fileName, const Key& key);
+    void close();
+
+    bool isOpen() const { return mFile.isOpen(); }
+    const Vertex* getVertices() const;
+    size_t getVertexCount() const;
+    const uint32_t* getIndices() const;
+    size_t getIndexCount() const;
+
+    MeshData createMeshData() const;
+
+private:
+    MappedFile mFile;
+};
+
+#endif // MESH_CACHE_H
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include "mesh_culling_benchmark.h"
+#include "bounding_volumes.h"
+#include "mesh_data.h"
+#include "occlusion_culler.h"
+#include "scene_occluders.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+using namespace DirectX;
+
+namespace {
+    constexpr size_t QUERY_REPEAT_COUNT = 8;
+    // Matches the projection BoxApp::onResize builds.
+    constexpr float FOV_Y = 0.25f * XM_PI;
+    constexpr float ASPECT_RATIO = 16.0f / 9.0f;
+    constexpr float NEAR_Z = 1.0f;
+    constexpr float FAR_Z = 1000.0f;
+    // Matches BoxApp's occluder setup.
+    constexpr float OCCLUDER_MIN_TRIANGLE_AREA = 0.01f;
+    // The reference depth buffer has this many times the culler's resolution per axis.
+    constexpr uint32_t REFERENCE_RESOLUTION_SCALE = 4;
+
+    using Clock = std::chrono::steady_clock;
+
+    enum class VolumeStage {
+        AxisAlignedBox,
+        Sphere,
+        SphereThenOrientedBox,
+    };
+
+    struct VolumeStageResult {
+        const char* name;
+        VolumeStage stage;
+        size_t accepted = 0;
+        size_t falsePositives = 0;
+        size_t falseNegatives = 0;
+        double nanosecondsPerTest = 0.0;
+    };
+
+    bool acceptsSubmesh(VolumeStage stage, const BoundingFrustum& frustum, const Submesh& submesh) {
+        if (!frustum.Intersects(submesh.bounds)) {
+            return false;
+        }
+        switch (stage) {
+        case VolumeStage::Sphere:
+            return frustum.Intersects(submesh.sphereBounds);
+        case VolumeStage::SphereThenOrientedBox:
+            return intersectsTightBounds(frustum, submesh);
+        default:
+            return true;
+        }
+    }
+
+    bool intersectsTriangles(const BoundingFrustum& frustum, const MeshData& mesh, const Submesh& submesh) {
+        for (UINT i = 0; i + 2 < submesh.indexCount; i += 3) {
+            const uint32_t* triangle = &mesh.indices[submesh.startIndiceIndex + i];
+            if (frustum.Intersects(XMLoadFloat3(&mesh.vertices[triangle[0]].position),
+                XMLoadFloat3(&mesh.vertices[triangle[1]].position), XMLoadFloat3(&mesh.vertices[triangle[2]].position))) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+void runBoundingVolumeBenchmark(const MeshData& mesh, const std::vector<CameraPose>& path,
+    std::ostream& out, ThreadPool* threadPool) {
+    // ModelLoader fits the spheres and oriented boxes while parsing.
+    const std::vector<Submesh>& submeshes = mesh.submeshes;
+
+    std::vector<BoundingFrustum> frustums;
+    frustums.reserve(path.size());
+    for (const auto& pose : path) {
+        frustums.push_back(createCameraFrustum(pose, FOV_Y, ASPECT_RATIO, NEAR_Z, FAR_Z));
+    }
+
+    // Triangle-exact visibility is only needed where the axis-aligned box passes, since every
+    // other stage is stricter than it.
+    std::vector<std::vector<char>> exactVisibility(frustums.size());
+    std::vector<size_t> sphereSettled(frustums.size(), 0);
+    ThreadPool::run(threadPool, frustums.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t pose = begin; pose < end; ++pose) {
+            std::vector<char>& visible = exactVisibility[pose];
+            visible.assign(submeshes.size(), 0);
+            for (size_t i = 0; i < submeshes.size(); ++i) {
+                if (frustums[pose].Intersects(submeshes[i].bounds)) {
+                    visible[i] = intersectsTriangles(frustums[pose], mesh, submeshes[i]) ? 1 : 0;
+                    sphereSettled[pose] += frustums[pose].Contains(submeshes[i].sphereBounds) != INTERSECTS;
+                }
+            }
+        }
+    });
+
+    size_t exactVisibleCount = 0;
+    size_t sphereSettledCount = 0;
+    for (size_t pose = 0; pose < frustums.size(); ++pose) {
+        for (char visible : exactVisibility[pose]) {
+            exactVisibleCount += visible;
+        }
+        sphereSettledCount += sphereSettled[pose];
+    }
+
+    VolumeStageResult results[] = {
+        { "aabb", VolumeStage::AxisAlignedBox },
+        { "aabb_sphere", VolumeStage::Sphere },
+        { "aabb_sphere_obb", VolumeStage::SphereThenOrientedBox },
+    };
+
+    const double testCount = std::max<double>(static_cast<double>(frustums.size() * submeshes.size()), 1.0);
+    for (auto& result : results) {
+        size_t acceptedSum = 0;
+        const Clock::time_point start = Clock::now();
+        for (size_t repeat = 0; repeat < QUERY_REPEAT_COUNT; ++repeat) {
+            for (const auto& frustum : frustums) {
+                for (const auto& submesh : submeshes) {
+                    acceptedSum += acceptsSubmesh(result.stage, frustum, submesh);
+                }
+            }
+        }
+        result.nanosecondsPerTest = std::chrono::duration<double, std::nano>(Clock::now() - start).count() /
+            (QUERY_REPEAT_COUNT * testCount);
+        result.accepted = acceptedSum / QUERY_REPEAT_COUNT;
+
+        for (size_t pose = 0; pose < frustums.size(); ++pose) {
+            for (size_t i = 0; i < submeshes.size(); ++i) {
+                const bool accepted = acceptsSubmesh(result.stage, frustums[pose], submeshes[i]);
+                result.falsePositives += accepted && !exactVisibility[pose][i];
+                result.falseNegatives += !accepted && exactVisibility[pose][i];
+            }
+        }
+    }
+
+    const double poseCount = std::max<double>(static_cast<double>(path.size()), 1.0);
+    const double baseFalsePositives = std::max<double>(static_cast<double>(results[0].falsePositives), 1.0);
+    out << "{\n";
+    out << "  \"submeshes\": " << submeshes.size() << ",\n";
+    out << "  \"poses\": " << path.size() << ",\n";
+    out << "  \"exact_visible_per_query\": " << exactVisibleCount / poseCount << ",\n";
+    out << "  \"sphere_settled_fraction\": "
+        << static_cast<double>(sphereSettledCount) / std::max<double>(static_cast<double>(results[0].accepted), 1.0) << ",\n";
+    out << "  \"stages\": [\n";
+
+    for (size_t i = 0; i < std::size(results); ++i) {
+        const VolumeStageResult& result = results[i];
+        out << "    {\n";
+        out << "      \"name\": \"" << result.name << "\",\n";
+        out << "      \"ns_per_test\": " << result.nanosecondsPerTest << ",\n";
+        out << "      \"accepted_per_query\": " << result.accepted / poseCount << ",\n";
+        out << "      \"false_positives_per_query\": " << result.falsePositives / poseCount << ",\n";
+        out << "      \"false_positive_reduction\": " << 1.0 - result.falsePositives / baseFalsePositives << ",\n";
+        out << "      \"false_negatives\": " << result.falseNegatives << "\n";
+        out << "    }" << (i + 1 < std::size(results) ? "," : "") << "\n";
+    }
+
+    out << "  ]\n";
+    out << "}\n";
+}
+
+void runOcclusionBenchmark(const MeshData& mesh, const std::vector<CameraPose>& path,
+    std::ostream& out, ThreadPool* threadPool) {
+    const std::vector<Submesh>& submeshes = mesh.submeshes;
+    XMFLOAT4X4 identity;
+    XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+    // The culler gets the occluders BoxApp gives it. The reference renders every occluder
+    // triangle at a higher resolution, so it may only hide more than the culler does.
+    OcclusionCuller culler;
+    OcclusionCuller reference(culler.getWidth() * REFERENCE_RESOLUTION_SCALE, culler.getHeight() * REFERENCE_RESOLUTION_SCALE);
+    for (const auto& submesh : submeshes) {
+        if (isOccluderSubmesh(submesh)) {
+            culler.addOccluder(createOccluder(mesh, submesh, identity, OCCLUDER_MIN_TRIANGLE_AREA));
+            reference.addOccluder(createOccluder(mesh, submesh, identity));
+        }
+    }
+
+    size_t frustumVisibleCount = 0;
+    size_t occludedCount = 0;
+    size_t occludedExactVisibleCount = 0;
+    size_t falseNegatives = 0;
+    size_t rasterizedTriangleCount = 0;
+    double renderMicroseconds = 0.0;
+    double maxRenderMicroseconds = 0.0;
+    double visibilityTestNanoseconds = 0.0;
+    std::vector<size_t> frustumVisible;
+    std::vector<char> occluded;
+
+    for (const auto& pose : path) {
+        const BoundingFrustum frustum = createCameraFrustum(pose, FOV_Y, ASPECT_RATIO, NEAR_Z, FAR_Z);
+        const XMFLOAT4X4 viewProj = createCameraViewProj(pose, FOV_Y, ASPECT_RATIO, NEAR_Z, FAR_Z);
+
+        frustumVisible.clear();
+        for (size_t i = 0; i < submeshes.size(); ++i) {
+            if (frustum.Intersects(submeshes[i].bounds)) {
+                frustumVisible.push_back(i);
+            }
+        }
+        frustumVisibleCount += frustumVisible.size();
+
+        Clock::time_point start = Clock::now();
+        culler.render(viewProj, threadPool);
+        const double poseRenderMicroseconds = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        renderMicroseconds += poseRenderMicroseconds;
+        maxRenderMicroseconds = std::max(maxRenderMicroseconds, poseRenderMicroseconds);
+        rasterizedTriangleCount += culler.getRasterizedTriangleCount();
+
+        occluded.assign(frustumVisible.size(), 0);
+        start = Clock::now();
+        for (size_t k = 0; k < frustumVisible.size(); ++k) {
+            occluded[k] = culler.isVisible(submeshes[frustumVisible[k]].bounds) ? 0 : 1;
+        }
+        visibilityTestNanoseconds += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+        // A culled submesh with a triangle in the frustum is a false negative when even the
+        // reference depth buffer cannot hide its box.
+        reference.render(viewProj, threadPool);
+        for (size_t k = 0; k < frustumVisible.size(); ++k) {
+            if (!occluded[k]) {
+                continue;
+            }
+            ++occludedCount;
+            const Submesh& submesh = submeshes[frustumVisible[k]];
+            if (intersectsTriangles(frustum, mesh, submesh)) {
+                ++occludedExactVisibleCount;
+                falseNegatives += reference.isVisible(submesh.bounds);
+            }
+        }
+    }
+
+    const double poseCount = std::max<double>(static_cast<double>(path.size()), 1.0);
+    out << "{\n";
+    out << "  \"submeshes\": " << submeshes.size() << ",\n";
+    out << "  \"poses\": " << path.size() << ",\n";
+    out << "  \"depth_buffer\": [" << culler.getWidth() << ", " << culler.getHeight() << "],\n";
+    out << "  \"occluder_triangles\": " << culler.getOccluderTriangleCount() << ",\n";
+    out << "  \"reference_occluder_triangles\": " << reference.getOccluderTriangleCount() << ",\n";
+    out << "  \"frustum_visible_per_query\": " << frustumVisibleCount / poseCount << ",\n";
+    out << "  \"occluded_per_query\": " << occludedCount / poseCount << ",\n";
+    out << "  \"occluded_fraction\": "
+        << static_cast<double>(occludedCount) / std::max<double>(static_cast<double>(frustumVisibleCount), 1.0) << ",\n";
+    out << "  \"rasterized_triangles_per_query\": " << rasterizedTriangleCount / poseCount << ",\n";
+    out << "  \"render_us_per_query\": " << renderMicroseconds / poseCount << ",\n";
+    out << "  \"max_render_us\": " << maxRenderMicroseconds << ",\n";
+    out << "  \"ns_per_visibility_test\": "
+        << visibilityTestNanoseconds / std::max<double>(static_cast<double>(frustumVisibleCount), 1.0) << ",\n";
+    out << "  \"occluded_exact_visible_per_query\": " << occludedExactVisibleCount / poseCount << ",\n";
+    out << "  \"false_negatives\": " << falseNegatives << "\n";
+    out << "}\n";
+}
\ No newline at end of file
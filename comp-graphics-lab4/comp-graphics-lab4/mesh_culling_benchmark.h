@@ -0,0 +1,27 @@
+#ifndef MESH_CULLING_BENCHMARK_H
+#define MESH_CULLING_BENCHMARK_H
+
+#include "camera_path.h"
+
+#include <ostream>
+#include <vector>
+
+struct MeshData;
+class ThreadPool;
+
+// Replays the camera path against every submesh's axis-aligned box and against the sphere and
+// oriented box stage that follows it, and writes JSON with the submeshes each stage accepts,
+// its false positives against triangle-exact frustum visibility and the time per test.
+void runBoundingVolumeBenchmark(const MeshData& mesh, const std::vector<CameraPose>& path,
+    std::ostream& out, ThreadPool* threadPool = nullptr);
+
+// Replays the camera path through OcclusionCuller with the occluders BoxApp uses, testing the
+// submeshes whose boxes intersect the frustum, and writes JSON with how many of them it
+// occludes and the time spent in render and isVisible. Occluded submeshes that are
+// triangle-exact visible in the frustum are checked against a reference depth buffer holding
+// every occluder triangle at four times the resolution; those it cannot hide either are
+// reported as false negatives.
+void runOcclusionBenchmark(const MeshData& mesh, const std::vector<CameraPose>& path,
+    std::ostream& out, ThreadPool* threadPool = nullptr);
+
+#endif // MESH_CULLING_BENCHMARK_H
\ No newline at end of file
@@ -11,6 +11,8 @@ struct Material {
     Vector4 ambientColor;
     Vector4 specularColor;
     float shininess;
+    // Has an opacity map, so its pixels are clipped and it cannot be drawn depth-only.
+    bool alphaTested = false;
 
     UINT diffuseSrvHeapIndex = 0;
     UINT normalSrvHeapIndex = 0;
@@ -20,20 +22,50 @@ struct Material {
     std::string displacementTextureName;
 };
 
+// A cluster of triangles drawn as one contiguous index range. The normal cone bounds the
+// triangle normals so a cluster whose triangles all face away from the eye can be skipped.
+struct Meshlet {
+    UINT startIndex = 0;
+    UINT indexCount = 0;
+    DirectX::BoundingSphere bounds = {};
+    DirectX::XMFLOAT3 coneApex = { 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT3 coneAxis = { 0.0f, 0.0f, 0.0f };
+    // The cone test is disabled when the cutoff is 1 or more.
+    float coneCutoff = 1.0f;
+};
+
 struct Submesh {
     UINT indexCount = 0;
     UINT startIndiceIndex = 0;
     UINT startVerticeIndex = 0;
     DirectX::BoundingBox bounds = {};
+    DirectX::BoundingSphere sphereBounds = {};
+    DirectX::BoundingOrientedBox orientedBounds = {};
+    // Position range of the quantized vertex format. It spans the whole mesh, so every submesh
+    // carries the same range.
+    DirectX::XMFLOAT3 positionOrigin = { 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT3 positionExtent = { 1.0f, 1.0f, 1.0f };
     Material material;
     UINT objectCbvHeapIndex = 0;
     float maxTessellationFactor = 10.0f;
+    UINT firstMeshlet = 0;
+    UINT meshletCount = 0;
+    // Placement of the indices in the GPU index pools, see index_pools.h.
+    UINT baseVertex = 0;
+    UINT poolStartIndex = 0;
+    bool shortIndices = false;
 };
 
+// Column submeshes are displaced in the vertex shader, so their vertex positions are not final.
+inline bool isColumnSubmesh(const Submesh& submesh) {
+    return submesh.material.diffuseTextureName.find("column") != std::string::npos;
+}
+
 struct MeshData {
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
     std::vector<Submesh> submeshes;
+    std::vector<Meshlet> meshlets;
 };
 
 #endif // MESH_DATA_H
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "meshlet_benchmark.h"
+#include "camera_path.h"
+#include "meshlet_builder.h"
+#include "meshlet_culler.h"
+
+#include <chrono>
+#include <iomanip>
+
+using namespace DirectX;
+
+namespace {
+    constexpr size_t CAMERA_POSE_COUNT = 64;
+    constexpr float FOV_Y = 0.25f * XM_PI;
+    constexpr float ASPECT_RATIO = 16.0f / 9.0f;
+    constexpr float NEAR_Z = 1.0f;
+    constexpr float FAR_Z = 1000.0f;
+}
+
+void runMeshletBenchmark(MeshData& mesh, std::ostream& out) {
+    if (mesh.submeshes.empty()) {
+        return;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point buildStart = Clock::now();
+    MeshletBuilder builder;
+    for (size_t i = 0; i < mesh.submeshes.size(); ++i) {
+        builder.build(mesh, i);
+    }
+    const double buildMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - buildStart).count();
+
+    std::vector<BoundingBox> submeshBounds;
+    for (size_t i = 0; i < mesh.submeshes.size(); ++i) {
+        const Submesh& submesh = mesh.submeshes[i];
+        const size_t vertexEnd = (i + 1 < mesh.submeshes.size()) ? mesh.submeshes[i + 1].startVerticeIndex : mesh.vertices.size();
+
+        BoundingBox bounds;
+        BoundingBox::CreateFromPoints(bounds, vertexEnd - submesh.startVerticeIndex,
+            &mesh.vertices[submesh.startVerticeIndex].position, sizeof(Vertex));
+        submeshBounds.push_back(bounds);
+    }
+
+    BoundingBox sceneBounds = submeshBounds.front();
+    for (const auto& bounds : submeshBounds) {
+        BoundingBox::CreateMerged(sceneBounds, sceneBounds, bounds);
+    }
+
+    MeshletCuller culler;
+    std::vector<MeshletCuller::IndexRange> ranges;
+    MeshletCuller::Stats total;
+    size_t rangeCount = 0;
+    size_t visibleSubmeshCount = 0;
+    double cullMicroseconds = 0.0;
+
+    const std::vector<CameraPose> path = createOrbitCameraPath(sceneBounds, CAMERA_POSE_COUNT);
+    for (const auto& pose : path) {
+        const BoundingFrustum frustum = createCameraFrustum(pose, FOV_Y, ASPECT_RATIO, NEAR_Z, FAR_Z);
+
+        const Clock::time_point cullStart = Clock::now();
+        culler.setView(frustum, pose.position);
+        ranges.clear();
+        for (size_t i = 0; i < mesh.submeshes.size(); ++i) {
+            if (frustum.Intersects(submeshBounds[i])) {
+                culler.cull(mesh.meshlets, mesh.submeshes[i], ranges);
+                ++visibleSubmeshCount;
+            }
+        }
+        cullMicroseconds += std::chrono::duration<double, std::micro>(Clock::now() - cullStart).count();
+
+        const MeshletCuller::Stats& stats = culler.getStats();
+        total.meshletsTested += stats.meshletsTested;
+        total.frustumCulled += stats.frustumCulled;
+        total.coneCulled += stats.coneCulled;
+        total.trianglesSubmitted += stats.trianglesSubmitted;
+        total.trianglesDrawn += stats.trianglesDrawn;
+        rangeCount += ranges.size();
+    }
+
+    const double poseCount = static_cast<double>(path.size());
+    out << std::fixed << std::setprecision(1);
+    out << "meshlets: " << mesh.meshlets.size() << " over " << mesh.submeshes.size() << " submeshes, built in " <<
+        buildMilliseconds << " ms\n";
+    out << "camera poses: " << path.size() << "\n";
+    out << "per pose averages\n";
+
+    auto report = [&](const char* name, double value) {
+        out << "  " << std::left << std::setw(26) << name << std::right << value << "\n";
+    };
+    report("visible submeshes", visibleSubmeshCount / poseCount);
+    report("triangles before", total.trianglesSubmitted / poseCount);
+    report("triangles after", total.trianglesDrawn / poseCount);
+    report("meshlets tested", total.meshletsTested / poseCount);
+    report("meshlets frustum culled", total.frustumCulled / poseCount);
+    report("meshlets cone culled", total.coneCulled / poseCount);
+    report("draw ranges", rangeCount / poseCount);
+    report("cull time us", cullMicroseconds / poseCount);
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#ifndef MESHLET_BENCHMARK_H
+#define MESHLET_BENCHMARK_H
+
+#include <ostream>
+
+struct MeshData;
+
+// Splits every submesh into meshlets, replays the orbit camera path and reports how many
+// triangles frustum-visible submeshes submit with and without meshlet culling.
+void runMeshletBenchmark(MeshData& mesh, std::ostream& out);
+
+#endif // MESHLET_BENCHMARK_H
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "meshlet_builder.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace {
+    constexpr uint32_t MORTON_AXIS_CELLS = 1024;
+    constexpr unsigned DIRECTION_SHIFT = 30;
+    // Below this the cone would cover nearly a hemisphere and almost never cull anything.
+    constexpr float MIN_CONE_DOT = 0.1f;
+
+    uint32_t expandBits(uint32_t value) {
+        uint32_t x = value & 0x3FFu;
+        x = (x | x << 16) & 0x030000FFu;
+        x = (x | x << 8) & 0x0300F00Fu;
+        x = (x | x << 4) & 0x030C30C3u;
+        x = (x | x << 2) & 0x09249249u;
+        return x;
+    }
+
+    uint32_t quantize(float value, float origin, float scale) {
+        const float cell = (value - origin) * scale;
+        if (!(cell > 0.0f)) {
+            return 0;
+        }
+        return std::min(static_cast<uint32_t>(cell), MORTON_AXIS_CELLS - 1);
+    }
+
+    // Index of the face of the unit cube the normal points through.
+    uint32_t getDirectionBucket(const XMFLOAT3& normal) {
+        const float ax = std::fabs(normal.x);
+        const float ay = std::fabs(normal.y);
+        const float az = std::fabs(normal.z);
+        if (ax >= ay && ax >= az) {
+            return normal.x < 0.0f ? 1 : 0;
+        }
+        if (ay >= az) {
+            return normal.y < 0.0f ? 3 : 2;
+        }
+        return normal.z < 0.0f ? 5 : 4;
+    }
+
+    // Unnormalized normal of the front face; the pipeline treats clockwise triangles as front facing.
+    XMVECTOR getTriangleNormal(const XMVECTOR& p0, const XMVECTOR& p1, const XMVECTOR& p2) {
+        return XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+    }
+}
+
+MeshletBuilder::MeshletBuilder(size_t maxTriangles) : mMaxTriangles(std::max<size_t>(maxTriangles, 1)) {
+}
+
+void MeshletBuilder::build(MeshData& mesh, size_t submeshIndex) {
+    Submesh& submesh = mesh.submeshes[submeshIndex];
+    submesh.firstMeshlet = static_cast<UINT>(mesh.meshlets.size());
+    submesh.meshletCount = 0;
+
+    const size_t triangleCount = submesh.indexCount / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    uint32_t* indices = &mesh.indices[submesh.startIndiceIndex];
+    auto loadPosition = [&](uint32_t index) {
+        return XMLoadFloat3(&mesh.vertices[index].position);
+    };
+
+    XMVECTOR centroidMin = XMVectorReplicate(FLT_MAX);
+    XMVECTOR centroidMax = XMVectorReplicate(-FLT_MAX);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+        const uint32_t* corner = &indices[triangle * 3];
+        const XMVECTOR centroid = XMVectorScale(
+            XMVectorAdd(XMVectorAdd(loadPosition(corner[0]), loadPosition(corner[1])), loadPosition(corner[2])), 1.0f / 3.0f);
+        centroidMin = XMVectorMin(centroidMin, centroid);
+        centroidMax = XMVectorMax(centroidMax, centroid);
+    }
+
+    XMFLOAT3 origin;
+    XMFLOAT3 size;
+    XMStoreFloat3(&origin, centroidMin);
+    XMStoreFloat3(&size, XMVectorSubtract(centroidMax, centroidMin));
+    const float scale = static_cast<float>(MORTON_AXIS_CELLS) / std::max({ size.x, size.y, size.z, FLT_MIN });
+
+    mTriangleKeys.resize(triangleCount);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+        const uint32_t* corner = &indices[triangle * 3];
+        const XMVECTOR p0 = loadPosition(corner[0]);
+        const XMVECTOR p1 = loadPosition(corner[1]);
+        const XMVECTOR p2 = loadPosition(corner[2]);
+
+        XMFLOAT3 centroid;
+        XMFLOAT3 normal;
+        XMStoreFloat3(&centroid, XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), 1.0f / 3.0f));
+        XMStoreFloat3(&normal, getTriangleNormal(p0, p1, p2));
+
+        const uint32_t morton = (expandBits(quantize(centroid.x, origin.x, scale)) << 2) |
+            (expandBits(quantize(centroid.y, origin.y, scale)) << 1) |
+            expandBits(quantize(centroid.z, origin.z, scale));
+        const uint64_t key = (static_cast<uint64_t>(getDirectionBucket(normal)) << DIRECTION_SHIFT) | morton;
+        mTriangleKeys[triangle] = (key << 32) | triangle;
+    }
+
+    std::sort(mTriangleKeys.begin(), mTriangleKeys.end());
+
+    mReorderedIndices.clear();
+    mReorderedIndices.reserve(submesh.indexCount);
+
+    size_t meshletBegin = 0;
+    while (meshletBegin < triangleCount) {
+        const uint64_t direction = mTriangleKeys[meshletBegin] >> (32 + DIRECTION_SHIFT);
+        size_t meshletEnd = meshletBegin + 1;
+        while (meshletEnd < triangleCount && meshletEnd - meshletBegin < mMaxTriangles &&
+            (mTriangleKeys[meshletEnd] >> (32 + DIRECTION_SHIFT)) == direction) {
+            ++meshletEnd;
+        }
+
+        // Inside a meshlet the original order is kept, since the loader already optimized it
+        // for the post-transform vertex cache.
+        mMeshletTriangles.clear();
+        for (size_t i = meshletBegin; i < meshletEnd; ++i) {
+            mMeshletTriangles.push_back(static_cast<uint32_t>(mTriangleKeys[i]));
+        }
+        std::sort(mMeshletTriangles.begin(), mMeshletTriangles.end());
+
+        const UINT startIndex = submesh.startIndiceIndex + static_cast<UINT>(mReorderedIndices.size());
+        for (uint32_t triangle : mMeshletTriangles) {
+            mReorderedIndices.insert(mReorderedIndices.end(), &indices[triangle * 3], &indices[triangle * 3 + 3]);
+        }
+
+        appendMeshlet(mesh, &mReorderedIndices[startIndex - submesh.startIndiceIndex], startIndex);
+        meshletBegin = meshletEnd;
+    }
+
+    std::copy(mReorderedIndices.begin(), mReorderedIndices.end(), indices);
+    submesh.meshletCount = static_cast<UINT>(mesh.meshlets.size()) - submesh.firstMeshlet;
+}
+
+// Fits the bounding sphere and the normal cone. The cone apex is pushed back along the axis
+// until it lies behind every triangle plane, which makes the backface test exact for any
+// eye position instead of only for distant ones.
+void MeshletBuilder::appendMeshlet(MeshData& mesh, const uint32_t* indices, UINT startIndex) {
+    Meshlet meshlet;
+    meshlet.startIndex = startIndex;
+    meshlet.indexCount = static_cast<UINT>(mMeshletTriangles.size() * 3);
+
+    mPositions.clear();
+    for (UINT i = 0; i < meshlet.indexCount; ++i) {
+        mPositions.push_back(mesh.vertices[indices[i]].position);
+    }
+    BoundingSphere::CreateFromPoints(meshlet.bounds, mPositions.size(), mPositions.data(), sizeof(XMFLOAT3));
+
+    XMVECTOR normalSum = XMVectorZero();
+    for (UINT i = 0; i < meshlet.indexCount; i += 3) {
+        const XMVECTOR normal = getTriangleNormal(XMLoadFloat3(&mPositions[i]), XMLoadFloat3(&mPositions[i + 1]), XMLoadFloat3(&mPositions[i + 2]));
+        if (XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f) {
+            normalSum = XMVectorAdd(normalSum, XMVector3Normalize(normal));
+        }
+    }
+
+    if (!(XMVectorGetX(XMVector3LengthSq(normalSum)) > 0.0f)) {
+        mesh.meshlets.push_back(meshlet);
+        return;
+    }
+
+    const XMVECTOR axis = XMVector3Normalize(normalSum);
+    float minDot = 1.0f;
+    for (UINT i = 0; i < meshlet.indexCount; i += 3) {
+        const XMVECTOR normal = getTriangleNormal(XMLoadFloat3(&mPositions[i]), XMLoadFloat3(&mPositions[i + 1]), XMLoadFloat3(&mPositions[i + 2]));
+        if (XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f) {
+            minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(axis, XMVector3Normalize(normal))));
+        }
+    }
+
+    XMStoreFloat3(&meshlet.coneAxis, axis);
+    if (minDot <= MIN_CONE_DOT) {
+        mesh.meshlets.push_back(meshlet);
+        return;
+    }
+
+    const XMVECTOR center = XMLoadFloat3(&meshlet.bounds.Center);
+    float maxDistance = 0.0f;
+    for (UINT i = 0; i < meshlet.indexCount; i += 3) {
+        const XMVECTOR p0 = XMLoadFloat3(&mPositions[i]);
+        const XMVECTOR normal = getTriangleNormal(p0, XMLoadFloat3(&mPositions[i + 1]), XMLoadFloat3(&mPositions[i + 2]));
+        if (!(XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f)) {
+            continue;
+        }
+
+        const XMVECTOR unitNormal = XMVector3Normalize(normal);
+        const float centerDistance = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, p0), unitNormal));
+        const float axisDot = XMVectorGetX(XMVector3Dot(axis, unitNormal));
+        maxDistance = std::max(maxDistance, centerDistance / axisDot);
+    }
+
+    XMStoreFloat3(&meshlet.coneApex, XMVectorSubtract(center, XMVectorScale(axis, maxDistance)));
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    mesh.meshlets.push_back(meshlet);
+}
\ No newline at end of file
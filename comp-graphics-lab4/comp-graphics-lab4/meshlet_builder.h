@@ -0,0 +1,34 @@
+#ifndef MESHLET_BUILDER_H
+#define MESHLET_BUILDER_H
+
+#include "mesh_data.h"
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <vector>
+
+// Splits submeshes into meshlets at load time. Triangles are grouped by the dominant axis
+// of their normal and ordered along a Morton curve inside each group, so a meshlet is both
+// spatially compact and has a narrow normal cone.
+class MeshletBuilder {
+public:
+    static constexpr size_t DEFAULT_MAX_TRIANGLES = 124;
+
+    explicit MeshletBuilder(size_t maxTriangles = DEFAULT_MAX_TRIANGLES);
+
+    // Reorders the triangles of the submesh so that every meshlet is a contiguous index range,
+    // then appends the meshlets to mesh.meshlets and records them in the submesh.
+    void build(MeshData& mesh, size_t submeshIndex);
+
+private:
+    size_t mMaxTriangles;
+    std::vector<uint64_t> mTriangleKeys;
+    std::vector<uint32_t> mMeshletTriangles;
+    std::vector<uint32_t> mReorderedIndices;
+    std::vector<DirectX::XMFLOAT3> mPositions;
+
+    void appendMeshlet(MeshData& mesh, const uint32_t* indices, UINT startIndex);
+};
+
+#endif // MESHLET_BUILDER_H
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include "meshlet_culler.h"
+
+using namespace DirectX;
+
+void MeshletCuller::setView(const BoundingFrustum& frustum, const XMFLOAT3& eyePosition) {
+    mPlanes = FrustumPlanes::fromFrustum(frustum);
+    mEyePosition = eyePosition;
+    mStats = {};
+}
+
+void MeshletCuller::cull(const std::vector<Meshlet>& meshlets, const Submesh& submesh, std::vector<IndexRange>& ranges) {
+    const XMVECTOR eye = XMLoadFloat3(&mEyePosition);
+    const size_t firstRange = ranges.size();
+    mStats.trianglesSubmitted += submesh.indexCount / 3;
+
+    for (UINT i = submesh.firstMeshlet; i < submesh.firstMeshlet + submesh.meshletCount; ++i) {
+        const Meshlet& meshlet = meshlets[i];
+        ++mStats.meshletsTested;
+
+        if (!mPlanes.intersectsSphere(meshlet.bounds)) {
+            ++mStats.frustumCulled;
+            continue;
+        }
+
+        // The apex lies behind every triangle plane, so all triangles face away once the
+        // eye-to-apex direction is within 90 degrees minus the cone half-angle of the axis.
+        if (meshlet.coneCutoff < 1.0f) {
+            const XMVECTOR view = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&meshlet.coneApex), eye));
+            if (XMVectorGetX(XMVector3Dot(view, XMLoadFloat3(&meshlet.coneAxis))) >= meshlet.coneCutoff) {
+                ++mStats.coneCulled;
+                continue;
+            }
+        }
+
+        mStats.trianglesDrawn += meshlet.indexCount / 3;
+        if (ranges.size() > firstRange && ranges.back().startIndex + ranges.back().indexCount == meshlet.startIndex) {
+            ranges.back().indexCount += meshlet.indexCount;
+        }
+        else {
+            ranges.push_back({ meshlet.startIndex, meshlet.indexCount });
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef MESHLET_CULLER_H
+#define MESHLET_CULLER_H
+
+#include "frustum_planes.h"
+#include "mesh_data.h"
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <vector>
+
+// Per-frame culling of the meshlets of visible submeshes against the view frustum and
+// their normal cones. Survivors are returned as index ranges ready for DrawIndexedInstanced.
+class MeshletCuller {
+public:
+    struct IndexRange {
+        UINT startIndex = 0;
+        UINT indexCount = 0;
+    };
+
+    struct Stats {
+        size_t meshletsTested = 0;
+        size_t frustumCulled = 0;
+        size_t coneCulled = 0;
+        size_t trianglesSubmitted = 0;
+        size_t trianglesDrawn = 0;
+    };
+
+    // Sets the view for the following cull calls and resets the statistics.
+    void setView(const DirectX::BoundingFrustum& frustum, const DirectX::XMFLOAT3& eyePosition);
+
+    // Appends the ranges of the submesh meshlets that may be visible. Meshlets of a submesh are
+    // stored back to back, so runs of surviving meshlets merge into a single range.
+    void cull(const std::vector<Meshlet>& meshlets, const Submesh& submesh, std::vector<IndexRange>& ranges);
+
+    const Stats& getStats() const { return mStats; }
+
+private:
+    FrustumPlanes mPlanes = {};
+    DirectX::XMFLOAT3 mEyePosition = { 0.0f, 0.0f, 0.0f };
+    Stats mStats;
+};
+
+#endif // MESHLET_CULLER_H
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "model_loader.h"
+#include "bounding_volumes.h"
+#include "mesh_cache.h"
+#include "thread_pool.h"
 #include "assimp/Importer.hpp"
 
 #include <assimp/postprocess.h>
@@ -8,6 +11,17 @@
 
 using namespace DirectX;
 
+const char* const ModelLoader::CACHE_EXTENSION = ".meshcache";
+
+namespace {
+    constexpr uint32_t POST_PROCESS_FLAGS =
+        aiProcess_Triangulate |
+        aiProcess_GenSmoothNormals |
+        aiProcess_CalcTangentSpace |
+        aiProcess_JoinIdenticalVertices |
+        aiProcess_ImproveCacheLocality;
+}
+
 static XMMATRIX aiToXM(const aiMatrix4x4& m) {
     return XMMATRIX(
         m.a1, m.b1, m.c1, m.d1,
@@ -17,11 +31,13 @@ static XMMATRIX aiToXM(const aiMatrix4x4& m) {
     );
 }
 
-void ModelLoader::parseMesh(const aiMesh* mesh, const aiMatrix4x4& transform, MeshData& meshData, const aiScene* scene) {
-    UINT baseVertex = static_cast<UINT>(meshData.vertices.size());
-    UINT startIndex = static_cast<UINT>(meshData.indices.size());
+void ModelLoader::parseMesh(const MeshJob& job, const aiScene* scene, MeshData& meshData) const {
+    const aiMesh* mesh = job.mesh;
+    const UINT baseVertex = job.startVertex;
+    Vertex* vertices = meshData.vertices.data() + job.startVertex;
+    uint32_t* indices = meshData.indices.data() + job.startIndex;
 
-    XMMATRIX M = aiToXM(transform);
+    XMMATRIX M = aiToXM(job.transform);
     XMMATRIX normalMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, M));
 
     for (UINT i = 0; i < mesh->mNumVertices; ++i) {
@@ -71,21 +87,24 @@ void ModelLoader::parseMesh(const aiMesh* mesh, const aiMatrix4x4& transform, Me
             vertex.texCoord = {0, 0};
         }
 
-        meshData.vertices.push_back(vertex);
+        vertices[i] = vertex;
     }
 
     for (UINT i = 0; i < mesh->mNumFaces; ++i) {
         const aiFace& face = mesh->mFaces[i];
 
         for (UINT j = 0; j < face.mNumIndices; ++j) {
-            meshData.indices.push_back(baseVertex + face.mIndices[j]);
+            *indices++ = baseVertex + face.mIndices[j];
         }
     }
 
-    Submesh submesh;
-    submesh.indexCount = static_cast<UINT>(mesh->mNumFaces * 3);
-    submesh.startIndiceIndex = startIndex;
+    Submesh& submesh = meshData.submeshes[job.submesh];
+    submesh.indexCount = job.indexCount;
+    submesh.startIndiceIndex = job.startIndex;
     submesh.startVerticeIndex = baseVertex;
+    if (mesh->mNumVertices > 0) {
+        fitSubmeshBounds(submesh, vertices, mesh->mNumVertices);
+    }
 
     aiString texturePath;
     if (scene && mesh->mMaterialIndex >= 0) {
@@ -107,46 +126,83 @@ void ModelLoader::parseMesh(const aiMesh* mesh, const aiMatrix4x4& transform, Me
         if (material->GetTexture(aiTextureType_EMISSIVE, 0, &texturePath) == AI_SUCCESS) {
             submesh.material.displacementTextureName = "Earth_HEIGHT";
         }
+        if (material->GetTexture(aiTextureType_OPACITY, 0, &texturePath) == AI_SUCCESS) {
+            submesh.material.alphaTested = true;
+        }
         float shininess = 0.f;
         if (material->Get(AI_MATKEY_SHININESS, shininess) == AI_SUCCESS) {
             submesh.material.shininess = shininess;
         }
     }
-
-    meshData.submeshes.push_back(submesh);
 }
 
-void ModelLoader::parseNode(const aiNode* node, const aiScene* scene, const aiMatrix4x4& parentTransform, MeshData& meshData) {
+void ModelLoader::collectMeshes(const aiNode* node, const aiScene* scene, const aiMatrix4x4& parentTransform,
+    std::vector<MeshJob>& jobs) const {
     aiMatrix4x4 globalTransform = parentTransform * node->mTransformation;
 
     for (UINT i = 0; i < node->mNumMeshes; ++i) {
-        const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        parseMesh(mesh, globalTransform, meshData, scene);
+        MeshJob job;
+        job.mesh = scene->mMeshes[node->mMeshes[i]];
+        job.transform = globalTransform;
+        for (UINT face = 0; face < job.mesh->mNumFaces; ++face) {
+            job.indexCount += job.mesh->mFaces[face].mNumIndices;
+        }
+        jobs.push_back(job);
     }
 
     for (UINT i = 0; i < node->mNumChildren; ++i) {
-        parseNode(node->mChildren[i], scene, globalTransform, meshData);
+        collectMeshes(node->mChildren[i], scene, globalTransform, jobs);
     }
 }
 
-MeshData ModelLoader::loadModel(const std::string& fileName) {
+MeshData ModelLoader::loadModel(const std::string& fileName, ThreadPool* threadPool) {
+    const std::string cacheFileName = fileName + CACHE_EXTENSION;
+    MeshCache::Key cacheKey;
+    const bool hasCacheKey = MeshCache::computeKey(fileName, mScale, POST_PROCESS_FLAGS, cacheKey);
+    if (hasCacheKey) {
+        MeshCache cache;
+        if (cache.open(cacheFileName, cacheKey)) {
+            return cache.createMeshData();
+        }
+    }
+
     Assimp::Importer importer;
 
-    const aiScene* scene = importer.ReadFile(
-        fileName,
-        aiProcess_Triangulate |
-        aiProcess_GenSmoothNormals |
-        aiProcess_CalcTangentSpace |
-        aiProcess_JoinIdenticalVertices |
-        aiProcess_ImproveCacheLocality
-    );
+    const aiScene* scene = importer.ReadFile(fileName, POST_PROCESS_FLAGS);
 
     if (!scene || !scene->mRootNode)
         throw std::runtime_error(importer.GetErrorString());
 
-    MeshData meshData;
+    std::vector<MeshJob> jobs;
     aiMatrix4x4 identity;
-    parseNode(scene->mRootNode, scene, identity, meshData);
+    collectMeshes(scene->mRootNode, scene, identity, jobs);
+
+    // Every job owns a slice of the vertex and index arrays, so the meshes are filled in
+    // parallel and still come out in node order.
+    UINT vertexCount = 0;
+    UINT indexCount = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        jobs[i].submesh = i;
+        jobs[i].startVertex = vertexCount;
+        jobs[i].startIndex = indexCount;
+        vertexCount += jobs[i].mesh->mNumVertices;
+        indexCount += jobs[i].indexCount;
+    }
+
+    MeshData meshData;
+    meshData.vertices.resize(vertexCount);
+    meshData.indices.resize(indexCount);
+    meshData.submeshes.resize(jobs.size());
+    ThreadPool::run(threadPool, jobs.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            parseMesh(jobs[i], scene, meshData);
+        }
+    });
+
+    // A failed write only costs the next launch another Assimp import.
+    if (hasCacheKey) {
+        MeshCache::save(cacheFileName, cacheKey, meshData);
+    }
 
     return meshData;
 }
\ No newline at end of file
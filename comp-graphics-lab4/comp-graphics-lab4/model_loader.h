@@ -8,18 +8,35 @@
 #include <vector>
 #include <string>
 
+class ThreadPool;
+
 class ModelLoader {
 public:
     ModelLoader(float scale = 1.f) : mScale(scale) {}
 
-    MeshData loadModel(const std::string& fileName);
+    // Reads fileName + CACHE_EXTENSION instead of running Assimp when the cache matches the
+    // source file and this loader's parameters, and writes the cache otherwise. Meshes are
+    // parsed in parallel on threadPool, and submesh bounds are fitted as they are parsed.
+    MeshData loadModel(const std::string& fileName, ThreadPool* threadPool = nullptr);
+
+    static const char* const CACHE_EXTENSION;
 
 private:
+    // A mesh instance of the node tree and the slices of MeshData it is parsed into.
+    struct MeshJob {
+        const aiMesh* mesh = nullptr;
+        aiMatrix4x4 transform;
+        size_t submesh = 0;
+        UINT startVertex = 0;
+        UINT startIndex = 0;
+        UINT indexCount = 0;
+    };
+
     float mScale;
 
     DirectX::XMFLOAT3 transformVec(const aiVector3D& v, const aiMatrix4x4& m);
-    void parseNode(const aiNode* node, const aiScene* scene, const aiMatrix4x4& parentTransform, MeshData& meshData);
-    void parseMesh(const aiMesh* mesh, const aiMatrix4x4& transform, MeshData& meshData, const aiScene* scene);
+    void collectMeshes(const aiNode* node, const aiScene* scene, const aiMatrix4x4& parentTransform, std::vector<MeshJob>& jobs) const;
+    void parseMesh(const MeshJob& job, const aiScene* scene, MeshData& meshData) const;
 };
 
 #endif // MODEL_LOADER_H
\ No newline at end of file
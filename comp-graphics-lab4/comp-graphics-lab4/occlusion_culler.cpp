@@ -0,0 +1,367 @@
+#include "occlusion_culler.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace {
+    constexpr size_t VERTEX_CHUNK_SIZE = 4096;
+    constexpr size_t TRIANGLE_CHUNK_SIZE = 1024;
+
+    XMFLOAT4 lerpClip(const XMFLOAT4& a, const XMFLOAT4& b, float t) {
+        return XMFLOAT4(
+            a.x + (b.x - a.x) * t,
+            a.y + (b.y - a.y) * t,
+            a.z + (b.z - a.z) * t,
+            a.w + (b.w - a.w) * t);
+    }
+
+    bool allOutside(const XMFLOAT4* v, float XMFLOAT4::* component, float sign) {
+        for (size_t i = 0; i < 3; ++i) {
+            if (sign * (v[i].*component) <= v[i].w) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height)
+    : mWidth(std::max<uint32_t>(width, 1)),
+    mHeight(std::max<uint32_t>(height, 1)),
+    mStride((mWidth + 3) & ~3u) {
+    mDepth.assign(static_cast<size_t>(mStride) * mHeight, 1.0f);
+    XMStoreFloat4x4(&mViewProj, XMMatrixIdentity());
+
+    uint32_t levelWidth = mWidth;
+    uint32_t levelHeight = mHeight;
+    for (;;) {
+        DepthLevel level;
+        level.width = levelWidth;
+        level.height = levelHeight;
+        level.minDepth.assign(static_cast<size_t>(levelWidth) * levelHeight, 1.0f);
+        level.maxDepth.assign(static_cast<size_t>(levelWidth) * levelHeight, 1.0f);
+        mLevels.push_back(std::move(level));
+
+        if (levelWidth == 1 && levelHeight == 1) {
+            break;
+        }
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+    }
+}
+
+void OcclusionCuller::clearOccluders() {
+    mPositions.clear();
+    mIndices.clear();
+}
+
+void OcclusionCuller::addOccluder(const Occluder& occluder) {
+    const uint32_t baseVertex = static_cast<uint32_t>(mPositions.size());
+    mPositions.insert(mPositions.end(), occluder.positions.begin(), occluder.positions.end());
+
+    mIndices.reserve(mIndices.size() + occluder.indices.size());
+    for (uint32_t index : occluder.indices) {
+        mIndices.push_back(baseVertex + index);
+    }
+}
+
+// Transforms the occluders, sets up at most two screen triangles per input triangle
+// (near-plane clipping can turn one into a quad), bins them by the horizontal bands they
+// touch and rasterizes the bands in parallel so no two threads write the same row.
+void OcclusionCuller::render(const XMFLOAT4X4& viewProj, ThreadPool* threadPool) {
+    mViewProj = viewProj;
+    std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+
+    const XMMATRIX viewProjMatrix = XMLoadFloat4x4(&viewProj);
+    mClipPositions.resize(mPositions.size());
+    ThreadPool::run(threadPool, mPositions.size(), VERTEX_CHUNK_SIZE, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const XMVECTOR position = XMVectorSet(mPositions[i].x, mPositions[i].y, mPositions[i].z, 1.0f);
+            XMStoreFloat4(&mClipPositions[i], XMVector4Transform(position, viewProjMatrix));
+        }
+    });
+
+    const size_t triangleCount = mIndices.size() / 3;
+    mTriangles.resize(triangleCount * 2);
+    ThreadPool::run(threadPool, triangleCount, TRIANGLE_CHUNK_SIZE, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            setupTriangle(i);
+        }
+    });
+
+    binTriangles();
+
+    ThreadPool::run(threadPool, mBandTriangles.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t band = begin; band < end; ++band) {
+            rasterizeBand(static_cast<uint32_t>(band));
+        }
+    });
+
+    buildPyramid();
+}
+
+// A box is occluded when its nearest depth lies behind the farthest occluder depth over
+// the pixels its projection covers. The test starts at the pyramid level where the
+// projected rectangle spans at most 2x2 texels and refines while the answer is unclear.
+bool OcclusionCuller::isVisible(const BoundingBox& bounds) const {
+    const XMMATRIX viewProj = XMLoadFloat4x4(&mViewProj);
+
+    float minX = FLT_MAX;
+    float minY = FLT_MAX;
+    float maxX = -FLT_MAX;
+    float maxY = -FLT_MAX;
+    float nearestDepth = FLT_MAX;
+
+    for (int corner = 0; corner < 8; ++corner) {
+        const XMVECTOR position = XMVectorSet(
+            bounds.Center.x + ((corner & 1) ? bounds.Extents.x : -bounds.Extents.x),
+            bounds.Center.y + ((corner & 2) ? bounds.Extents.y : -bounds.Extents.y),
+            bounds.Center.z + ((corner & 4) ? bounds.Extents.z : -bounds.Extents.z),
+            1.0f);
+
+        XMFLOAT4 clip;
+        XMStoreFloat4(&clip, XMVector4Transform(position, viewProj));
+        if (clip.z < 0.0f || clip.w <= 0.0f) {
+            return true;
+        }
+
+        const float invW = 1.0f / clip.w;
+        const float screenX = (clip.x * invW * 0.5f + 0.5f) * mWidth;
+        const float screenY = (0.5f - clip.y * invW * 0.5f) * mHeight;
+        minX = std::min(minX, screenX);
+        maxX = std::max(maxX, screenX);
+        minY = std::min(minY, screenY);
+        maxY = std::max(maxY, screenY);
+        nearestDepth = std::min(nearestDepth, clip.z * invW);
+    }
+
+    if (maxX < 0.0f || maxY < 0.0f || minX >= static_cast<float>(mWidth) || minY >= static_cast<float>(mHeight)) {
+        return false;
+    }
+
+    const uint32_t x0 = static_cast<uint32_t>(std::max(minX, 0.0f));
+    const uint32_t y0 = static_cast<uint32_t>(std::max(minY, 0.0f));
+    const uint32_t x1 = static_cast<uint32_t>(std::min(maxX, static_cast<float>(mWidth - 1)));
+    const uint32_t y1 = static_cast<uint32_t>(std::min(maxY, static_cast<float>(mHeight - 1)));
+
+    size_t startLevel = 0;
+    while (startLevel + 1 < mLevels.size() && ((x1 >> startLevel) - (x0 >> startLevel) > 1 || (y1 >> startLevel) - (y0 >> startLevel) > 1)) {
+        ++startLevel;
+    }
+
+    for (size_t levelIndex = startLevel + 1; levelIndex-- > 0;) {
+        const DepthLevel& level = mLevels[levelIndex];
+        const uint32_t levelX0 = x0 >> levelIndex;
+        const uint32_t levelY0 = y0 >> levelIndex;
+        const uint32_t levelX1 = x1 >> levelIndex;
+        const uint32_t levelY1 = y1 >> levelIndex;
+
+        if (static_cast<size_t>(levelX1 - levelX0 + 1) * (levelY1 - levelY0 + 1) > MAX_TEST_TEXELS) {
+            break;
+        }
+
+        float farthest = 0.0f;
+        float nearest = 1.0f;
+        for (uint32_t y = levelY0; y <= levelY1; ++y) {
+            for (uint32_t x = levelX0; x <= levelX1; ++x) {
+                farthest = std::max(farthest, level.maxDepth[y * level.width + x]);
+                nearest = std::min(nearest, level.minDepth[y * level.width + x]);
+            }
+        }
+
+        if (nearestDepth > farthest) {
+            return false;
+        }
+        if (nearestDepth <= nearest) {
+            return true;
+        }
+    }
+
+    return true;
+}
+
+void OcclusionCuller::setupTriangle(size_t triangleIndex) {
+    ScreenTriangle& first = mTriangles[triangleIndex * 2];
+    ScreenTriangle& second = mTriangles[triangleIndex * 2 + 1];
+    first = {};
+    second = {};
+
+    const XMFLOAT4 v[3] = {
+        mClipPositions[mIndices[triangleIndex * 3]],
+        mClipPositions[mIndices[triangleIndex * 3 + 1]],
+        mClipPositions[mIndices[triangleIndex * 3 + 2]]
+    };
+
+    if (allOutside(v, &XMFLOAT4::x, 1.0f) || allOutside(v, &XMFLOAT4::x, -1.0f) ||
+        allOutside(v, &XMFLOAT4::y, 1.0f) || allOutside(v, &XMFLOAT4::y, -1.0f) ||
+        allOutside(v, &XMFLOAT4::z, 1.0f)) {
+        return;
+    }
+
+    XMFLOAT4 polygon[4];
+    size_t vertexCount = 0;
+    for (size_t i = 0; i < 3; ++i) {
+        const XMFLOAT4& a = v[i];
+        const XMFLOAT4& b = v[(i + 1) % 3];
+        const bool aInside = a.z >= 0.0f;
+        const bool bInside = b.z >= 0.0f;
+
+        if (aInside) {
+            polygon[vertexCount++] = a;
+        }
+        if (aInside != bInside) {
+            polygon[vertexCount++] = lerpClip(a, b, a.z / (a.z - b.z));
+        }
+    }
+
+    if (vertexCount >= 3) {
+        emitTriangle(polygon[0], polygon[1], polygon[2], first);
+    }
+    if (vertexCount == 4) {
+        emitTriangle(polygon[0], polygon[2], polygon[3], second);
+    }
+}
+
+void OcclusionCuller::emitTriangle(const XMFLOAT4& v0, const XMFLOAT4& v1, const XMFLOAT4& v2, ScreenTriangle& triangle) const {
+    float x[3];
+    float y[3];
+    float z[3];
+    const XMFLOAT4* v[3] = { &v0, &v1, &v2 };
+
+    for (size_t i = 0; i < 3; ++i) {
+        const float invW = 1.0f / v[i]->w;
+        x[i] = (v[i]->x * invW * 0.5f + 0.5f) * mWidth;
+        y[i] = (0.5f - v[i]->y * invW * 0.5f) * mHeight;
+        z[i] = v[i]->z * invW;
+    }
+
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (!(std::fabs(area) > 0.0f)) {
+        return;
+    }
+    if (area < 0.0f) {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        area = -area;
+    }
+
+    for (size_t i = 0; i < 3; ++i) {
+        const size_t next = (i + 1) % 3;
+        triangle.edgeA[i] = y[i] - y[next];
+        triangle.edgeB[i] = x[next] - x[i];
+        triangle.edgeC[i] = -(triangle.edgeA[i] * x[i] + triangle.edgeB[i] * y[i]);
+    }
+
+    const float invArea = 1.0f / area;
+    triangle.depthA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) * invArea;
+    triangle.depthB = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) * invArea;
+    triangle.depthC = z[0] - triangle.depthA * x[0] - triangle.depthB * y[0];
+
+    const float minX = std::min({ x[0], x[1], x[2] });
+    const float maxX = std::max({ x[0], x[1], x[2] });
+    const float minY = std::min({ y[0], y[1], y[2] });
+    const float maxY = std::max({ y[0], y[1], y[2] });
+
+    triangle.minX = static_cast<int32_t>(std::ceil(std::clamp(minX - 0.5f, 0.0f, static_cast<float>(mWidth))));
+    triangle.maxX = static_cast<int32_t>(std::floor(std::clamp(maxX - 0.5f, -1.0f, static_cast<float>(mWidth) - 1.0f)));
+    triangle.minY = static_cast<int32_t>(std::ceil(std::clamp(minY - 0.5f, 0.0f, static_cast<float>(mHeight))));
+    triangle.maxY = static_cast<int32_t>(std::floor(std::clamp(maxY - 0.5f, -1.0f, static_cast<float>(mHeight) - 1.0f)));
+}
+
+void OcclusionCuller::binTriangles() {
+    mBandTriangles.resize((mHeight + BAND_HEIGHT - 1) / BAND_HEIGHT);
+    for (auto& triangles : mBandTriangles) {
+        triangles.clear();
+    }
+
+    const int32_t bandHeight = static_cast<int32_t>(BAND_HEIGHT);
+    mRasterizedTriangleCount = 0;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(mTriangles.size()); ++i) {
+        const ScreenTriangle& triangle = mTriangles[i];
+        if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+            continue;
+        }
+
+        ++mRasterizedTriangleCount;
+        for (int32_t band = triangle.minY / bandHeight; band <= triangle.maxY / bandHeight; ++band) {
+            mBandTriangles[band].push_back(i);
+        }
+    }
+}
+
+void OcclusionCuller::rasterizeBand(uint32_t band) {
+    const XMVECTOR pixelOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+    const XMVECTOR zero = XMVectorZero();
+    const int32_t bandStart = static_cast<int32_t>(band * BAND_HEIGHT);
+    const int32_t bandEnd = static_cast<int32_t>(std::min((band + 1) * BAND_HEIGHT, mHeight));
+
+    for (uint32_t triangleIndex : mBandTriangles[band]) {
+        const ScreenTriangle& triangle = mTriangles[triangleIndex];
+        const int32_t rowStart = std::max(triangle.minY, bandStart);
+        const int32_t rowEnd = std::min(triangle.maxY, bandEnd - 1);
+
+        const XMVECTOR edgeA0 = XMVectorReplicate(triangle.edgeA[0]);
+        const XMVECTOR edgeA1 = XMVectorReplicate(triangle.edgeA[1]);
+        const XMVECTOR edgeA2 = XMVectorReplicate(triangle.edgeA[2]);
+        const XMVECTOR depthA = XMVectorReplicate(triangle.depthA);
+        const int32_t columnStart = triangle.minX & ~3;
+
+        for (int32_t y = rowStart; y <= rowEnd; ++y) {
+            const float pixelY = static_cast<float>(y) + 0.5f;
+            const XMVECTOR rowEdge0 = XMVectorReplicate(triangle.edgeB[0] * pixelY + triangle.edgeC[0]);
+            const XMVECTOR rowEdge1 = XMVectorReplicate(triangle.edgeB[1] * pixelY + triangle.edgeC[1]);
+            const XMVECTOR rowEdge2 = XMVectorReplicate(triangle.edgeB[2] * pixelY + triangle.edgeC[2]);
+            const XMVECTOR rowDepth = XMVectorReplicate(triangle.depthB * pixelY + triangle.depthC);
+            float* row = &mDepth[static_cast<size_t>(y) * mStride];
+
+            for (int32_t x = columnStart; x <= triangle.maxX; x += 4) {
+                const XMVECTOR pixelX = XMVectorAdd(XMVectorReplicate(static_cast<float>(x)), pixelOffsets);
+
+                XMVECTOR covered = XMVectorGreaterOrEqual(XMVectorMultiplyAdd(edgeA0, pixelX, rowEdge0), zero);
+                covered = XMVectorAndInt(covered, XMVectorGreaterOrEqual(XMVectorMultiplyAdd(edgeA1, pixelX, rowEdge1), zero));
+                covered = XMVectorAndInt(covered, XMVectorGreaterOrEqual(XMVectorMultiplyAdd(edgeA2, pixelX, rowEdge2), zero));
+
+                XMFLOAT4* target = reinterpret_cast<XMFLOAT4*>(row + x);
+                const XMVECTOR current = XMLoadFloat4(target);
+                const XMVECTOR depth = XMVectorMultiplyAdd(depthA, pixelX, rowDepth);
+                XMStoreFloat4(target, XMVectorSelect(current, XMVectorMin(current, depth), covered));
+            }
+        }
+    }
+}
+
+void OcclusionCuller::buildPyramid() {
+    DepthLevel& base = mLevels[0];
+    for (uint32_t y = 0; y < mHeight; ++y) {
+        std::copy_n(&mDepth[static_cast<size_t>(y) * mStride], mWidth, &base.minDepth[static_cast<size_t>(y) * mWidth]);
+        std::copy_n(&mDepth[static_cast<size_t>(y) * mStride], mWidth, &base.maxDepth[static_cast<size_t>(y) * mWidth]);
+    }
+
+    for (size_t levelIndex = 1; levelIndex < mLevels.size(); ++levelIndex) {
+        const DepthLevel& source = mLevels[levelIndex - 1];
+        DepthLevel& level = mLevels[levelIndex];
+
+        for (uint32_t y = 0; y < level.height; ++y) {
+            const uint32_t sourceY0 = y * 2;
+            const uint32_t sourceY1 = std::min(sourceY0 + 1, source.height - 1);
+
+            for (uint32_t x = 0; x < level.width; ++x) {
+                const uint32_t sourceX0 = x * 2;
+                const uint32_t sourceX1 = std::min(sourceX0 + 1, source.width - 1);
+
+                const size_t i00 = sourceY0 * source.width + sourceX0;
+                const size_t i01 = sourceY0 * source.width + sourceX1;
+                const size_t i10 = sourceY1 * source.width + sourceX0;
+                const size_t i11 = sourceY1 * source.width + sourceX1;
+
+                level.minDepth[y * level.width + x] = std::min({ source.minDepth[i00], source.minDepth[i01], source.minDepth[i10], source.minDepth[i11] });
+                level.maxDepth[y * level.width + x] = std::max({ source.maxDepth[i00], source.maxDepth[i01], source.maxDepth[i10], source.maxDepth[i11] });
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Software occlusion culling: occluder triangles are rasterized into a small depth
+// buffer on the CPU, reduced into a min/max depth pyramid, and bounding boxes are
+// tested against the pyramid. Depth follows the D3D convention, 0 at the near plane.
+// Depends only on DirectXMath and the thread pool, so it builds and runs without the
+// renderer; scene_occluders.h extracts occluders from the scene mesh.
+class OcclusionCuller {
+public:
+    struct Occluder {
+        std::vector<DirectX::XMFLOAT3> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    OcclusionCuller(uint32_t width = 256, uint32_t height = 128);
+
+    void clearOccluders();
+    void addOccluder(const Occluder& occluder);
+
+    void render(const DirectX::XMFLOAT4X4& viewProj, ThreadPool* threadPool = nullptr);
+    bool isVisible(const DirectX::BoundingBox& bounds) const;
+
+    uint32_t getWidth() const { return mWidth; }
+    uint32_t getHeight() const { return mHeight; }
+    size_t getOccluderTriangleCount() const { return mIndices.size() / 3; }
+    size_t getRasterizedTriangleCount() const { return mRasterizedTriangleCount; }
+    float getDepth(uint32_t x, uint32_t y) const { return mDepth[y * mStride + x]; }
+
+private:
+    // Edge functions and depth plane of a triangle in pixel coordinates. A pixel center
+    // (x, y) is covered when edgeA * x + edgeB * y + edgeC >= 0 for all three edges.
+    struct ScreenTriangle {
+        float edgeA[3];
+        float edgeB[3];
+        float edgeC[3];
+        float depthA = 0.0f;
+        float depthB = 0.0f;
+        float depthC = 0.0f;
+        int32_t minX = 0;
+        int32_t maxX = -1;
+        int32_t minY = 0;
+        int32_t maxY = -1;
+    };
+
+    struct DepthLevel {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<float> minDepth;
+        std::vector<float> maxDepth;
+    };
+
+    static constexpr uint32_t BAND_HEIGHT = 8;
+    static constexpr size_t MAX_TEST_TEXELS = 16;
+
+    uint32_t mWidth;
+    uint32_t mHeight;
+    uint32_t mStride;
+    std::vector<float> mDepth;
+    std::vector<DepthLevel> mLevels;
+
+    std::vector<DirectX::XMFLOAT3> mPositions;
+    std::vector<uint32_t> mIndices;
+    std::vector<DirectX::XMFLOAT4> mClipPositions;
+    std::vector<ScreenTriangle> mTriangles;
+    std::vector<std::vector<uint32_t>> mBandTriangles;
+    size_t mRasterizedTriangleCount = 0;
+
+    DirectX::XMFLOAT4X4 mViewProj;
+
+    void setupTriangle(size_t triangleIndex);
+    void emitTriangle(const DirectX::XMFLOAT4& v0, const DirectX::XMFLOAT4& v1, const DirectX::XMFLOAT4& v2, ScreenTriangle& triangle) const;
+    void binTriangles();
+    void rasterizeBand(uint32_t band);
+    void buildPyramid();
+};
+
+#endif // OCCLUSION_CULLER_H
\ No newline at end of file
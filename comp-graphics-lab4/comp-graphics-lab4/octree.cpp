@@ -1,121 +1,910 @@
 #include "octree.h"
+#include "frustum_planes.h"
+#include "thread_pool.h"
 
 #include <DirectXMath.h>
+#include <algorithm>
+#include <bitset>
+#include <cfloat>
+#include <cmath>
 
 using namespace DirectX;
 
+namespace {
+    constexpr uint32_t BATCH_WIDTH = FrustumPlanes::BATCH_WIDTH;
+
+    // Morton keys hold the interleaved cell coordinates (x, y, z from most to least significant
+    // bit of each triple, matching splitBounds) above a 5-bit octree level.
+    constexpr unsigned MORTON_LEVEL_BITS = 5;
+    constexpr uint64_t MORTON_LEVEL_MASK = (1u << MORTON_LEVEL_BITS) - 1u;
+    constexpr size_t MORTON_CHUNK_SIZE = 4096;
+    // Quantization widens each box by a few ulps of the scene extent so rounding in
+    // splitBounds can never leave an entry poking out of the node it is assigned to.
+    constexpr float MORTON_MARGIN_ULPS = 32.0f;
+
+    constexpr unsigned RADIX_BITS = 8;
+    constexpr size_t RADIX_SIZE = size_t(1) << RADIX_BITS;
+    constexpr size_t RADIX_MIN_CHUNK_SIZE = 16384;
+    // The top-down build sorts a node's entries into the ones it keeps and one bucket per octant.
+    constexpr size_t BUILD_BUCKET_COUNT = 9;
+    // More chunks than threads so subtrees of uneven cost still balance.
+    constexpr size_t PARALLEL_QUERY_CHUNKS_PER_THREAD = 4;
+
+    uint64_t expandBits(uint32_t value) {
+        uint64_t x = value & 0x1FFFFFu;
+        x = (x | x << 32) & 0x001F00000000FFFFull;
+        x = (x | x << 16) & 0x001F0000FF0000FFull;
+        x = (x | x << 8) & 0x100F00F00F00F00Full;
+        x = (x | x << 4) & 0x10C30C30C30C30C3ull;
+        x = (x | x << 2) & 0x1249249249249249ull;
+        return x;
+    }
+
+    uint32_t quantize(float value, float origin, float scale, uint32_t maxCell) {
+        const float cell = (value - origin) * scale;
+        if (!(cell > 0.0f)) {
+            return 0;
+        }
+        if (cell >= static_cast<float>(maxCell)) {
+            return maxCell;
+        }
+        return static_cast<uint32_t>(cell);
+    }
+
+    uint32_t highestBitCount(uint32_t value) {
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        return _BitScanReverse(&index, value) ? index + 1 : 0;
+#else
+        return value != 0 ? 32 - __builtin_clz(value) : 0;
+#endif
+    }
+
+    // Deepest level whose loose cells fit an extent, where limit is the loose slack of the root.
+    uint32_t looseLevel(float extent, float limit, uint32_t maxLevel) {
+        if (!(extent > 0.0f) || limit >= extent * static_cast<float>(1u << maxLevel)) {
+            return maxLevel;
+        }
+        if (limit < extent) {
+            return 0;
+        }
+        return std::min(static_cast<uint32_t>(std::floor(std::log2(limit / extent))), maxLevel);
+    }
+
+    uint32_t lowestBitIndex(uint32_t value) {
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        _BitScanForward(&index, value);
+        return index;
+#else
+        return __builtin_ctz(value);
+#endif
+    }
+
+    // Stable LSD radix sort of keys with their values. Each pass histograms chunks of the
+    // input in parallel, turns the histograms into per-chunk scatter offsets, then scatters
+    // the chunks in parallel. Passes where every key shares the same digit are skipped.
+    void radixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, std::vector<uint64_t>& keyScratch,
+        std::vector<uint32_t>& valueScratch, unsigned keyBits, ThreadPool* pool) {
+        const size_t count = keys.size();
+        keyScratch.resize(count);
+        valueScratch.resize(count);
+
+        const size_t threadCount = pool ? pool->getThreadCount() : 1;
+        const size_t chunkSize = std::max(RADIX_MIN_CHUNK_SIZE, (count + threadCount - 1) / threadCount);
+        const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+        std::vector<std::array<uint32_t, RADIX_SIZE>> histograms(chunkCount);
+
+        for (unsigned shift = 0; shift < keyBits; shift += RADIX_BITS) {
+            ThreadPool::run(pool, count, chunkSize, [&](size_t begin, size_t end) {
+                auto& histogram = histograms[begin / chunkSize];
+                histogram.fill(0);
+                for (size_t i = begin; i < end; ++i) {
+                    ++histogram[(keys[i] >> shift) & (RADIX_SIZE - 1)];
+                }
+            });
+
+            bool singleDigit = false;
+            for (size_t digit = 0; digit < RADIX_SIZE && !singleDigit; ++digit) {
+                size_t digitCount = 0;
+                for (const auto& histogram : histograms) {
+                    digitCount += histogram[digit];
+                }
+                singleDigit = digitCount == count;
+            }
+
+            if (singleDigit) {
+                continue;
+            }
+
+            uint32_t offset = 0;
+            for (size_t digit = 0; digit < RADIX_SIZE; ++digit) {
+                for (auto& histogram : histograms) {
+                    const uint32_t digitCount = histogram[digit];
+                    histogram[digit] = offset;
+                    offset += digitCount;
+                }
+            }
+
+            ThreadPool::run(pool, count, chunkSize, [&](size_t begin, size_t end) {
+                auto& offsets = histograms[begin / chunkSize];
+                for (size_t i = begin; i < end; ++i) {
+                    const uint32_t target = offsets[(keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+                    keyScratch[target] = keys[i];
+                    valueScratch[target] = values[i];
+                }
+            });
+
+            keys.swap(keyScratch);
+            values.swap(valueScratch);
+        }
+    }
+}
+
+Octree::Octree(const BuildSettings& settings) : mSettings(settings) {
+    mSettings.maxDepth = std::min(settings.maxDepth, MAX_DEPTH);
+    mSettings.looseness = std::max(settings.looseness, 1.0f);
+}
+
 Octree::Octree(const std::vector<Entry>& entries, size_t maxObjectsPerNode, size_t maxDepth) {
     rebuild(entries, maxObjectsPerNode, maxDepth);
 }
 
+Octree::Octree(const std::vector<Entry>& entries, const BuildSettings& settings) {
+    rebuild(entries, settings);
+}
+
+void Octree::rebuild(const std::vector<Entry>& entries) {
+    rebuild(entries, mSettings);
+}
+
 void Octree::rebuild(const std::vector<Entry>& entries, size_t maxObjectsPerNode, size_t maxDepth) {
-    mMaxObjectsPerNode = maxObjectsPerNode;
-    mMaxDepth = maxDepth;
+    BuildSettings settings;
+    settings.maxObjectsPerNode = maxObjectsPerNode;
+    settings.maxDepth = maxDepth;
+    rebuild(entries, settings);
+}
+
+void Octree::rebuild(const std::vector<Entry>& entries, const BuildSettings& settings) {
+    mSettings = settings;
+    mSettings.maxDepth = std::min(settings.maxDepth, MAX_DEPTH);
+    mSettings.looseness = std::max(settings.looseness, 1.0f);
+
+    mHandles.clear();
+    mFreeHandles.clear();
+    mHandles.reserve(entries.size());
+
+    for (const auto& entry : entries) {
+        HandleRecord record;
+        record.entry = entry;
+        record.live = true;
+        mHandles.push_back(record);
+    }
+
+    rebuildFromHandles();
+}
+
+void Octree::query(const BoundingFrustum& frustum, std::vector<size_t>& visibleObjects, QueryStats* stats) const {
+    query(frustum, [&visibleObjects](size_t objectIndex) { visibleObjects.push_back(objectIndex); }, stats);
+}
+
+void Octree::queryFrontToBack(const BoundingFrustum& frustum, const XMFLOAT3& eye, std::vector<DepthVisibility>& visibleObjects,
+    QueryStats* stats) const {
+    queryFrontToBack(frustum, eye,
+        [&visibleObjects](size_t objectIndex, float viewDepth) { visibleObjects.push_back({ objectIndex, viewDepth }); }, stats);
+}
+
+void Octree::query(const BoundingFrustum& frustum, const ContributionCulling& contribution, std::vector<size_t>& visibleObjects,
+    std::vector<size_t>* impostorObjects, QueryStats* stats) const {
+    QueryStats counters;
+    traverse<false>(frustum, contribution.eye, [&](uint32_t slot) {
+        if (passesContribution(contribution, mEntryObjects[slot], mEntryBounds.get(slot), impostorObjects, counters)) {
+            visibleObjects.push_back(mEntryObjects[slot]);
+        }
+    }, counters);
+
+    if (stats) {
+        *stats = counters;
+    }
+}
+
+void Octree::queryFrontToBack(const BoundingFrustum& frustum, const ContributionCulling& contribution,
+    std::vector<DepthVisibility>& visibleObjects, std::vector<size_t>* impostorObjects, QueryStats* stats) const {
+    QueryStats counters;
+    traverse<true>(frustum, contribution.eye, [&](uint32_t slot) {
+        const BoundingBox bounds = mEntryBounds.get(slot);
+        if (passesContribution(contribution, mEntryObjects[slot], bounds, impostorObjects, counters)) {
+            visibleObjects.push_back({ mEntryObjects[slot], getViewDepth(bounds, contribution.eye) });
+        }
+    }, counters);
+
+    if (stats) {
+        *stats = counters;
+    }
+}
+
+void Octree::queryParallel(const BoundingFrustum& frustum, ThreadPool* threadPool, std::vector<std::vector<size_t>>& visibleObjectLists,
+    size_t splitDepth, QueryStats* stats) const {
+    const QueryShape<BoundingFrustum> queryShape(frustum);
+    QueryStats counters;
+    std::vector<QueryItem> tasks;
+    if (!mNodes.empty()) {
+        collectQueryTasks(queryShape, { 0, QueryShape<BoundingFrustum>::INITIAL_STATE }, 0, splitDepth, tasks, counters);
+    }
 
-    if (entries.empty()) {
-        mRoot.reset();
+    const size_t threadCount = threadPool ? threadPool->getThreadCount() : 1;
+    const size_t chunkSize = std::max<size_t>(tasks.size() / (threadCount * PARALLEL_QUERY_CHUNKS_PER_THREAD), 1);
+    const size_t chunkCount = (tasks.size() + chunkSize - 1) / chunkSize;
+    visibleObjectLists.resize(chunkCount);
+    std::vector<QueryStats> chunkCounters(chunkCount);
+
+    ThreadPool::run(threadPool, tasks.size(), chunkSize, [&](size_t begin, size_t end) {
+        std::vector<size_t>& visibleObjects = visibleObjectLists[begin / chunkSize];
+        visibleObjects.clear();
+
+        QueryStats taskCounters;
+        for (size_t task = begin; task < end; ++task) {
+            traverseSubtree<false>(queryShape, tasks[task], XMFLOAT3(0.0f, 0.0f, 0.0f),
+                [this, &visibleObjects](uint32_t slot) { visibleObjects.push_back(mEntryObjects[slot]); }, taskCounters);
+        }
+        chunkCounters[begin / chunkSize] = taskCounters;
+    });
+
+    for (const QueryStats& taskCounters : chunkCounters) {
+        counters.nodesVisited += taskCounters.nodesVisited;
+        counters.planeTests += taskCounters.planeTests;
+        counters.entriesTested += taskCounters.entriesTested;
+        counters.entriesAccepted += taskCounters.entriesAccepted;
+    }
+
+    if (stats) {
+        *stats = counters;
+    }
+}
+
+void Octree::queryParallel(const BoundingFrustum& frustum, ThreadPool* threadPool, std::vector<size_t>& visibleObjects,
+    size_t splitDepth, QueryStats* stats) const {
+    std::vector<std::vector<size_t>> visibleObjectLists;
+    queryParallel(frustum, threadPool, visibleObjectLists, splitDepth, stats);
+
+    for (const auto& list : visibleObjectLists) {
+        visibleObjects.insert(visibleObjects.end(), list.begin(), list.end());
+    }
+}
+
+// Emits the tasks in the preorder of the sequential walk: a node's own entries, then its children.
+void Octree::collectQueryTasks(const QueryShape<BoundingFrustum>& queryShape, const QueryItem& item, size_t depth,
+    size_t splitDepth, std::vector<QueryItem>& tasks, QueryStats& counters) const {
+    const Node& node = mNodes[item.node];
+    if (depth >= splitDepth || node.isLeaf()) {
+        tasks.push_back(item);
         return;
     }
 
-    mRoot = buildNode(computeBounds(entries), entries, 0);
+    uint32_t state = item.state;
+    ++counters.nodesVisited;
+    if (state != 0 && !queryShape.classify(node.bounds, state, node.lastRejectingPlane, counters.planeTests)) {
+        return;
+    }
+
+    if (node.entryCount > 0) {
+        tasks.push_back({ item.node, state, true });
+    }
+    for (uint32_t child = node.firstChild; child < node.firstChild + node.childCount; ++child) {
+        collectQueryTasks(queryShape, { child, state }, depth + 1, splitDepth, tasks, counters);
+    }
 }
 
-std::vector<size_t> Octree::query(const BoundingFrustum& frustum) const {
-    std::vector<size_t> visibleObjects;
-    if (!mRoot) {
+std::vector<Octree::ViewVisibility> Octree::queryViews(const std::vector<BoundingFrustum>& frustums, QueryStats* stats) const {
+    std::vector<ViewVisibility> visibleObjects;
+    const size_t viewCount = std::min(frustums.size(), MAX_VIEWS);
+    if (mNodes.empty() || viewCount == 0) {
+        if (stats) {
+            *stats = {};
+        }
         return visibleObjects;
     }
 
-    queryNode(mRoot.get(), frustum, visibleObjects);
+    std::array<FrustumPlanes, MAX_VIEWS> planes;
+    for (size_t view = 0; view < viewCount; ++view) {
+        planes[view] = FrustumPlanes::fromFrustum(frustums[view]);
+    }
+    QueryStats counters;
+
+    std::array<MultiViewQueryItem, QUERY_STACK_SIZE> stack;
+    size_t stackSize = 0;
+    MultiViewQueryItem root;
+    root.activeViews = viewCount == MAX_VIEWS ? ~0u : (1u << viewCount) - 1u;
+    root.planeMasks.fill(FrustumPlanes::ALL_PLANES);
+    stack[stackSize++] = root;
+
+    std::array<uint32_t, BATCH_WIDTH> laneViews;
+
+    while (stackSize > 0) {
+        MultiViewQueryItem item = stack[--stackSize];
+        const Node& node = mNodes[item.node];
+        ++counters.nodesVisited;
+
+        for (uint32_t views = item.activeViews; views != 0; views &= views - 1) {
+            const uint32_t view = lowestBitIndex(views);
+            const uint32_t viewBit = 1u << view;
+
+            // The cached rejecting plane is only a hint here; writing it back would let views thrash it.
+            uint32_t planeMask = item.planeMasks[view];
+            uint8_t rejectingPlane = node.lastRejectingPlane.get();
+            if (!planes[view].classifyBox(node.bounds, planeMask, rejectingPlane, counters.planeTests)) {
+                item.activeViews &= ~viewBit;
+            }
+            else if (planeMask == 0) {
+                item.activeViews &= ~viewBit;
+                item.insideViews |= viewBit;
+            }
+            item.planeMasks[view] = static_cast<uint8_t>(planeMask);
+        }
+
+        if ((item.activeViews | item.insideViews) == 0) {
+            continue;
+        }
+
+        if (item.activeViews != 0) {
+            counters.entriesTested += node.entryCount;
+        }
+
+        const uint32_t entryEnd = node.firstEntry + node.entryCount;
+        for (uint32_t batchStart = node.firstEntry; batchStart < entryEnd; batchStart += BATCH_WIDTH) {
+            const uint32_t laneCount = std::min(entryEnd - batchStart, BATCH_WIDTH);
+            laneViews.fill(item.insideViews);
+
+            for (uint32_t views = item.activeViews; views != 0; views &= views - 1) {
+                const uint32_t view = lowestBitIndex(views);
+                counters.planeTests += std::bitset<6>(item.planeMasks[view]).count() * laneCount;
+                uint32_t mask = planes[view].intersectsBatch(item.planeMasks[view],
+                    &mEntryBounds.centerX[batchStart], &mEntryBounds.centerY[batchStart], &mEntryBounds.centerZ[batchStart],
+                    &mEntryBounds.extentX[batchStart], &mEntryBounds.extentY[batchStart], &mEntryBounds.extentZ[batchStart]);
+
+                for (uint32_t lane = 0; mask != 0; ++lane, mask >>= 1) {
+                    if (mask & 1u) {
+                        laneViews[lane] |= 1u << view;
+                    }
+                }
+            }
+
+            for (uint32_t lane = 0; lane < laneCount; ++lane) {
+                if (laneViews[lane] != 0) {
+                    visibleObjects.push_back({ mEntryObjects[batchStart + lane], laneViews[lane] });
+                }
+            }
+        }
+
+        for (uint32_t childOffset = node.childCount; childOffset > 0; --childOffset) {
+            item.node = node.firstChild + childOffset - 1;
+            stack[stackSize++] = item;
+        }
+    }
+
+    counters.entriesAccepted = visibleObjects.size();
+    if (stats) {
+        *stats = counters;
+    }
+
     return visibleObjects;
 }
 
-bool Octree::Node::isLeaf() const {
-    for (const auto& child : children) {
-        if (child) {
-            return false;
+Octree::Handle Octree::insert(const Entry& entry) {
+    Handle handle;
+    if (!mFreeHandles.empty()) {
+        handle = mFreeHandles.back();
+        mFreeHandles.pop_back();
+    }
+    else {
+        handle = static_cast<Handle>(mHandles.size());
+        mHandles.emplace_back();
+    }
+
+    HandleRecord& record = mHandles[handle];
+    record.entry = entry;
+    record.live = true;
+
+    if (mNodes.empty()) {
+        Node root;
+        root.bounds = entry.bounds;
+        mNodes.push_back(root);
+    }
+
+    attach(handle, findInsertionNode(entry.bounds));
+    ++mLiveEntryCount;
+    ++mRelocationCount;
+
+    rebalanceIfNeeded();
+    return handle;
+}
+
+void Octree::remove(Handle handle) {
+    if (handle >= mHandles.size() || !mHandles[handle].live) {
+        return;
+    }
+
+    detach(handle);
+    mHandles[handle].live = false;
+    mFreeHandles.push_back(handle);
+    --mLiveEntryCount;
+    ++mUnusedSlotCount;
+
+    rebalanceIfNeeded();
+}
+
+void Octree::update(Handle handle, const BoundingBox& bounds) {
+    if (handle >= mHandles.size() || !mHandles[handle].live) {
+        return;
+    }
+
+    HandleRecord& record = mHandles[handle];
+    record.entry.bounds = bounds;
+
+    if (mNodes[record.node].bounds.Contains(bounds) == CONTAINS) {
+        mEntryBounds.set(record.slot, bounds);
+        return;
+    }
+
+    detach(handle);
+    attach(handle, findInsertionNode(bounds));
+    ++mRelocationCount;
+
+    rebalanceIfNeeded();
+}
+
+std::vector<size_t> Octree::getEntryCountPerDepth() const {
+    std::vector<size_t> counts;
+    if (mNodes.empty()) {
+        return counts;
+    }
+
+    std::vector<std::pair<uint32_t, size_t>> stack = { { 0, 0 } };
+    while (!stack.empty()) {
+        const auto [nodeIndex, depth] = stack.back();
+        stack.pop_back();
+
+        const Node& node = mNodes[nodeIndex];
+        if (counts.size() <= depth) {
+            counts.resize(depth + 1, 0);
+        }
+        counts[depth] += node.entryCount;
+
+        for (uint32_t child = node.firstChild; child < node.firstChild + node.childCount; ++child) {
+            stack.push_back({ child, depth + 1 });
         }
     }
 
-    return true;
+    return counts;
 }
 
-std::unique_ptr<Octree::Node> Octree::buildNode(const BoundingBox& bounds, const std::vector<Entry>& entries, size_t depth) const {
-    std::unique_ptr<Node> node = std::make_unique<Node>();
-    node->bounds = bounds;
+size_t Octree::getMemoryUsage() const {
+    return mNodes.capacity() * sizeof(Node) + mEntryBounds.getMemoryUsage() +
+        mEntryObjects.capacity() * sizeof(size_t) + mEntryHandles.capacity() * sizeof(Handle) +
+        mHandles.capacity() * sizeof(HandleRecord) + mFreeHandles.capacity() * sizeof(Handle) +
+        (mMortonKeys.capacity() + mMortonKeyScratch.capacity()) * sizeof(uint64_t) +
+        (mMortonHandles.capacity() + mMortonHandleScratch.capacity() + mBuildHandles.capacity()) * sizeof(Handle) +
+        mBuildBuckets.capacity() * sizeof(uint8_t);
+}
 
-    if (entries.empty()) {
-        return node;
+void Octree::rebuildFromHandles() {
+    mNodes.clear();
+    mEntryBounds.clear();
+    mEntryObjects.clear();
+    mEntryHandles.clear();
+    mUnusedSlotCount = 0;
+    mRelocationCount = 0;
+
+    mBuildHandles.clear();
+    for (Handle handle = 0; handle < mHandles.size(); ++handle) {
+        if (mHandles[handle].live) {
+            mBuildHandles.push_back(handle);
+        }
     }
 
-    if (depth >= mMaxDepth || entries.size() <= mMaxObjectsPerNode) {
-        node->entries = entries;
-        return node;
+    mLiveEntryCount = mBuildHandles.size();
+    if (mBuildHandles.empty()) {
+        return;
     }
 
-    const auto childBounds = splitBounds(bounds);
-    std::array<std::vector<Entry>, 8> childEntries;
-    std::vector<Entry> stayAtNode;
+    mEntryBounds.reserve(mBuildHandles.size() + BATCH_WIDTH);
+    mEntryObjects.reserve(mBuildHandles.size());
+    mEntryHandles.reserve(mBuildHandles.size());
 
-    for (const auto& entry : entries) {
-        bool insertedIntoChild = false;
+    Node root;
+    root.bounds = computeBounds(mBuildHandles);
+    mNodes.push_back(root);
 
-        for (size_t childIndex = 0; childIndex < childBounds.size(); ++childIndex) {
-            if (childBounds[childIndex].Contains(entry.bounds) == CONTAINS) {
-                childEntries[childIndex].push_back(entry);
-                insertedIntoChild = true;
-                break;
+    if (mSettings.method == BuildMethod::Morton) {
+        buildMorton(mBuildHandles);
+    }
+    else {
+        mBuildBuckets.resize(mBuildHandles.size());
+        buildNode(0, 0, mBuildHandles.size(), 0);
+    }
+    mEntryBounds.resize(mEntryObjects.size() + BATCH_WIDTH);
+
+    // Both builds split the exact cells; the loose bounds are only applied once the tree is done.
+    if (mSettings.looseness > 1.0f) {
+        for (size_t nodeIndex = 1; nodeIndex < mNodes.size(); ++nodeIndex) {
+            mNodes[nodeIndex].bounds = loosen(mNodes[nodeIndex].bounds);
+        }
+    }
+}
+
+// Partitions mBuildHandles[begin, end) in place, like a quicksort partition with nine
+// buckets: the entries staying at the node first, then one run per octant. Nodes are
+// appended to mNodes and entries to the slot arrays, whose capacity survives rebuilds, so a
+// level allocates nothing of its own.
+void Octree::buildNode(uint32_t nodeIndex, size_t begin, size_t end, size_t depth) {
+    if (depth >= mSettings.maxDepth || end - begin <= mSettings.maxObjectsPerNode) {
+        appendEntries(nodeIndex, &mBuildHandles[begin], end - begin);
+        return;
+    }
+
+    const BoundingBox cell = mNodes[nodeIndex].bounds;
+    const auto childBounds = splitBounds(cell);
+    std::array<BoundingBox, 8> looseChildBounds;
+    for (size_t childIndex = 0; childIndex < childBounds.size(); ++childIndex) {
+        looseChildBounds[childIndex] = loosen(childBounds[childIndex]);
+    }
+
+    // Bucket 0 holds the entries staying at the node and bucket 1 + i those of octant i.
+    // A box inside a strict child always has its center in that child, so testing the child
+    // holding the center is enough for both the strict and the loose tree.
+    std::array<size_t, BUILD_BUCKET_COUNT + 1> bucketBegin = {};
+    for (size_t i = begin; i < end; ++i) {
+        const BoundingBox& bounds = mHandles[mBuildHandles[i]].entry.bounds;
+        const size_t childIndex = getOctant(cell, bounds.Center);
+
+        const uint8_t bucket = looseChildBounds[childIndex].Contains(bounds) == CONTAINS ? static_cast<uint8_t>(childIndex + 1) : 0;
+        mBuildBuckets[i] = bucket;
+        ++bucketBegin[bucket + 1];
+    }
+
+    bucketBegin[0] = begin;
+    for (size_t bucket = 0; bucket < BUILD_BUCKET_COUNT; ++bucket) {
+        bucketBegin[bucket + 1] += bucketBegin[bucket];
+    }
+
+    // Swaps every entry straight into the next free place of its bucket.
+    std::array<size_t, BUILD_BUCKET_COUNT> bucketNext;
+    std::copy(bucketBegin.begin(), bucketBegin.end() - 1, bucketNext.begin());
+    for (size_t bucket = 0; bucket < BUILD_BUCKET_COUNT; ++bucket) {
+        while (bucketNext[bucket] < bucketBegin[bucket + 1]) {
+            const size_t i = bucketNext[bucket];
+            const uint8_t target = mBuildBuckets[i];
+            if (target == bucket) {
+                ++bucketNext[bucket];
+                continue;
             }
+
+            std::swap(mBuildHandles[i], mBuildHandles[bucketNext[target]]);
+            std::swap(mBuildBuckets[i], mBuildBuckets[bucketNext[target]]);
+            ++bucketNext[target];
         }
+    }
+
+    appendEntries(nodeIndex, &mBuildHandles[begin], bucketBegin[1] - begin);
 
-        if (!insertedIntoChild) {
-            stayAtNode.push_back(entry);
+    const uint32_t firstChild = static_cast<uint32_t>(mNodes.size());
+    uint32_t childCount = 0;
+    for (size_t childIndex = 0; childIndex < childBounds.size(); ++childIndex) {
+        if (bucketBegin[childIndex + 1] != bucketBegin[childIndex + 2]) {
+            Node child;
+            child.bounds = childBounds[childIndex];
+            mNodes.push_back(child);
+            ++childCount;
         }
     }
 
-    node->entries = stayAtNode;
+    mNodes[nodeIndex].firstChild = firstChild;
+    mNodes[nodeIndex].childCount = childCount;
 
+    uint32_t childNodeIndex = firstChild;
     for (size_t childIndex = 0; childIndex < childBounds.size(); ++childIndex) {
-        if (!childEntries[childIndex].empty()) {
-            node->children[childIndex] = buildNode(childBounds[childIndex], childEntries[childIndex], depth + 1);
+        if (bucketBegin[childIndex + 1] != bucketBegin[childIndex + 2]) {
+            buildNode(childNodeIndex++, bucketBegin[childIndex + 1], bucketBegin[childIndex + 2], depth + 1);
         }
     }
+}
+
+// Builds the same tree as buildNode from sorted keys instead of partitioning. Every entry gets the key of
+// the deepest grid cell that encloses it; after sorting, the entries of any node form one
+// contiguous run whose own entries come first, followed by each octant's run in order.
+void Octree::buildMorton(const std::vector<Handle>& handles) {
+    const size_t count = handles.size();
+    const uint32_t depth = static_cast<uint32_t>(mSettings.maxDepth);
+    const uint32_t maxCell = (1u << depth) - 1u;
+
+    BoundingBox& rootBounds = mNodes[0].bounds;
+    const float magnitude = std::max({
+        std::fabs(rootBounds.Center.x) + rootBounds.Extents.x,
+        std::fabs(rootBounds.Center.y) + rootBounds.Extents.y,
+        std::fabs(rootBounds.Center.z) + rootBounds.Extents.z });
+    const float margin = magnitude * FLT_EPSILON * MORTON_MARGIN_ULPS;
+
+    // Padding the root by twice the margin keeps widened boxes clear of the grid clamp.
+    rootBounds.Extents.x += 2.0f * margin;
+    rootBounds.Extents.y += 2.0f * margin;
+    rootBounds.Extents.z += 2.0f * margin;
+
+    const XMFLOAT3 origin = {
+        rootBounds.Center.x - rootBounds.Extents.x,
+        rootBounds.Center.y - rootBounds.Extents.y,
+        rootBounds.Center.z - rootBounds.Extents.z
+    };
+    // Loose cells at level L fit entries whose extents are at most (looseness - 1) times the
+    // cell extents, so the level depends only on entry size and the key on the center cell.
+    const XMFLOAT3 looseLimit = {
+        (mSettings.looseness - 1.0f) * rootBounds.Extents.x,
+        (mSettings.looseness - 1.0f) * rootBounds.Extents.y,
+        (mSettings.looseness - 1.0f) * rootBounds.Extents.z
+    };
+    const XMFLOAT3 scale = {
+        rootBounds.Extents.x > 0.0f ? static_cast<float>(1u << depth) / (2.0f * rootBounds.Extents.x) : 0.0f,
+        rootBounds.Extents.y > 0.0f ? static_cast<float>(1u << depth) / (2.0f * rootBounds.Extents.y) : 0.0f,
+        rootBounds.Extents.z > 0.0f ? static_cast<float>(1u << depth) / (2.0f * rootBounds.Extents.z) : 0.0f
+    };
+    mMortonKeys.resize(count);
+    mMortonHandles.resize(count);
+
+    ThreadPool::run(mSettings.threadPool, count, MORTON_CHUNK_SIZE, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const BoundingBox& bounds = mHandles[handles[i]].entry.bounds;
+
+            uint32_t minX, minY, minZ;
+            uint32_t level = depth;
+            if (mSettings.looseness > 1.0f) {
+                minX = quantize(bounds.Center.x, origin.x, scale.x, maxCell);
+                minY = quantize(bounds.Center.y, origin.y, scale.y, maxCell);
+                minZ = quantize(bounds.Center.z, origin.z, scale.z, maxCell);
+                level = std::min({ level,
+                    looseLevel(bounds.Extents.x + margin, looseLimit.x, depth),
+                    looseLevel(bounds.Extents.y + margin, looseLimit.y, depth),
+                    looseLevel(bounds.Extents.z + margin, looseLimit.z, depth) });
+            }
+            else {
+                minX = quantize(bounds.Center.x - bounds.Extents.x - margin, origin.x, scale.x, maxCell);
+                minY = quantize(bounds.Center.y - bounds.Extents.y - margin, origin.y, scale.y, maxCell);
+                minZ = quantize(bounds.Center.z - bounds.Extents.z - margin, origin.z, scale.z, maxCell);
+                const uint32_t maxX = quantize(bounds.Center.x + bounds.Extents.x + margin, origin.x, scale.x, maxCell);
+                const uint32_t maxY = quantize(bounds.Center.y + bounds.Extents.y + margin, origin.y, scale.y, maxCell);
+                const uint32_t maxZ = quantize(bounds.Center.z + bounds.Extents.z + margin, origin.z, scale.z, maxCell);
+                level -= highestBitCount((minX ^ maxX) | (minY ^ maxY) | (minZ ^ maxZ));
+            }
+            const uint32_t droppedBits = 3 * (depth - level);
+
+            uint64_t code = (expandBits(minX) << 2) | (expandBits(minY) << 1) | expandBits(minZ);
+            code = (code >> droppedBits) << droppedBits;
+
+            mMortonKeys[i] = (code << MORTON_LEVEL_BITS) | level;
+            mMortonHandles[i] = handles[i];
+        }
+    });
+
+    radixSort(mMortonKeys, mMortonHandles, mMortonKeyScratch, mMortonHandleScratch,
+        3 * depth + MORTON_LEVEL_BITS, mSettings.threadPool);
+
+    buildMortonNode(0, 0, count, 0);
+
+    // Nodes are emitted in key order, so slot i holds the i-th sorted entry.
+    mEntryObjects.resize(count);
+    mEntryHandles.resize(count);
+    mEntryBounds.resize(count + BATCH_WIDTH);
 
-    return node;
+    ThreadPool::run(mSettings.threadPool, mNodes.size(), MORTON_CHUNK_SIZE / 8, [&](size_t begin, size_t end) {
+        for (size_t nodeIndex = begin; nodeIndex < end; ++nodeIndex) {
+            const Node& node = mNodes[nodeIndex];
+
+            for (uint32_t slot = node.firstEntry; slot < node.firstEntry + node.entryCount; ++slot) {
+                const Handle handle = mMortonHandles[slot];
+                HandleRecord& record = mHandles[handle];
+                record.node = static_cast<uint32_t>(nodeIndex);
+                record.slot = slot;
+
+                mEntryBounds.set(slot, record.entry.bounds);
+                mEntryObjects[slot] = record.entry.objectIndex;
+                mEntryHandles[slot] = handle;
+            }
+        }
+    });
 }
 
-void Octree::queryNode(const Node* node, const BoundingFrustum& frustum, std::vector<size_t>& visibleObjects) const {
-    if (!node) {
-        return;
+void Octree::buildMortonNode(uint32_t nodeIndex, size_t begin, size_t end, size_t depth) {
+    size_t childBegin = end;
+    if (depth < mSettings.maxDepth && end - begin > mSettings.maxObjectsPerNode) {
+        childBegin = begin;
+        while (childBegin < end && (mMortonKeys[childBegin] & MORTON_LEVEL_MASK) == depth) {
+            ++childBegin;
+        }
     }
 
-    if (!frustum.Intersects(node->bounds)) {
+    Node& node = mNodes[nodeIndex];
+    node.firstEntry = static_cast<uint32_t>(begin);
+    node.entryCount = static_cast<uint32_t>(childBegin - begin);
+    node.entryCapacity = node.entryCount;
+
+    if (childBegin == end) {
         return;
     }
 
-    for (const auto& entry : node->entries) {
-        if (frustum.Intersects(entry.bounds)) {
-            visibleObjects.push_back(entry.objectIndex);
+    const unsigned octantShift = MORTON_LEVEL_BITS + 3 * static_cast<unsigned>(mSettings.maxDepth - depth - 1);
+    std::array<size_t, 9> octantBegin;
+    size_t cursor = childBegin;
+    for (size_t octant = 0; octant < 8; ++octant) {
+        octantBegin[octant] = cursor;
+        while (cursor < end && ((mMortonKeys[cursor] >> octantShift) & 7u) == octant) {
+            ++cursor;
+        }
+    }
+    octantBegin[8] = end;
+
+    const auto childBounds = splitBounds(mNodes[nodeIndex].bounds);
+    const uint32_t firstChild = static_cast<uint32_t>(mNodes.size());
+    uint32_t childCount = 0;
+    for (size_t octant = 0; octant < 8; ++octant) {
+        if (octantBegin[octant] != octantBegin[octant + 1]) {
+            Node child;
+            child.bounds = childBounds[octant];
+            mNodes.push_back(child);
+            ++childCount;
         }
     }
 
-    for (const auto& child : node->children) {
-        if (child) {
-            queryNode(child.get(), frustum, visibleObjects);
+    mNodes[nodeIndex].firstChild = firstChild;
+    mNodes[nodeIndex].childCount = childCount;
+
+    uint32_t childNodeIndex = firstChild;
+    for (size_t octant = 0; octant < 8; ++octant) {
+        if (octantBegin[octant] != octantBegin[octant + 1]) {
+            buildMortonNode(childNodeIndex++, octantBegin[octant], octantBegin[octant + 1], depth + 1);
         }
     }
 }
 
-BoundingBox Octree::computeBounds(const std::vector<Entry>& entries) {
-    BoundingBox bounds = entries.front().bounds;
+void Octree::appendEntries(uint32_t nodeIndex, const Handle* handles, size_t count) {
+    Node& node = mNodes[nodeIndex];
+    node.firstEntry = static_cast<uint32_t>(mEntryObjects.size());
+    node.entryCount = static_cast<uint32_t>(count);
+    node.entryCapacity = node.entryCount;
+
+    for (size_t i = 0; i < count; ++i) {
+        const Handle handle = handles[i];
+        HandleRecord& record = mHandles[handle];
+        record.node = nodeIndex;
+        record.slot = static_cast<uint32_t>(mEntryObjects.size());
+
+        mEntryBounds.pushBack(record.entry.bounds);
+        mEntryObjects.push_back(record.entry.objectIndex);
+        mEntryHandles.push_back(handle);
+    }
+}
 
-    for (size_t i = 1; i < entries.size(); ++i) {
-        BoundingBox::CreateMerged(bounds, bounds, entries[i].bounds);
+uint32_t Octree::findInsertionNode(const BoundingBox& bounds) {
+    Node& root = mNodes[0];
+    if (root.bounds.Contains(bounds) != CONTAINS) {
+        BoundingBox::CreateMerged(root.bounds, root.bounds, bounds);
+        return 0;
     }
 
+    uint32_t nodeIndex = 0;
+    for (;;) {
+        const Node& node = mNodes[nodeIndex];
+        uint32_t containingChild = node.firstChild + node.childCount;
+
+        for (uint32_t child = node.firstChild; child < node.firstChild + node.childCount; ++child) {
+            if (mNodes[child].bounds.Contains(bounds) == CONTAINS) {
+                containingChild = child;
+                break;
+            }
+        }
+
+        if (containingChild == node.firstChild + node.childCount) {
+            return nodeIndex;
+        }
+
+        nodeIndex = containingChild;
+    }
+}
+
+void Octree::attach(Handle handle, uint32_t nodeIndex) {
+    if (mNodes[nodeIndex].entryCount == mNodes[nodeIndex].entryCapacity) {
+        growNodeStorage(nodeIndex);
+    }
+
+    Node& node = mNodes[nodeIndex];
+    const uint32_t slot = node.firstEntry + node.entryCount;
+    ++node.entryCount;
+
+    HandleRecord& record = mHandles[handle];
+    record.node = nodeIndex;
+    record.slot = slot;
+
+    mEntryBounds.set(slot, record.entry.bounds);
+    mEntryObjects[slot] = record.entry.objectIndex;
+    mEntryHandles[slot] = handle;
+}
+
+void Octree::detach(Handle handle) {
+    const HandleRecord& record = mHandles[handle];
+    Node& node = mNodes[record.node];
+
+    const uint32_t lastSlot = node.firstEntry + node.entryCount - 1;
+    if (record.slot != lastSlot) {
+        moveSlot(lastSlot, record.slot);
+    }
+
+    mEntryHandles[lastSlot] = INVALID_HANDLE;
+    --node.entryCount;
+}
+
+// Moves the node's entries to a larger range at the end of the packed arrays.
+// The old range is left unused until the next rebalance compacts storage.
+void Octree::growNodeStorage(uint32_t nodeIndex) {
+    Node& node = mNodes[nodeIndex];
+    const uint32_t newFirst = static_cast<uint32_t>(mEntryObjects.size());
+    const uint32_t newCapacity = std::max<uint32_t>(node.entryCapacity * 2, 4);
+
+    mEntryObjects.resize(newFirst + newCapacity);
+    mEntryHandles.resize(newFirst + newCapacity, INVALID_HANDLE);
+    mEntryBounds.resize(newFirst + newCapacity + BATCH_WIDTH);
+
+    for (uint32_t i = 0; i < node.entryCount; ++i) {
+        moveSlot(node.firstEntry + i, newFirst + i);
+    }
+
+    mUnusedSlotCount += node.entryCapacity;
+    node.firstEntry = newFirst;
+    node.entryCapacity = newCapacity;
+}
+
+void Octree::moveSlot(uint32_t from, uint32_t to) {
+    const Handle handle = mEntryHandles[from];
+
+    mEntryBounds.copy(from, to);
+    mEntryObjects[to] = mEntryObjects[from];
+    mEntryHandles[to] = handle;
+    mEntryHandles[from] = INVALID_HANDLE;
+
+    mHandles[handle].slot = to;
+}
+
+// Incremental updates never split or merge nodes, so after enough relocations
+// or wasted slots the tree is rebuilt from the live handles.
+void Octree::rebalanceIfNeeded() {
+    const size_t relocationBudget = std::max(MIN_REBALANCE_RELOCATIONS, mLiveEntryCount / 4);
+
+    if (mRelocationCount > relocationBudget || mUnusedSlotCount > std::max(MIN_REBALANCE_RELOCATIONS, mLiveEntryCount)) {
+        rebuildFromHandles();
+        ++mRebalanceCount;
+    }
+}
+
+BoundingBox Octree::computeBounds(const std::vector<Handle>& handles) const {
+    XMFLOAT3 minCorner = { FLT_MAX, FLT_MAX, FLT_MAX };
+    XMFLOAT3 maxCorner = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    for (Handle handle : handles) {
+        const BoundingBox& bounds = mHandles[handle].entry.bounds;
+        minCorner.x = std::min(minCorner.x, bounds.Center.x - bounds.Extents.x);
+        minCorner.y = std::min(minCorner.y, bounds.Center.y - bounds.Extents.y);
+        minCorner.z = std::min(minCorner.z, bounds.Center.z - bounds.Extents.z);
+        maxCorner.x = std::max(maxCorner.x, bounds.Center.x + bounds.Extents.x);
+        maxCorner.y = std::max(maxCorner.y, bounds.Center.y + bounds.Extents.y);
+        maxCorner.z = std::max(maxCorner.z, bounds.Center.z + bounds.Extents.z);
+    }
+
+    BoundingBox bounds;
+    BoundingBox::CreateFromPoints(bounds, XMLoadFloat3(&minCorner), XMLoadFloat3(&maxCorner));
     return bounds;
 }
 
+BoundingBox Octree::loosen(const BoundingBox& cell) const {
+    const float looseness = mSettings.looseness;
+    return BoundingBox(cell.Center, XMFLOAT3(cell.Extents.x * looseness, cell.Extents.y * looseness, cell.Extents.z * looseness));
+}
+
 std::array<BoundingBox, 8> Octree::splitBounds(const BoundingBox& bounds) {
     std::array<BoundingBox, 8> childBounds;
 
@@ -145,4 +934,8 @@ std::array<BoundingBox, 8> Octree::splitBounds(const BoundingBox& bounds) {
     }
 
     return childBounds;
+}
+
+size_t Octree::getOctant(const BoundingBox& cell, const XMFLOAT3& point) {
+    return (point.x > cell.Center.x ? 4 : 0) | (point.y > cell.Center.y ? 2 : 0) | (point.z > cell.Center.z ? 1 : 0);
 }
\ No newline at end of file
@@ -1,43 +1,292 @@
 #ifndef OCTREE_H
 #define OCTREE_H
 
+#include "packed_bounds.h"
+#include "query_shapes.h"
+#include "spatial_index.h"
+
 #include <DirectXCollision.h>
 
+#include <algorithm>
 #include <array>
-#include <memory>
+#include <bitset>
+#include <cstdint>
 #include <vector>
 
-class Octree {
+class ThreadPool;
+
+class Octree : public SpatialIndex {
 public:
-    struct Entry {
-        size_t objectIndex = 0;
-        DirectX::BoundingBox bounds = {};
+    enum class BuildMethod {
+        TopDown,
+        Morton
+    };
+
+    struct BuildSettings {
+        size_t maxObjectsPerNode = 16;
+        size_t maxDepth = 8;
+        BuildMethod method = BuildMethod::TopDown;
+        // Above 1 the tree is loose: each child's bounds are its cell scaled by this factor and
+        // entries go to the child containing their center, so straddling entries still sink
+        // to the deepest level whose loose bounds fit them. The root keeps the scene bounds.
+        float looseness = 1.0f;
+        // Optional. The Morton build spreads key generation and sorting over the pool.
+        ThreadPool* threadPool = nullptr;
     };
 
+    static constexpr size_t MAX_DEPTH = 16;
+    static constexpr size_t DEFAULT_PARALLEL_SPLIT_DEPTH = 3;
+
     Octree() = default;
+    explicit Octree(const BuildSettings& settings);
     Octree(const std::vector<Entry>& entries, size_t maxObjectsPerNode = 16, size_t maxDepth = 8);
+    Octree(const std::vector<Entry>& entries, const BuildSettings& settings);
+
+    // Rebuilds with the settings of the previous build.
+    void rebuild(const std::vector<Entry>& entries) override;
+    void rebuild(const std::vector<Entry>& entries, size_t maxObjectsPerNode, size_t maxDepth);
+    void rebuild(const std::vector<Entry>& entries, const BuildSettings& settings);
+    using SpatialIndex::query;
+    void query(const DirectX::BoundingFrustum& frustum, std::vector<size_t>& visibleObjects,
+        QueryStats* stats = nullptr) const override;
+    // Calls visitor(objectIndex) for every entry intersecting the shape: a BoundingFrustum,
+    // BoundingSphere, BoundingBox, BoundingOrientedBox or Ray. The shape test is picked at
+    // compile time through QueryShape and nothing is allocated.
+    template <typename Shape, typename Visitor>
+    void query(const Shape& shape, Visitor&& visitor, QueryStats* stats = nullptr) const;
+    void queryFrontToBack(const DirectX::BoundingFrustum& frustum, const DirectX::XMFLOAT3& eye,
+        std::vector<DepthVisibility>& visibleObjects, QueryStats* stats = nullptr) const override;
+    // Like query, but children are visited nearest octant first and the visitor receives
+    // (objectIndex, viewDepth). Entries stored at a node follow only the child holding the eye,
+    // so straddling entries make the order approximate.
+    template <typename Shape, typename Visitor>
+    void queryFrontToBack(const Shape& shape, const DirectX::XMFLOAT3& eye, Visitor&& visitor, QueryStats* stats = nullptr) const;
+    void query(const DirectX::BoundingFrustum& frustum, const ContributionCulling& contribution,
+        std::vector<size_t>& visibleObjects, std::vector<size_t>* impostorObjects, QueryStats* stats = nullptr) const override;
+    void queryFrontToBack(const DirectX::BoundingFrustum& frustum, const ContributionCulling& contribution,
+        std::vector<DepthVisibility>& visibleObjects, std::vector<size_t>* impostorObjects, QueryStats* stats = nullptr) const override;
+    // Walks the nodes above splitDepth on the calling thread and queries every subtree below it
+    // as a task on the pool. Chunk c of the tasks appends to visibleObjectLists[c], so the lists
+    // can be consumed in parallel; concatenated in order they equal the result of query.
+    void queryParallel(const DirectX::BoundingFrustum& frustum, ThreadPool* threadPool,
+        std::vector<std::vector<size_t>>& visibleObjectLists, size_t splitDepth = DEFAULT_PARALLEL_SPLIT_DEPTH,
+        QueryStats* stats = nullptr) const;
+    void queryParallel(const DirectX::BoundingFrustum& frustum, ThreadPool* threadPool, std::vector<size_t>& visibleObjects,
+        size_t splitDepth = DEFAULT_PARALLEL_SPLIT_DEPTH, QueryStats* stats = nullptr) const;
+    // Walks the tree once for all views; a subtree is skipped only when every view rejects it.
+    std::vector<ViewVisibility> queryViews(const std::vector<DirectX::BoundingFrustum>& frustums,
+        QueryStats* stats = nullptr) const override;
 
-    void rebuild(const std::vector<Entry>& entries, size_t maxObjectsPerNode = 16, size_t maxDepth = 8);
-    std::vector<size_t> query(const DirectX::BoundingFrustum& frustum) const;
+    Handle insert(const Entry& entry) override;
+    void remove(Handle handle) override;
+    void update(Handle handle, const DirectX::BoundingBox& bounds) override;
+
+    size_t getNodeCount() const { return mNodes.size(); }
+    // Number of full rebuilds that insert, remove and update have triggered so far.
+    size_t getRebalanceCount() const { return mRebalanceCount; }
+    // Element d is the number of live entries stored in nodes at depth d.
+    std::vector<size_t> getEntryCountPerDepth() const;
+    size_t getEntryCount() const override { return mLiveEntryCount; }
+    size_t getMemoryUsage() const override;
 
 private:
+    // Nodes live in one array; the children of a node are stored contiguously
+    // starting at firstChild, and its entries occupy [firstEntry, firstEntry + entryCount)
+    // of the packed entry arrays. Slots up to entryCapacity are reserved for inserts.
     struct Node {
         DirectX::BoundingBox bounds = {};
-        std::vector<Entry> entries;
-        std::array<std::unique_ptr<Node>, 8> children;
+        uint32_t firstChild = 0;
+        uint32_t childCount = 0;
+        uint32_t firstEntry = 0;
+        uint32_t entryCount = 0;
+        uint32_t entryCapacity = 0;
+        RejectingPlaneHint lastRejectingPlane;
 
-        bool isLeaf() const;
+        bool isLeaf() const { return childCount == 0; }
     };
 
-    std::unique_ptr<Node> mRoot;
-    size_t mMaxObjectsPerNode = 16;
-    size_t mMaxDepth = 8;
+    struct HandleRecord {
+        Entry entry = {};
+        uint32_t node = 0;
+        uint32_t slot = 0;
+        bool live = false;
+    };
+
+    // state is the QueryShape state of the parent, e.g. the frustum planes still straddled.
+    // Front-to-back walks revisit a node with entriesOnly set to emit its own entries late.
+    struct QueryItem {
+        uint32_t node = 0;
+        uint32_t state = 0;
+        bool entriesOnly = false;
+    };
+
+    // Views in activeViews still straddle the node with the planes left in their planeMasks
+    // entry; views in insideViews contain it completely.
+    struct MultiViewQueryItem {
+        uint32_t node = 0;
+        uint32_t activeViews = 0;
+        uint32_t insideViews = 0;
+        std::array<uint8_t, MAX_VIEWS> planeMasks = {};
+    };
+
+    static constexpr size_t QUERY_STACK_SIZE = 8 * MAX_DEPTH + 1;
+    static constexpr size_t MIN_REBALANCE_RELOCATIONS = 64;
+
+    std::vector<Node> mNodes;
+    PackedBounds mEntryBounds;
+    std::vector<size_t> mEntryObjects;
+    std::vector<Handle> mEntryHandles;
+    std::vector<HandleRecord> mHandles;
+    std::vector<Handle> mFreeHandles;
+    size_t mLiveEntryCount = 0;
+    size_t mUnusedSlotCount = 0;
+    size_t mRelocationCount = 0;
+    size_t mRebalanceCount = 0;
+    BuildSettings mSettings;
+
+    // Scratch for the builds, kept between rebuilds to avoid reallocating. The top-down build
+    // partitions mBuildHandles in place, with the bucket of each entry in mBuildBuckets.
+    std::vector<Handle> mBuildHandles;
+    std::vector<uint8_t> mBuildBuckets;
+    std::vector<uint64_t> mMortonKeys;
+    std::vector<Handle> mMortonHandles;
+    std::vector<uint64_t> mMortonKeyScratch;
+    std::vector<Handle> mMortonHandleScratch;
+
+    // Calls visitor(slot) for every entry slot intersecting the shape.
+    template <bool FrontToBack, typename Shape, typename Visitor>
+    void traverse(const Shape& shape, const DirectX::XMFLOAT3& eye, Visitor&& visitor, QueryStats& counters) const;
+    // Walks the subtree below start, or only the entries of start.node when start.entriesOnly is set.
+    template <bool FrontToBack, typename Shape, typename Visitor>
+    void traverseSubtree(const QueryShape<Shape>& queryShape, const QueryItem& start, const DirectX::XMFLOAT3& eye,
+        Visitor&& visitor, QueryStats& counters) const;
 
-    std::unique_ptr<Node> buildNode(const DirectX::BoundingBox& bounds, const std::vector<Entry>& entries, size_t depth) const;
-    void queryNode(const Node* node, const DirectX::BoundingFrustum& frustum, std::vector<size_t>& visibleObjects) const;
+    void collectQueryTasks(const QueryShape<DirectX::BoundingFrustum>& queryShape, const QueryItem& item, size_t depth,
+        size_t splitDepth, std::vector<QueryItem>& tasks, QueryStats& counters) const;
 
-    static DirectX::BoundingBox computeBounds(const std::vector<Entry>& entries);
+    void rebuildFromHandles();
+    void buildNode(uint32_t nodeIndex, size_t begin, size_t end, size_t depth);
+    void buildMorton(const std::vector<Handle>& handles);
+    void buildMortonNode(uint32_t nodeIndex, size_t begin, size_t end, size_t depth);
+    void appendEntries(uint32_t nodeIndex, const Handle* handles, size_t count);
+
+    uint32_t findInsertionNode(const DirectX::BoundingBox& bounds);
+    void attach(Handle handle, uint32_t nodeIndex);
+    void detach(Handle handle);
+    void growNodeStorage(uint32_t nodeIndex);
+    void moveSlot(uint32_t from, uint32_t to);
+    void rebalanceIfNeeded();
+
+    DirectX::BoundingBox computeBounds(const std::vector<Handle>& handles) const;
+    DirectX::BoundingBox loosen(const DirectX::BoundingBox& cell) const;
     static std::array<DirectX::BoundingBox, 8> splitBounds(const DirectX::BoundingBox& bounds);
+    static size_t getOctant(const DirectX::BoundingBox& cell, const DirectX::XMFLOAT3& point);
 };
 
+template <typename Shape, typename Visitor>
+void Octree::query(const Shape& shape, Visitor&& visitor, QueryStats* stats) const {
+    QueryStats counters;
+    traverse<false>(shape, DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f),
+        [this, &visitor](uint32_t slot) { visitor(mEntryObjects[slot]); }, counters);
+
+    if (stats) {
+        *stats = counters;
+    }
+}
+
+template <typename Shape, typename Visitor>
+void Octree::queryFrontToBack(const Shape& shape, const DirectX::XMFLOAT3& eye, Visitor&& visitor, QueryStats* stats) const {
+    QueryStats counters;
+    traverse<true>(shape, eye, [this, &eye, &visitor](uint32_t slot) {
+        visitor(mEntryObjects[slot], getViewDepth(mEntryBounds.get(slot), eye));
+    }, counters);
+
+    if (stats) {
+        *stats = counters;
+    }
+}
+
+template <bool FrontToBack, typename Shape, typename Visitor>
+void Octree::traverse(const Shape& shape, const DirectX::XMFLOAT3& eye, Visitor&& visitor, QueryStats& counters) const {
+    if (!mNodes.empty()) {
+        traverseSubtree<FrontToBack>(QueryShape<Shape>(shape), { 0, QueryShape<Shape>::INITIAL_STATE }, eye, visitor, counters);
+    }
+}
+
+template <bool FrontToBack, typename Shape, typename Visitor>
+void Octree::traverseSubtree(const QueryShape<Shape>& queryShape, const QueryItem& start, const DirectX::XMFLOAT3& eye,
+    Visitor&& visitor, QueryStats& counters) const {
+    std::array<QueryItem, QUERY_STACK_SIZE> stack;
+    size_t stackSize = 0;
+    stack[stackSize++] = start;
+
+    while (stackSize > 0) {
+        const QueryItem item = stack[--stackSize];
+        const Node& node = mNodes[item.node];
+        uint32_t state = item.state;
+
+        if (!item.entriesOnly) {
+            ++counters.nodesVisited;
+            if (state != 0 && !queryShape.classify(node.bounds, state, node.lastRejectingPlane, counters.planeTests)) {
+                continue;
+            }
+        }
+
+        const uint32_t entryEnd = node.firstEntry + node.entryCount;
+        // In front-to-back order, a node with children emits its own entries from a second visit.
+        const bool deferEntries = FrontToBack && !item.entriesOnly && node.childCount > 0;
+        if (!deferEntries) {
+            if (state == 0) {
+                for (uint32_t slot = node.firstEntry; slot < entryEnd; ++slot) {
+                    visitor(slot);
+                }
+                counters.entriesAccepted += node.entryCount;
+            }
+            else {
+                counters.entriesTested += node.entryCount;
+
+                for (uint32_t batchStart = node.firstEntry; batchStart < entryEnd; batchStart += FrustumPlanes::BATCH_WIDTH) {
+                    const uint32_t count = std::min(entryEnd - batchStart, FrustumPlanes::BATCH_WIDTH);
+                    uint32_t mask = queryShape.testBatch(state, mEntryBounds, batchStart, count, counters.planeTests);
+
+                    for (uint32_t lane = 0; mask != 0; ++lane, mask >>= 1) {
+                        if (mask & 1u) {
+                            visitor(batchStart + lane);
+                            ++counters.entriesAccepted;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (item.entriesOnly) {
+            continue;
+        }
+
+        if constexpr (FrontToBack) {
+            // Octants differing from the eye's octant in fewer axes are nearer. Pushing the
+            // farthest ones first makes the nearest pop first. The node's own entries straddle
+            // its split planes, so they go right after the octant holding the eye.
+            const size_t eyeOctant = getOctant(node.bounds, eye);
+            for (size_t axisDistance = 4; axisDistance-- > 0;) {
+                if (axisDistance == 0 && deferEntries && node.entryCount > 0) {
+                    stack[stackSize++] = { item.node, state, true };
+                }
+
+                for (uint32_t child = node.firstChild; child < node.firstChild + node.childCount; ++child) {
+                    const size_t octant = getOctant(node.bounds, mNodes[child].bounds.Center);
+                    if (std::bitset<3>(octant ^ eyeOctant).count() == axisDistance) {
+                        stack[stackSize++] = { child, state };
+                    }
+                }
+            }
+        }
+        else {
+            for (uint32_t childOffset = node.childCount; childOffset > 0; --childOffset) {
+                stack[stackSize++] = { node.firstChild + childOffset - 1, state };
+            }
+        }
+    }
+}
+
 #endif // OCTREE_H
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "overdraw_estimator.h"
+#include "mesh_data.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace {
+    XMFLOAT4 lerpClip(const XMFLOAT4& a, const XMFLOAT4& b, float t) {
+        return XMFLOAT4(
+            a.x + (b.x - a.x) * t,
+            a.y + (b.y - a.y) * t,
+            a.z + (b.z - a.z) * t,
+            a.w + (b.w - a.w) * t);
+    }
+
+    bool allOutside(const XMFLOAT4* v, float XMFLOAT4::* component, float sign) {
+        for (size_t i = 0; i < 3; ++i) {
+            if (sign * (v[i].*component) <= v[i].w) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Pixels exactly on an edge belong to one of the two triangles sharing it, since the
+    // neighbour sees the same edge with both coefficients negated.
+    bool ownsEdgePixel(float edgeA, float edgeB) {
+        return edgeA > 0.0f || (edgeA == 0.0f && edgeB > 0.0f);
+    }
+}
+
+OverdrawEstimator::OverdrawEstimator(uint32_t width, uint32_t height)
+    : mWidth(std::max<uint32_t>(width, 1)),
+    mHeight(std::max<uint32_t>(height, 1)) {
+    mDepth.assign(static_cast<size_t>(mWidth) * mHeight, 1.0f);
+    XMStoreFloat4x4(&mViewProj, XMMatrixIdentity());
+}
+
+void OverdrawEstimator::begin(const XMFLOAT4X4& viewProj) {
+    mViewProj = viewProj;
+    std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+    mPixelsShaded = 0;
+}
+
+void OverdrawEstimator::drawSubmesh(const MeshData& mesh, const Submesh& submesh) {
+    const XMMATRIX viewProj = XMLoadFloat4x4(&mViewProj);
+    const size_t indexEnd = static_cast<size_t>(submesh.startIndiceIndex) + submesh.indexCount;
+
+    for (size_t i = submesh.startIndiceIndex; i + 3 <= indexEnd; i += 3) {
+        XMFLOAT4 v[3];
+        for (size_t k = 0; k < 3; ++k) {
+            const XMFLOAT3& position = mesh.vertices[mesh.indices[i + k]].position;
+            XMStoreFloat4(&v[k], XMVector4Transform(XMVectorSet(position.x, position.y, position.z, 1.0f), viewProj));
+        }
+
+        if (allOutside(v, &XMFLOAT4::x, 1.0f) || allOutside(v, &XMFLOAT4::x, -1.0f) ||
+            allOutside(v, &XMFLOAT4::y, 1.0f) || allOutside(v, &XMFLOAT4::y, -1.0f) ||
+            allOutside(v, &XMFLOAT4::z, 1.0f)) {
+            continue;
+        }
+
+        XMFLOAT4 polygon[4];
+        size_t vertexCount = 0;
+        for (size_t k = 0; k < 3; ++k) {
+            const XMFLOAT4& a = v[k];
+            const XMFLOAT4& b = v[(k + 1) % 3];
+            const bool aInside = a.z >= 0.0f;
+            const bool bInside = b.z >= 0.0f;
+
+            if (aInside) {
+                polygon[vertexCount++] = a;
+            }
+            if (aInside != bInside) {
+                polygon[vertexCount++] = lerpClip(a, b, a.z / (a.z - b.z));
+            }
+        }
+
+        if (vertexCount >= 3) {
+            rasterizeTriangle(polygon[0], polygon[1], polygon[2]);
+        }
+        if (vertexCount == 4) {
+            rasterizeTriangle(polygon[0], polygon[2], polygon[3]);
+        }
+    }
+}
+
+OverdrawEstimator::Stats OverdrawEstimator::getStats() const {
+    Stats stats;
+    stats.pixelsShaded = mPixelsShaded;
+    stats.pixelsCovered = static_cast<size_t>(std::count_if(mDepth.begin(), mDepth.end(), [](float depth) { return depth < 1.0f; }));
+    return stats;
+}
+
+void OverdrawEstimator::rasterizeTriangle(const XMFLOAT4& v0, const XMFLOAT4& v1, const XMFLOAT4& v2) {
+    float x[3];
+    float y[3];
+    float z[3];
+    const XMFLOAT4* v[3] = { &v0, &v1, &v2 };
+
+    for (size_t i = 0; i < 3; ++i) {
+        const float invW = 1.0f / v[i]->w;
+        x[i] = (v[i]->x * invW * 0.5f + 0.5f) * mWidth;
+        y[i] = (0.5f - v[i]->y * invW * 0.5f) * mHeight;
+        z[i] = v[i]->z * invW;
+    }
+
+    // With y pointing down a clockwise triangle has a positive area; the rest are back faces.
+    const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (!(area > 0.0f)) {
+        return;
+    }
+
+    float edgeA[3];
+    float edgeB[3];
+    float edgeC[3];
+    for (size_t i = 0; i < 3; ++i) {
+        const size_t next = (i + 1) % 3;
+        edgeA[i] = y[i] - y[next];
+        edgeB[i] = x[next] - x[i];
+        edgeC[i] = -(edgeA[i] * x[i] + edgeB[i] * y[i]);
+    }
+
+    const float invArea = 1.0f / area;
+    const float depthA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) * invArea;
+    const float depthB = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) * invArea;
+    const float depthC = z[0] - depthA * x[0] - depthB * y[0];
+
+    const int32_t minX = static_cast<int32_t>(std::ceil(std::clamp(std::min({ x[0], x[1], x[2] }) - 0.5f, 0.0f, static_cast<float>(mWidth))));
+    const int32_t maxX = static_cast<int32_t>(std::floor(std::clamp(std::max({ x[0], x[1], x[2] }) - 0.5f, -1.0f, static_cast<float>(mWidth) - 1.0f)));
+    const int32_t minY = static_cast<int32_t>(std::ceil(std::clamp(std::min({ y[0], y[1], y[2] }) - 0.5f, 0.0f, static_cast<float>(mHeight))));
+    const int32_t maxY = static_cast<int32_t>(std::floor(std::clamp(std::max({ y[0], y[1], y[2] }) - 0.5f, -1.0f, static_cast<float>(mHeight) - 1.0f)));
+
+    for (int32_t py = minY; py <= maxY; ++py) {
+        const float pixelY = static_cast<float>(py) + 0.5f;
+        float* row = &mDepth[static_cast<size_t>(py) * mWidth];
+
+        for (int32_t px = minX; px <= maxX; ++px) {
+            const float pixelX = static_cast<float>(px) + 0.5f;
+
+            bool covered = true;
+            for (size_t i = 0; i < 3 && covered; ++i) {
+                const float edge = edgeA[i] * pixelX + edgeB[i] * pixelY + edgeC[i];
+                covered = edge > 0.0f || (edge == 0.0f && ownsEdgePixel(edgeA[i], edgeB[i]));
+            }
+
+            const float depth = depthA * pixelX + depthB * pixelY + depthC;
+            if (covered && depth < row[px]) {
+                row[px] = depth;
+                ++mPixelsShaded;
+            }
+        }
+    }
+}
\ No newline at end of file
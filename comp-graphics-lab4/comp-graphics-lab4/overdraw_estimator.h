@@ -0,0 +1,44 @@
+#ifndef OVERDRAW_ESTIMATOR_H
+#define OVERDRAW_ESTIMATOR_H
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MeshData;
+struct Submesh;
+
+// Headless depth-complexity counter. Triangles are rasterized in submission order into a
+// small depth buffer with an early LESS depth test, and every pixel that passes counts as
+// one pixel shader invocation. Back faces are culled as with the default D3D12 rasterizer
+// state, where clockwise triangles face the viewer.
+class OverdrawEstimator {
+public:
+    struct Stats {
+        size_t pixelsShaded = 0;
+        size_t pixelsCovered = 0;
+
+        double getOverdraw() const {
+            return pixelsCovered > 0 ? static_cast<double>(pixelsShaded) / static_cast<double>(pixelsCovered) : 0.0;
+        }
+    };
+
+    OverdrawEstimator(uint32_t width = 320, uint32_t height = 180);
+
+    void begin(const DirectX::XMFLOAT4X4& viewProj);
+    void drawSubmesh(const MeshData& mesh, const Submesh& submesh);
+    Stats getStats() const;
+
+private:
+    uint32_t mWidth;
+    uint32_t mHeight;
+    std::vector<float> mDepth;
+    size_t mPixelsShaded = 0;
+    DirectX::XMFLOAT4X4 mViewProj;
+
+    void rasterizeTriangle(const DirectX::XMFLOAT4& v0, const DirectX::XMFLOAT4& v1, const DirectX::XMFLOAT4& v2);
+};
+
+#endif // OVERDRAW_ESTIMATOR_H
\ No newline at end of file
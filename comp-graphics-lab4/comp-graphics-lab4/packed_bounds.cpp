@@ -0,0 +1,57 @@
+#include "packed_bounds.h"
+
+using namespace DirectX;
+
+void PackedBounds::clear() {
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    extentX.clear();
+    extentY.clear();
+    extentZ.clear();
+}
+
+void PackedBounds::reserve(size_t count) {
+    centerX.reserve(count);
+    centerY.reserve(count);
+    centerZ.reserve(count);
+    extentX.reserve(count);
+    extentY.reserve(count);
+    extentZ.reserve(count);
+}
+
+void PackedBounds::resize(size_t count) {
+    centerX.resize(count, 0.0f);
+    centerY.resize(count, 0.0f);
+    centerZ.resize(count, 0.0f);
+    extentX.resize(count, 0.0f);
+    extentY.resize(count, 0.0f);
+    extentZ.resize(count, 0.0f);
+}
+
+void PackedBounds::pushBack(const BoundingBox& bounds) {
+    centerX.push_back(bounds.Center.x);
+    centerY.push_back(bounds.Center.y);
+    centerZ.push_back(bounds.Center.z);
+    extentX.push_back(bounds.Extents.x);
+    extentY.push_back(bounds.Extents.y);
+    extentZ.push_back(bounds.Extents.z);
+}
+
+void PackedBounds::set(size_t index, const BoundingBox& bounds) {
+    centerX[index] = bounds.Center.x;
+    centerY[index] = bounds.Center.y;
+    centerZ[index] = bounds.Center.z;
+    extentX[index] = bounds.Extents.x;
+    extentY[index] = bounds.Extents.y;
+    extentZ[index] = bounds.Extents.z;
+}
+
+void PackedBounds::copy(size_t from, size_t to) {
+    centerX[to] = centerX[from];
+    centerY[to] = centerY[from];
+    centerZ[to] = centerZ[from];
+    extentX[to] = extentX[from];
+    extentY[to] = extentY[from];
+    extentZ[to] = extentZ[from];
+}
\ No newline at end of file
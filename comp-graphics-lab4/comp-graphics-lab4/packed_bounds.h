@@ -0,0 +1,32 @@
+#ifndef PACKED_BOUNDS_H
+#define PACKED_BOUNDS_H
+
+#include <DirectXCollision.h>
+
+#include <vector>
+
+// Bounding boxes in structure-of-arrays form so the culling kernel can test several
+// boxes per instruction. Owners pad the arrays past the last box so a batch load
+// never runs off the end.
+struct PackedBounds {
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> extentX;
+    std::vector<float> extentY;
+    std::vector<float> extentZ;
+
+    void clear();
+    void reserve(size_t count);
+    void resize(size_t count);
+    void pushBack(const DirectX::BoundingBox& bounds);
+    void set(size_t index, const DirectX::BoundingBox& bounds);
+    void copy(size_t from, size_t to);
+    DirectX::BoundingBox get(size_t index) const {
+        return DirectX::BoundingBox(DirectX::XMFLOAT3(centerX[index], centerY[index], centerZ[index]),
+            DirectX::XMFLOAT3(extentX[index], extentY[index], extentZ[index]));
+    }
+    size_t getMemoryUsage() const { return centerX.capacity() * sizeof(float) * 6; }
+};
+
+#endif // PACKED_BOUNDS_H
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "pvs.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace {
+    // "PVS0" read as a little-endian integer.
+    constexpr uint32_t FILE_MAGIC = 0x30535650;
+    constexpr size_t MAX_ZERO_RUN = 255;
+
+    struct FileHeader {
+        uint32_t magic = FILE_MAGIC;
+        uint32_t version = PotentiallyVisibleSet::FILE_VERSION;
+        uint32_t submeshCount = 0;
+        uint32_t sourceIndexCount = 0;
+        float originX = 0.0f;
+        float originY = 0.0f;
+        float originZ = 0.0f;
+        float cellSize = 0.0f;
+        uint32_t cellCountX = 0;
+        uint32_t cellCountY = 0;
+        uint32_t cellCountZ = 0;
+        uint32_t compressedSize = 0;
+    };
+
+    void compressSet(const std::vector<uint8_t>& set, std::vector<uint8_t>& out) {
+        for (size_t i = 0; i < set.size();) {
+            if (set[i] != 0) {
+                out.push_back(set[i++]);
+                continue;
+            }
+
+            size_t run = 0;
+            while (i < set.size() && set[i] == 0 && run < MAX_ZERO_RUN) {
+                ++i;
+                ++run;
+            }
+            out.push_back(0);
+            out.push_back(static_cast<uint8_t>(run));
+        }
+    }
+}
+
+PotentiallyVisibleSet::PotentiallyVisibleSet(const Grid& grid, size_t submeshCount, size_t sourceIndexCount,
+    const std::vector<std::vector<uint8_t>>& cellSets)
+    : mGrid(grid), mSubmeshCount(submeshCount), mSourceIndexCount(sourceIndexCount) {
+    mCellOffsets.reserve(cellSets.size() + 1);
+    for (const auto& set : cellSets) {
+        mCellOffsets.push_back(static_cast<uint32_t>(mCompressedSets.size()));
+        compressSet(set, mCompressedSets);
+    }
+    mCellOffsets.push_back(static_cast<uint32_t>(mCompressedSets.size()));
+}
+
+bool PotentiallyVisibleSet::load(const std::string& fileName) {
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    FileHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != FILE_MAGIC || header.version != FILE_VERSION || header.cellSize <= 0.0f) {
+        return false;
+    }
+
+    Grid grid;
+    grid.origin = XMFLOAT3(header.originX, header.originY, header.originZ);
+    grid.cellSize = header.cellSize;
+    grid.cellCountX = header.cellCountX;
+    grid.cellCountY = header.cellCountY;
+    grid.cellCountZ = header.cellCountZ;
+
+    std::vector<uint32_t> cellOffsets(grid.getCellCount() + 1);
+    std::vector<uint8_t> compressedSets(header.compressedSize);
+    in.read(reinterpret_cast<char*>(cellOffsets.data()), cellOffsets.size() * sizeof(uint32_t));
+    in.read(reinterpret_cast<char*>(compressedSets.data()), compressedSets.size());
+    if (!in || cellOffsets.front() != 0 || cellOffsets.back() != header.compressedSize ||
+        !std::is_sorted(cellOffsets.begin(), cellOffsets.end())) {
+        return false;
+    }
+
+    mGrid = grid;
+    mSubmeshCount = header.submeshCount;
+    mSourceIndexCount = header.sourceIndexCount;
+    mCellOffsets = std::move(cellOffsets);
+    mCompressedSets = std::move(compressedSets);
+    return true;
+}
+
+bool PotentiallyVisibleSet::save(const std::string& fileName) const {
+    std::ofstream out(fileName, std::ios::binary);
+
+    FileHeader header;
+    header.submeshCount = static_cast<uint32_t>(mSubmeshCount);
+    header.sourceIndexCount = static_cast<uint32_t>(mSourceIndexCount);
+    header.originX = mGrid.origin.x;
+    header.originY = mGrid.origin.y;
+    header.originZ = mGrid.origin.z;
+    header.cellSize = mGrid.cellSize;
+    header.cellCountX = mGrid.cellCountX;
+    header.cellCountY = mGrid.cellCountY;
+    header.cellCountZ = mGrid.cellCountZ;
+    header.compressedSize = static_cast<uint32_t>(mCompressedSets.size());
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(mCellOffsets.data()), mCellOffsets.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(mCompressedSets.data()), mCompressedSets.size());
+    return static_cast<bool>(out);
+}
+
+size_t PotentiallyVisibleSet::findCell(const XMFLOAT3& point) const {
+    if (empty()) {
+        return INVALID_CELL;
+    }
+
+    const float x = std::floor((point.x - mGrid.origin.x) / mGrid.cellSize);
+    const float y = std::floor((point.y - mGrid.origin.y) / mGrid.cellSize);
+    const float z = std::floor((point.z - mGrid.origin.z) / mGrid.cellSize);
+    if (x < 0.0f || y < 0.0f || z < 0.0f ||
+        x >= static_cast<float>(mGrid.cellCountX) || y >= static_cast<float>(mGrid.cellCountY) ||
+        z >= static_cast<float>(mGrid.cellCountZ)) {
+        return INVALID_CELL;
+    }
+
+    return static_cast<size_t>(x) + mGrid.cellCountX *
+        (static_cast<size_t>(y) + mGrid.cellCountY * static_cast<size_t>(z));
+}
+
+void PotentiallyVisibleSet::getVisibleSet(size_t cell, std::vector<uint8_t>& set) const {
+    set.assign(getSetByteCount(mSubmeshCount), 0);
+
+    size_t out = 0;
+    for (uint32_t i = mCellOffsets[cell]; i < mCellOffsets[cell + 1] && out < set.size(); ++i) {
+        if (mCompressedSets[i] != 0) {
+            set[out++] = mCompressedSets[i];
+        }
+        else if (i + 1 < mCellOffsets[cell + 1]) {
+            out += mCompressedSets[++i];
+        }
+    }
+}
\ No newline at end of file
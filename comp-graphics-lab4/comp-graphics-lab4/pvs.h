@@ -0,0 +1,66 @@
+#ifndef PVS_H
+#define PVS_H
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Precomputed potentially visible sets over a uniform grid of cells. Every cell stores one
+// bit per submesh, set when the submesh may be seen from somewhere inside the cell. The
+// bitsets are compressed by replacing runs of zero bytes with a zero and the run length,
+// since most submeshes are hidden from most cells.
+class PotentiallyVisibleSet {
+public:
+    static constexpr uint32_t FILE_VERSION = 1;
+    static constexpr size_t INVALID_CELL = static_cast<size_t>(-1);
+
+    struct Grid {
+        DirectX::XMFLOAT3 origin = { 0.0f, 0.0f, 0.0f };
+        float cellSize = 1.0f;
+        uint32_t cellCountX = 0;
+        uint32_t cellCountY = 0;
+        uint32_t cellCountZ = 0;
+
+        size_t getCellCount() const { return static_cast<size_t>(cellCountX) * cellCountY * cellCountZ; }
+    };
+
+    PotentiallyVisibleSet() = default;
+
+    // cellSets holds one uncompressed bitset of getSetByteCount(submeshCount) bytes per cell.
+    // sourceIndexCount identifies the geometry the sets were baked from.
+    PotentiallyVisibleSet(const Grid& grid, size_t submeshCount, size_t sourceIndexCount,
+        const std::vector<std::vector<uint8_t>>& cellSets);
+
+    bool load(const std::string& fileName);
+    bool save(const std::string& fileName) const;
+
+    bool empty() const { return mCellOffsets.empty(); }
+    const Grid& getGrid() const { return mGrid; }
+    size_t getSubmeshCount() const { return mSubmeshCount; }
+    size_t getSourceIndexCount() const { return mSourceIndexCount; }
+    size_t getCompressedSize() const { return mCompressedSets.size(); }
+
+    // Returns INVALID_CELL for points outside the grid.
+    size_t findCell(const DirectX::XMFLOAT3& point) const;
+    void getVisibleSet(size_t cell, std::vector<uint8_t>& set) const;
+
+    static size_t getSetByteCount(size_t submeshCount) { return (submeshCount + 7) / 8; }
+    static bool isVisible(const std::vector<uint8_t>& set, size_t submeshIndex) {
+        return (set[submeshIndex >> 3] & (1u << (submeshIndex & 7))) != 0;
+    }
+    static void markVisible(std::vector<uint8_t>& set, size_t submeshIndex) {
+        set[submeshIndex >> 3] |= static_cast<uint8_t>(1u << (submeshIndex & 7));
+    }
+
+private:
+    Grid mGrid;
+    size_t mSubmeshCount = 0;
+    size_t mSourceIndexCount = 0;
+    // Cell i owns mCompressedSets[mCellOffsets[i], mCellOffsets[i + 1]).
+    std::vector<uint32_t> mCellOffsets;
+    std::vector<uint8_t> mCompressedSets;
+};
+
+#endif // PVS_H
\ No newline at end of file
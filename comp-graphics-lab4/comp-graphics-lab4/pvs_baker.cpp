@@ -0,0 +1,188 @@
+#include "pvs_baker.h"
+#include "mesh_data.h"
+#include "scene_occluders.h"
+#include "octree.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace {
+    struct RayHit {
+        float distance;
+        uint32_t submeshIndex;
+    };
+
+    XMFLOAT3 randomDirection(std::mt19937& random) {
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        const float z = 2.0f * unit(random) - 1.0f;
+        const float angle = XM_2PI * unit(random);
+        const float radius = std::sqrt(std::max(1.0f - z * z, 0.0f));
+        return XMFLOAT3(radius * std::cos(angle), radius * std::sin(angle), z);
+    }
+}
+
+PvsBaker::PvsBaker(const Settings& settings) : mSettings(settings) {}
+
+PotentiallyVisibleSet PvsBaker::bake(const MeshData& mesh, ThreadPool* threadPool, BakeStats* stats) const {
+    const size_t submeshCount = mesh.submeshes.size();
+    std::vector<uint32_t> triangleSubmeshes;
+    std::vector<bool> occluderSubmeshes(submeshCount);
+    std::vector<BoundingBox> submeshBounds(submeshCount);
+    std::vector<Octree::Entry> triangleEntries;
+    triangleSubmeshes.reserve(mesh.indices.size() / 3);
+    triangleEntries.reserve(mesh.indices.size() / 3);
+
+    for (size_t submeshIndex = 0; submeshIndex < submeshCount; ++submeshIndex) {
+        const Submesh& submesh = mesh.submeshes[submeshIndex];
+        occluderSubmeshes[submeshIndex] = isOccluderSubmesh(submesh);
+
+        XMVECTOR submeshMin = XMVectorReplicate(FLT_MAX);
+        XMVECTOR submeshMax = XMVectorReplicate(-FLT_MAX);
+        for (UINT i = 0; i + 2 < submesh.indexCount; i += 3) {
+            const uint32_t* triangle = &mesh.indices[submesh.startIndiceIndex + i];
+            XMVECTOR triangleMin = XMVectorReplicate(FLT_MAX);
+            XMVECTOR triangleMax = XMVectorReplicate(-FLT_MAX);
+            for (size_t k = 0; k < 3; ++k) {
+                const XMVECTOR position = XMLoadFloat3(&mesh.vertices[triangle[k]].position);
+                triangleMin = XMVectorMin(triangleMin, position);
+                triangleMax = XMVectorMax(triangleMax, position);
+            }
+
+            BoundingBox bounds;
+            BoundingBox::CreateFromPoints(bounds, triangleMin, triangleMax);
+            triangleEntries.push_back({ triangleEntries.size(), bounds });
+            triangleSubmeshes.push_back(static_cast<uint32_t>(submeshIndex));
+            submeshMin = XMVectorMin(submeshMin, triangleMin);
+            submeshMax = XMVectorMax(submeshMax, triangleMax);
+        }
+
+        if (submesh.indexCount >= 3) {
+            BoundingBox::CreateFromPoints(submeshBounds[submeshIndex], submeshMin, submeshMax);
+        }
+    }
+
+    if (triangleEntries.empty()) {
+        return {};
+    }
+
+    // The triangle positions in query order, so a visited triangle is read from one place.
+    std::vector<XMFLOAT3> trianglePositions(triangleEntries.size() * 3);
+    for (size_t submeshIndex = 0, triangle = 0; submeshIndex < submeshCount; ++submeshIndex) {
+        const Submesh& submesh = mesh.submeshes[submeshIndex];
+        for (UINT i = 0; i + 2 < submesh.indexCount; i += 3, ++triangle) {
+            for (size_t k = 0; k < 3; ++k) {
+                trianglePositions[triangle * 3 + k] = mesh.vertices[mesh.indices[submesh.startIndiceIndex + i + k]].position;
+            }
+        }
+    }
+
+    BoundingBox sceneBounds = triangleEntries.front().bounds;
+    for (const auto& entry : triangleEntries) {
+        BoundingBox::CreateMerged(sceneBounds, sceneBounds, entry.bounds);
+    }
+
+    PotentiallyVisibleSet::Grid grid;
+    grid.cellSize = mSettings.cellSize;
+    grid.origin = XMFLOAT3(sceneBounds.Center.x - sceneBounds.Extents.x, sceneBounds.Center.y - sceneBounds.Extents.y,
+        sceneBounds.Center.z - sceneBounds.Extents.z);
+    grid.cellCountX = std::max(static_cast<uint32_t>(std::ceil(2.0f * sceneBounds.Extents.x / grid.cellSize)), 1u);
+    grid.cellCountY = std::max(static_cast<uint32_t>(std::ceil(2.0f * sceneBounds.Extents.y / grid.cellSize)), 1u);
+    grid.cellCountZ = std::max(static_cast<uint32_t>(std::ceil(2.0f * sceneBounds.Extents.z / grid.cellSize)), 1u);
+
+    const Octree triangleIndex(triangleEntries);
+    const size_t cellCount = grid.getCellCount();
+    std::vector<std::vector<uint8_t>> cellSets(cellCount);
+    std::vector<size_t> cellTriangleTests(cellCount, 0);
+
+    ThreadPool::run(threadPool, cellCount, 1, [&](size_t begin, size_t end) {
+        std::vector<RayHit> hits;
+        for (size_t cell = begin; cell < end; ++cell) {
+            std::vector<uint8_t>& set = cellSets[cell];
+            set.assign(PotentiallyVisibleSet::getSetByteCount(submeshCount), 0);
+
+            const size_t x = cell % grid.cellCountX;
+            const size_t y = (cell / grid.cellCountX) % grid.cellCountY;
+            const size_t z = cell / (static_cast<size_t>(grid.cellCountX) * grid.cellCountY);
+            const XMFLOAT3 cellMin(grid.origin.x + x * grid.cellSize, grid.origin.y + y * grid.cellSize,
+                grid.origin.z + z * grid.cellSize);
+            const float halfCell = 0.5f * grid.cellSize;
+            const BoundingBox cellBounds(XMFLOAT3(cellMin.x + halfCell, cellMin.y + halfCell, cellMin.z + halfCell),
+                XMFLOAT3(halfCell, halfCell, halfCell));
+
+            for (size_t submeshIndex = 0; submeshIndex < submeshCount; ++submeshIndex) {
+                if (mesh.submeshes[submeshIndex].indexCount >= 3 && cellBounds.Intersects(submeshBounds[submeshIndex])) {
+                    PotentiallyVisibleSet::markVisible(set, submeshIndex);
+                }
+            }
+
+            std::seed_seq seed{ mSettings.seed, static_cast<uint32_t>(cell) };
+            std::mt19937 random(seed);
+            std::uniform_real_distribution<float> offset(0.0f, grid.cellSize);
+            size_t triangleTests = 0;
+
+            for (uint32_t sample = 0; sample < mSettings.samplesPerCell; ++sample) {
+                Ray ray;
+                ray.origin = XMFLOAT3(cellMin.x + offset(random), cellMin.y + offset(random), cellMin.z + offset(random));
+                const XMVECTOR origin = XMLoadFloat3(&ray.origin);
+
+                for (uint32_t rayIndex = 0; rayIndex < mSettings.raysPerSample; ++rayIndex) {
+                    ray.direction = randomDirection(random);
+                    const XMVECTOR direction = XMLoadFloat3(&ray.direction);
+
+                    // Triangles arrive roughly nearest first, and a triangle whose box lies
+                    // beyond the nearest occluder hit so far cannot be hit in front of it.
+                    float nearestOccluder = FLT_MAX;
+                    hits.clear();
+                    triangleIndex.queryFrontToBack(ray, ray.origin, [&](size_t triangle, float viewDepth) {
+                        if (viewDepth > nearestOccluder) {
+                            return;
+                        }
+
+                        ++triangleTests;
+                        const XMFLOAT3* positions = &trianglePositions[triangle * 3];
+                        float distance = 0.0f;
+                        if (!TriangleTests::Intersects(origin, direction, XMLoadFloat3(&positions[0]),
+                            XMLoadFloat3(&positions[1]), XMLoadFloat3(&positions[2]), distance)) {
+                            return;
+                        }
+
+                        const uint32_t submeshIndex = triangleSubmeshes[triangle];
+                        if (occluderSubmeshes[submeshIndex]) {
+                            nearestOccluder = std::min(nearestOccluder, distance);
+                        }
+                        hits.push_back({ distance, submeshIndex });
+                    });
+
+                    for (const auto& hit : hits) {
+                        if (hit.distance <= nearestOccluder) {
+                            PotentiallyVisibleSet::markVisible(set, hit.submeshIndex);
+                        }
+                    }
+                }
+            }
+
+            cellTriangleTests[cell] = triangleTests;
+        }
+    });
+
+    if (stats) {
+        *stats = {};
+        stats->cellCount = cellCount;
+        stats->rayCount = cellCount * mSettings.samplesPerCell * mSettings.raysPerSample;
+        size_t visibleCount = 0;
+        for (size_t cell = 0; cell < cellCount; ++cell) {
+            stats->triangleTests += cellTriangleTests[cell];
+            for (size_t submeshIndex = 0; submeshIndex < submeshCount; ++submeshIndex) {
+                visibleCount += PotentiallyVisibleSet::isVisible(cellSets[cell], submeshIndex) ? 1 : 0;
+            }
+        }
+        stats->averageVisibleSubmeshes = static_cast<double>(visibleCount) / static_cast<double>(cellCount);
+    }
+
+    return PotentiallyVisibleSet(grid, submeshCount, mesh.indices.size(), cellSets);
+}
\ No newline at end of file
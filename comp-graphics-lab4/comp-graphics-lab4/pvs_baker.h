@@ -0,0 +1,43 @@
+#ifndef PVS_BAKER_H
+#define PVS_BAKER_H
+
+#include "pvs.h"
+
+#include <cstdint>
+
+struct MeshData;
+class ThreadPool;
+
+// Offline visibility bake for static geometry. The scene bounds are divided into cubic
+// cells; from random points inside each cell rays are cast in random directions against
+// the scene triangles, and every submesh hit before the first occluder triangle is marked
+// visible from the cell. Only submeshes accepted by isOccluderSubmesh stop rays, so
+// animated and alpha-tested geometry never hides anything. Submeshes overlapping a cell are
+// always visible from it.
+class PvsBaker {
+public:
+    struct Settings {
+        float cellSize = 2.0f;
+        uint32_t samplesPerCell = 8;
+        uint32_t raysPerSample = 256;
+        uint32_t seed = 1;
+    };
+
+    struct BakeStats {
+        size_t cellCount = 0;
+        size_t rayCount = 0;
+        size_t triangleTests = 0;
+        double averageVisibleSubmeshes = 0.0;
+    };
+
+    explicit PvsBaker(const Settings& settings);
+
+    // Cells are baked in parallel; each cell draws its samples from a generator seeded with
+    // the cell index, so the result does not depend on the thread count.
+    PotentiallyVisibleSet bake(const MeshData& mesh, ThreadPool* threadPool = nullptr, BakeStats* stats = nullptr) const;
+
+private:
+    Settings mSettings;
+};
+
+#endif // PVS_BAKER_H
\ No newline at end of file
@@ -0,0 +1,134 @@
+#ifndef QUERY_SHAPES_H
+#define QUERY_SHAPES_H
+
+#include "frustum_planes.h"
+#include "packed_bounds.h"
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <bitset>
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+
+// Ray for picking queries. The direction must be normalized.
+struct Ray {
+    DirectX::XMFLOAT3 origin = { 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT3 direction = { 0.0f, 0.0f, 1.0f };
+    float maxDistance = FLT_MAX;
+};
+
+// Compile-time adapters between a query shape and a tree traversal. Each one provides
+//   INITIAL_STATE: the traversal state of the root; a state of zero means the node lies
+//     completely inside the shape, so everything below it is accepted untested.
+//   classify(box, state, rejectingPlaneHint, planeTests): false rejects the box and may clear
+//     the state when the box is inside the shape.
+//   testBatch(state, bounds, first, count, planeTests): bitmask of the count packed boxes
+//     starting at first that intersect the shape.
+template <typename Shape>
+class QueryShape;
+
+template <>
+class QueryShape<DirectX::BoundingFrustum> {
+public:
+    static constexpr uint32_t INITIAL_STATE = FrustumPlanes::ALL_PLANES;
+
+    explicit QueryShape(const DirectX::BoundingFrustum& frustum) : mPlanes(FrustumPlanes::fromFrustum(frustum)) {}
+
+    bool classify(const DirectX::BoundingBox& box, uint32_t& state, const RejectingPlaneHint& rejectingPlaneHint, size_t& planeTests) const {
+        return mPlanes.classifyBox(box, state, rejectingPlaneHint, planeTests);
+    }
+
+    uint32_t testBatch(uint32_t state, const PackedBounds& bounds, uint32_t first, uint32_t count, size_t& planeTests) const {
+        planeTests += std::bitset<6>(state).count() * count;
+        const uint32_t mask = mPlanes.intersectsBatch(state,
+            &bounds.centerX[first], &bounds.centerY[first], &bounds.centerZ[first],
+            &bounds.extentX[first], &bounds.extentY[first], &bounds.extentZ[first]);
+        return count < FrustumPlanes::BATCH_WIDTH ? mask & ((1u << count) - 1u) : mask;
+    }
+
+private:
+    FrustumPlanes mPlanes;
+};
+
+// Shared by the DirectXCollision volumes, which all provide Contains and Intersects for boxes.
+template <typename Volume>
+class VolumeQueryShape {
+public:
+    static constexpr uint32_t INITIAL_STATE = 1;
+
+    explicit VolumeQueryShape(const Volume& volume) : mVolume(volume) {}
+
+    bool classify(const DirectX::BoundingBox& box, uint32_t& state, const RejectingPlaneHint&, size_t&) const {
+        const DirectX::ContainmentType containment = mVolume.Contains(box);
+        if (containment == DirectX::CONTAINS) {
+            state = 0;
+        }
+        return containment != DirectX::DISJOINT;
+    }
+
+    uint32_t testBatch(uint32_t, const PackedBounds& bounds, uint32_t first, uint32_t count, size_t&) const {
+        uint32_t mask = 0;
+        for (uint32_t lane = 0; lane < count; ++lane) {
+            if (mVolume.Intersects(bounds.get(first + lane))) {
+                mask |= 1u << lane;
+            }
+        }
+        return mask;
+    }
+
+private:
+    Volume mVolume;
+};
+
+template <>
+class QueryShape<DirectX::BoundingSphere> : public VolumeQueryShape<DirectX::BoundingSphere> {
+public:
+    using VolumeQueryShape::VolumeQueryShape;
+};
+
+template <>
+class QueryShape<DirectX::BoundingBox> : public VolumeQueryShape<DirectX::BoundingBox> {
+public:
+    using VolumeQueryShape::VolumeQueryShape;
+};
+
+template <>
+class QueryShape<DirectX::BoundingOrientedBox> : public VolumeQueryShape<DirectX::BoundingOrientedBox> {
+public:
+    using VolumeQueryShape::VolumeQueryShape;
+};
+
+template <>
+class QueryShape<Ray> {
+public:
+    static constexpr uint32_t INITIAL_STATE = 1;
+
+    explicit QueryShape(const Ray& ray) : mRay(ray) {}
+
+    bool classify(const DirectX::BoundingBox& box, uint32_t&, const RejectingPlaneHint&, size_t&) const {
+        return hits(box);
+    }
+
+    uint32_t testBatch(uint32_t, const PackedBounds& bounds, uint32_t first, uint32_t count, size_t&) const {
+        uint32_t mask = 0;
+        for (uint32_t lane = 0; lane < count; ++lane) {
+            if (hits(bounds.get(first + lane))) {
+                mask |= 1u << lane;
+            }
+        }
+        return mask;
+    }
+
+private:
+    Ray mRay;
+
+    bool hits(const DirectX::BoundingBox& box) const {
+        float distance = 0.0f;
+        return box.Intersects(DirectX::XMLoadFloat3(&mRay.origin), DirectX::XMLoadFloat3(&mRay.direction), distance) &&
+            distance <= mRay.maxDistance;
+    }
+};
+
+#endif // QUERY_SHAPES_H
\ No newline at end of file
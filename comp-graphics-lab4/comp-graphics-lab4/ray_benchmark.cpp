@@ -0,0 +1,160 @@
+#include "ray_benchmark.h"
+#include "camera_path.h"
+#include "mesh_data.h"
+#include "thread_pool.h"
+#include "triangle_bvh.h"
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <random>
+#include <string>
+
+using namespace DirectX;
+
+namespace {
+    constexpr size_t CAMERA_VIEW_COUNT = 16;
+    constexpr size_t IMAGE_WIDTH = 512;
+    constexpr size_t IMAGE_HEIGHT = 256;
+    constexpr size_t INCOHERENT_RAY_COUNT = CAMERA_VIEW_COUNT * IMAGE_WIDTH * IMAGE_HEIGHT;
+    constexpr size_t RAYS_PER_CHUNK = 256;
+    constexpr size_t REPEAT_COUNT = 2;
+    constexpr float FOV_Y = 0.25f * XM_PI;
+
+    // A packet covers a 2x2 pixel block with 4-wide packets and a 4x2 block with 8-wide ones.
+    constexpr size_t TILE_WIDTH = TriangleBvh::PACKET_WIDTH / 2;
+    constexpr size_t TILE_HEIGHT = 2;
+
+    using Clock = std::chrono::steady_clock;
+
+    double elapsedSeconds(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    std::vector<Ray> createPrimaryRays(const BoundingBox& sceneBounds) {
+        const std::vector<CameraPose> path = createOrbitCameraPath(sceneBounds, CAMERA_VIEW_COUNT);
+        const float aspectRatio = static_cast<float>(IMAGE_WIDTH) / static_cast<float>(IMAGE_HEIGHT);
+        const float tanHalfFov = std::tan(0.5f * FOV_Y);
+
+        std::vector<Ray> rays;
+        rays.reserve(CAMERA_VIEW_COUNT * IMAGE_WIDTH * IMAGE_HEIGHT);
+        for (const auto& pose : path) {
+            const XMVECTOR eye = XMLoadFloat3(&pose.position);
+            const XMVECTOR forward = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&pose.target), eye));
+            const XMVECTOR right = XMVector3Normalize(XMVector3Cross(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), forward));
+            const XMVECTOR up = XMVector3Cross(forward, right);
+
+            for (size_t tileY = 0; tileY < IMAGE_HEIGHT; tileY += TILE_HEIGHT) {
+                for (size_t tileX = 0; tileX < IMAGE_WIDTH; tileX += TILE_WIDTH) {
+                    for (size_t y = tileY; y < tileY + TILE_HEIGHT; ++y) {
+                        for (size_t x = tileX; x < tileX + TILE_WIDTH; ++x) {
+                            const float screenX = (2.0f * (x + 0.5f) / IMAGE_WIDTH - 1.0f) * tanHalfFov * aspectRatio;
+                            const float screenY = (1.0f - 2.0f * (y + 0.5f) / IMAGE_HEIGHT) * tanHalfFov;
+                            const XMVECTOR direction = XMVectorAdd(forward,
+                                XMVectorAdd(XMVectorScale(right, screenX), XMVectorScale(up, screenY)));
+
+                            Ray ray;
+                            ray.origin = pose.position;
+                            XMStoreFloat3(&ray.direction, XMVector3Normalize(direction));
+                            rays.push_back(ray);
+                        }
+                    }
+                }
+            }
+        }
+        return rays;
+    }
+
+    std::vector<Ray> createIncoherentRays(const BoundingBox& sceneBounds) {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        std::vector<Ray> rays(INCOHERENT_RAY_COUNT);
+        for (auto& ray : rays) {
+            ray.origin = XMFLOAT3(sceneBounds.Center.x + unit(random) * sceneBounds.Extents.x,
+                sceneBounds.Center.y + unit(random) * sceneBounds.Extents.y,
+                sceneBounds.Center.z + unit(random) * sceneBounds.Extents.z);
+
+            XMVECTOR direction;
+            do {
+                direction = XMVectorSet(unit(random), unit(random), unit(random), 0.0f);
+            } while (XMVectorGetX(XMVector3LengthSq(direction)) < 1e-4f);
+            XMStoreFloat3(&ray.direction, XMVector3Normalize(direction));
+        }
+        return rays;
+    }
+
+    double traceSingleRays(const TriangleBvh& bvh, const std::vector<Ray>& rays, std::vector<TriangleBvh::RayHit>& hits,
+        ThreadPool* threadPool) {
+        hits.resize(rays.size());
+        const Clock::time_point start = Clock::now();
+        for (size_t repeat = 0; repeat < REPEAT_COUNT; ++repeat) {
+            ThreadPool::run(threadPool, rays.size(), RAYS_PER_CHUNK, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    bvh.intersect(rays[i], hits[i]);
+                }
+            });
+        }
+        return elapsedSeconds(start) / REPEAT_COUNT;
+    }
+
+    double tracePackets(const TriangleBvh& bvh, const std::vector<Ray>& rays, std::vector<TriangleBvh::RayHit>& hits,
+        ThreadPool* threadPool) {
+        const Clock::time_point start = Clock::now();
+        for (size_t repeat = 0; repeat < REPEAT_COUNT; ++repeat) {
+            bvh.intersect(rays, hits, threadPool);
+        }
+        return elapsedSeconds(start) / REPEAT_COUNT;
+    }
+
+    void reportRaySet(const std::string& name, const TriangleBvh& bvh, const std::vector<Ray>& rays, std::ostream& out,
+        ThreadPool* threadPool) {
+        std::vector<TriangleBvh::RayHit> singleHits;
+        std::vector<TriangleBvh::RayHit> packetHits;
+        const double singleSeconds = traceSingleRays(bvh, rays, singleHits, threadPool);
+        const double packetSeconds = tracePackets(bvh, rays, packetHits, threadPool);
+
+        size_t hitCount = 0;
+        size_t mismatchCount = 0;
+        for (size_t i = 0; i < rays.size(); ++i) {
+            hitCount += packetHits[i].isHit() ? 1 : 0;
+            if (singleHits[i].submeshIndex != packetHits[i].submeshIndex ||
+                singleHits[i].triangleIndex != packetHits[i].triangleIndex ||
+                singleHits[i].distance != packetHits[i].distance) {
+                ++mismatchCount;
+            }
+        }
+
+        const double megaRays = static_cast<double>(rays.size()) / 1e6;
+        out << std::left << std::setw(14) << name << std::right << std::fixed << std::setprecision(2) <<
+            std::setw(14) << megaRays / singleSeconds << std::setw(14) << megaRays / packetSeconds <<
+            std::setw(10) << singleSeconds / packetSeconds << std::setprecision(1) <<
+            std::setw(10) << 100.0 * static_cast<double>(hitCount) / static_cast<double>(rays.size()) <<
+            std::setw(12) << mismatchCount << "\n";
+    }
+}
+
+void runRayBenchmark(const MeshData& mesh, std::ostream& out, ThreadPool* threadPool) {
+    TriangleBvh bvh;
+    const Clock::time_point buildStart = Clock::now();
+    bvh.build(mesh);
+    const double buildSeconds = elapsedSeconds(buildStart);
+    if (bvh.empty()) {
+        return;
+    }
+
+    const BoundingBox sceneBounds = bvh.getBounds();
+    const size_t threadCount = threadPool ? threadPool->getThreadCount() : 1;
+    out << "triangle bvh: " << bvh.getTriangleCount() << " triangles, " << bvh.getNodeCount() << " nodes, " <<
+        bvh.getMemoryUsage() / 1024 << " KB, built in " << std::fixed << std::setprecision(1) << buildSeconds * 1000.0 <<
+        " ms\n";
+    out << "packet width " << TriangleBvh::PACKET_WIDTH << ", " << threadCount << " threads\n";
+    out << std::left << std::setw(14) << "rays" << std::right << std::setw(14) << "single Mray/s" <<
+        std::setw(14) << "packet Mray/s" << std::setw(10) << "speedup" << std::setw(10) << "hit %" <<
+        std::setw(12) << "mismatches" << "\n";
+
+    reportRaySet("primary", bvh, createPrimaryRays(sceneBounds), out, threadPool);
+    reportRaySet("incoherent", bvh, createIncoherentRays(sceneBounds), out, threadPool);
+}
\ No newline at end of file
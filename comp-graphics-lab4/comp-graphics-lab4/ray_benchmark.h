@@ -0,0 +1,15 @@
+#ifndef RAY_BENCHMARK_H
+#define RAY_BENCHMARK_H
+
+#include <ostream>
+
+struct MeshData;
+class ThreadPool;
+
+// Builds a TriangleBvh over the mesh and traces coherent primary rays along an orbiting
+// camera path and incoherent rays with random origins and directions, one ray at a time
+// and in packets, on every thread of the pool. Reports Mrays/s and checks that both paths
+// return the same hits.
+void runRayBenchmark(const MeshData& mesh, std::ostream& out, ThreadPool* threadPool = nullptr);
+
+#endif // RAY_BENCHMARK_H
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include "scene_occluders.h"
+#include "mesh_data.h"
+
+#include <string>
+#include <unordered_map>
+
+using namespace DirectX;
+
+bool isOccluderSubmesh(const Submesh& submesh) {
+    const std::string& texture = submesh.material.diffuseTextureName;
+    return texture.find("bricks") != std::string::npos ||
+        texture.find("arch") != std::string::npos ||
+        texture.find("ceiling") != std::string::npos ||
+        texture.find("floor") != std::string::npos;
+}
+
+OcclusionCuller::Occluder createOccluder(const MeshData& mesh, const Submesh& submesh,
+    const XMFLOAT4X4& world, float minTriangleArea) {
+    OcclusionCuller::Occluder occluder;
+    const XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+    std::unordered_map<uint32_t, uint32_t> remap;
+
+    const size_t indexEnd = static_cast<size_t>(submesh.startIndiceIndex) + submesh.indexCount;
+    for (size_t i = submesh.startIndiceIndex; i + 3 <= indexEnd; i += 3) {
+        XMVECTOR corners[3];
+        for (size_t k = 0; k < 3; ++k) {
+            corners[k] = XMVector3TransformCoord(XMLoadFloat3(&mesh.vertices[mesh.indices[i + k]].position), worldMatrix);
+        }
+
+        const XMVECTOR cross = XMVector3Cross(XMVectorSubtract(corners[1], corners[0]), XMVectorSubtract(corners[2], corners[0]));
+        if (0.5f * XMVectorGetX(XMVector3Length(cross)) < minTriangleArea) {
+            continue;
+        }
+
+        for (size_t k = 0; k < 3; ++k) {
+            const uint32_t sourceIndex = mesh.indices[i + k];
+            auto found = remap.find(sourceIndex);
+            if (found == remap.end()) {
+                found = remap.emplace(sourceIndex, static_cast<uint32_t>(occluder.positions.size())).first;
+                XMFLOAT3 position;
+                XMStoreFloat3(&position, corners[k]);
+                occluder.positions.push_back(position);
+            }
+            occluder.indices.push_back(found->second);
+        }
+    }
+
+    return occluder;
+}
\ No newline at end of file
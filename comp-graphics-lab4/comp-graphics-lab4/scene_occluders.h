@@ -0,0 +1,23 @@
+#ifndef SCENE_OCCLUDERS_H
+#define SCENE_OCCLUDERS_H
+
+#include "occlusion_culler.h"
+
+#include <DirectXMath.h>
+
+struct MeshData;
+struct Submesh;
+
+// Occluder selection and extraction for the scene mesh. Kept out of OcclusionCuller so the
+// culler itself builds with nothing but DirectXMath and the thread pool.
+
+// Copies the submesh triangles into world space. Triangles smaller than minTriangleArea
+// are dropped; removing occluder geometry can only make the culling less aggressive.
+OcclusionCuller::Occluder createOccluder(const MeshData& mesh, const Submesh& submesh,
+    const DirectX::XMFLOAT4X4& world, float minTriangleArea = 0.0f);
+
+// Walls, arches, floors and ceilings: large, opaque and static. Columns are animated
+// in the vertex shader and the plants and chains are alpha tested, so they are skipped.
+bool isOccluderSubmesh(const Submesh& submesh);
+
+#endif // SCENE_OCCLUDERS_H
\ No newline at end of file
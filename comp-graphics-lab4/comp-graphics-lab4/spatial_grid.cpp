@@ -0,0 +1,303 @@
+#include "spatial_grid.h"
+#include "frustum_planes.h"
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <bitset>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace {
+    constexpr int64_t CELL_COORD_OFFSET = int64_t(1) << 20;
+    constexpr int64_t CELL_COORD_MAX = (int64_t(1) << 21) - 1;
+
+    uint64_t cellCoordinate(float value, float origin, float cellSize) {
+        const float cell = std::floor((value - origin) / cellSize);
+        const float clamped = std::clamp(cell, -static_cast<float>(CELL_COORD_OFFSET), static_cast<float>(CELL_COORD_OFFSET));
+        return static_cast<uint64_t>(std::min(static_cast<int64_t>(clamped) + CELL_COORD_OFFSET, CELL_COORD_MAX));
+    }
+
+    // Cells have no spatial order to walk, so ordered results are sorted afterwards.
+    void sortByViewDepth(std::vector<SpatialIndex::DepthVisibility>& visibleObjects, size_t firstVisible) {
+        std::sort(visibleObjects.begin() + firstVisible, visibleObjects.end(),
+            [](const SpatialIndex::DepthVisibility& a, const SpatialIndex::DepthVisibility& b) { return a.viewDepth < b.viewDepth; });
+    }
+}
+
+SpatialGrid::SpatialGrid(const BuildSettings& settings) : mSettings(settings) {
+    mSettings.targetEntriesPerCell = std::max<size_t>(settings.targetEntriesPerCell, 1);
+}
+
+void SpatialGrid::rebuild(const std::vector<Entry>& entries) {
+    mHandles.clear();
+    mFreeHandles.clear();
+    mHandles.reserve(entries.size());
+
+    for (const auto& entry : entries) {
+        HandleRecord record;
+        record.entry = entry;
+        record.live = true;
+        mHandles.push_back(record);
+    }
+
+    rebuildFromHandles();
+}
+
+// Calls visitor(objectIndex, bounds) for every visible entry.
+template <typename Visitor>
+void SpatialGrid::traverse(const BoundingFrustum& frustum, Visitor&& visitor, QueryStats& counters) const {
+    const FrustumPlanes planes = FrustumPlanes::fromFrustum(frustum);
+    const auto visit = [&](const Entry& entry) {
+        visitor(entry.objectIndex, entry.bounds);
+        ++counters.entriesAccepted;
+    };
+
+    for (const auto& cell : mCells) {
+        if (cell.handles.empty()) {
+            continue;
+        }
+
+        uint32_t planeMask = FrustumPlanes::ALL_PLANES;
+        ++counters.nodesVisited;
+        if (!planes.classifyBox(cell.bounds, planeMask, cell.lastRejectingPlane, counters.planeTests)) {
+            continue;
+        }
+
+        if (planeMask == 0) {
+            for (Handle handle : cell.handles) {
+                visit(mHandles[handle].entry);
+            }
+            continue;
+        }
+
+        counters.entriesTested += cell.handles.size();
+        counters.planeTests += std::bitset<6>(planeMask).count() * cell.handles.size();
+        for (Handle handle : cell.handles) {
+            const Entry& entry = mHandles[handle].entry;
+            if (planes.intersectsBox(entry.bounds, planeMask)) {
+                visit(entry);
+            }
+        }
+    }
+}
+
+void SpatialGrid::query(const BoundingFrustum& frustum, std::vector<size_t>& visibleObjects, QueryStats* stats) const {
+    QueryStats counters;
+    traverse(frustum, [&visibleObjects](size_t objectIndex, const BoundingBox&) { visibleObjects.push_back(objectIndex); }, counters);
+
+    if (stats) {
+        *stats = counters;
+    }
+}
+
+void SpatialGrid::queryFrontToBack(const BoundingFrustum& frustum, const XMFLOAT3& eye, std::vector<DepthVisibility>& visibleObjects,
+    QueryStats* stats) const {
+    const size_t firstVisible = visibleObjects.size();
+    QueryStats counters;
+    traverse(frustum, [&visibleObjects, &eye](size_t objectIndex, const BoundingBox& bounds) {
+        visibleObjects.push_back({ objectIndex, getViewDepth(bounds, eye) });
+    }, counters);
+
+    sortByViewDepth(visibleObjects, firstVisible);
+    if (stats) {
+        *stats = counters;
+    }
+}
+
+void SpatialGrid::query(const BoundingFrustum& frustum, const ContributionCulling& contribution, std::vector<size_t>& visibleObjects,
+    std::vector<size_t>* impostorObjects, QueryStats* stats) const {
+    QueryStats counters;
+    traverse(frustum, [&](size_t objectIndex, const BoundingBox& bounds) {
+        if (passesContribution(contribution, objectIndex, bounds, impostorObjects, counters)) {
+            visibleObjects.push_back(objectIndex);
+        }
+    }, counters);
+
+    if (stats) {
+        *stats = counters;
+    }
+}
+
+void SpatialGrid::queryFrontToBack(const BoundingFrustum& frustum, const ContributionCulling& contribution,
+    std::vector<DepthVisibility>& visibleObjects, std::vector<size_t>* impostorObjects, QueryStats* stats) const {
+    const size_t firstVisible = visibleObjects.size();
+    QueryStats counters;
+    traverse(frustum, [&](size_t objectIndex, const BoundingBox& bounds) {
+        if (passesContribution(contribution, objectIndex, bounds, impostorObjects, counters)) {
+            visibleObjects.push_back({ objectIndex, getViewDepth(bounds, contribution.eye) });
+        }
+    }, counters);
+
+    sortByViewDepth(visibleObjects, firstVisible);
+    if (stats) {
+        *stats = counters;
+    }
+}
+
+SpatialGrid::Handle SpatialGrid::insert(const Entry& entry) {
+    Handle handle;
+    if (!mFreeHandles.empty()) {
+        handle = mFreeHandles.back();
+        mFreeHandles.pop_back();
+    }
+    else {
+        handle = static_cast<Handle>(mHandles.size());
+        mHandles.emplace_back();
+    }
+
+    HandleRecord& record = mHandles[handle];
+    record.entry = entry;
+    record.live = true;
+    addToCell(handle);
+    ++mLiveEntryCount;
+    ++mStaleCount;
+
+    rebuildIfNeeded();
+    return handle;
+}
+
+void SpatialGrid::remove(Handle handle) {
+    if (handle >= mHandles.size() || !mHandles[handle].live) {
+        return;
+    }
+
+    removeFromCell(handle);
+    mHandles[handle].live = false;
+    mFreeHandles.push_back(handle);
+    --mLiveEntryCount;
+    ++mStaleCount;
+
+    rebuildIfNeeded();
+}
+
+void SpatialGrid::update(Handle handle, const BoundingBox& bounds) {
+    if (handle >= mHandles.size() || !mHandles[handle].live) {
+        return;
+    }
+
+    HandleRecord& record = mHandles[handle];
+    record.entry.bounds = bounds;
+
+    const auto cellIt = mCellLookup.find(getCellKey(bounds.Center));
+    if (cellIt != mCellLookup.end() && cellIt->second == record.cell) {
+        Cell& cell = mCells[record.cell];
+        BoundingBox::CreateMerged(cell.bounds, cell.bounds, bounds);
+    }
+    else {
+        removeFromCell(handle);
+        addToCell(handle);
+    }
+
+    ++mStaleCount;
+    rebuildIfNeeded();
+}
+
+size_t SpatialGrid::getMemoryUsage() const {
+    size_t usage = mCells.capacity() * sizeof(Cell) + mHandles.capacity() * sizeof(HandleRecord) +
+        mFreeHandles.capacity() * sizeof(Handle);
+
+    for (const auto& cell : mCells) {
+        usage += cell.handles.capacity() * sizeof(Handle);
+    }
+
+    // Approximates the node-based hash map as one node per cell plus the bucket array.
+    usage += mCellLookup.size() * (sizeof(std::pair<const uint64_t, uint32_t>) + 2 * sizeof(void*)) +
+        mCellLookup.bucket_count() * sizeof(void*);
+    return usage;
+}
+
+void SpatialGrid::rebuildFromHandles() {
+    mCells.clear();
+    mCellLookup.clear();
+    mLiveEntryCount = 0;
+    mStaleCount = 0;
+
+    XMVECTOR sceneMin = XMVectorReplicate(FLT_MAX);
+    XMVECTOR sceneMax = XMVectorReplicate(-FLT_MAX);
+    for (const auto& record : mHandles) {
+        if (!record.live) {
+            continue;
+        }
+
+        const XMVECTOR center = XMLoadFloat3(&record.entry.bounds.Center);
+        const XMVECTOR extents = XMLoadFloat3(&record.entry.bounds.Extents);
+        sceneMin = XMVectorMin(sceneMin, XMVectorSubtract(center, extents));
+        sceneMax = XMVectorMax(sceneMax, XMVectorAdd(center, extents));
+        ++mLiveEntryCount;
+    }
+
+    if (mLiveEntryCount == 0) {
+        mOrigin = { 0.0f, 0.0f, 0.0f };
+        mCellSize = mSettings.cellSize > 0.0f ? mSettings.cellSize : 1.0f;
+        return;
+    }
+
+    XMStoreFloat3(&mOrigin, sceneMin);
+    XMFLOAT3 size;
+    XMStoreFloat3(&size, XMVectorSubtract(sceneMax, sceneMin));
+
+    mCellSize = mSettings.cellSize;
+    if (!(mCellSize > 0.0f)) {
+        // Flat scenes would get a zero volume, so every axis counts as at least 1% of the largest one.
+        const float largest = std::max({ size.x, size.y, size.z, FLT_MIN });
+        const float volume = std::max(size.x, largest * 0.01f) * std::max(size.y, largest * 0.01f) * std::max(size.z, largest * 0.01f);
+        const float cellCount = static_cast<float>(mLiveEntryCount) / static_cast<float>(mSettings.targetEntriesPerCell);
+        mCellSize = std::cbrt(volume / std::max(cellCount, 1.0f));
+    }
+
+    mCells.reserve(mLiveEntryCount / mSettings.targetEntriesPerCell + 1);
+    for (Handle handle = 0; handle < mHandles.size(); ++handle) {
+        if (mHandles[handle].live) {
+            addToCell(handle);
+        }
+    }
+}
+
+uint64_t SpatialGrid::getCellKey(const XMFLOAT3& point) const {
+    return (cellCoordinate(point.x, mOrigin.x, mCellSize) << (2 * CELL_COORD_BITS)) |
+        (cellCoordinate(point.y, mOrigin.y, mCellSize) << CELL_COORD_BITS) |
+        cellCoordinate(point.z, mOrigin.z, mCellSize);
+}
+
+uint32_t SpatialGrid::findOrCreateCell(const XMFLOAT3& point) {
+    const auto inserted = mCellLookup.emplace(getCellKey(point), static_cast<uint32_t>(mCells.size()));
+    if (inserted.second) {
+        mCells.emplace_back();
+    }
+
+    return inserted.first->second;
+}
+
+void SpatialGrid::addToCell(Handle handle) {
+    HandleRecord& record = mHandles[handle];
+    record.cell = findOrCreateCell(record.entry.bounds.Center);
+
+    Cell& cell = mCells[record.cell];
+    if (cell.handles.empty()) {
+        cell.bounds = record.entry.bounds;
+    }
+    else {
+        BoundingBox::CreateMerged(cell.bounds, cell.bounds, record.entry.bounds);
+    }
+
+    record.slot = static_cast<uint32_t>(cell.handles.size());
+    cell.handles.push_back(handle);
+}
+
+void SpatialGrid::removeFromCell(Handle handle) {
+    const HandleRecord& record = mHandles[handle];
+    Cell& cell = mCells[record.cell];
+
+    const Handle moved = cell.handles.back();
+    cell.handles[record.slot] = moved;
+    mHandles[moved].slot = record.slot;
+    cell.handles.pop_back();
+}
+
+void SpatialGrid::rebuildIfNeeded() {
+    if (mStaleCount > std::max(MIN_REBUILD_CHANGES, mLiveEntryCount)) {
+        rebuildFromHandles();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include "frustum_planes.h"
+#include "spatial_index.h"
+
+#include <DirectXCollision.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Uniform grid over the scene. Each entry is stored in the cell containing its center,
+// and a cell's bounds enclose all of its entries, so large objects only widen the bounds
+// of one cell instead of being duplicated. Only occupied cells are stored.
+class SpatialGrid : public SpatialIndex {
+public:
+    struct BuildSettings {
+        // Zero picks the cell size so an average cell holds targetEntriesPerCell entries.
+        float cellSize = 0.0f;
+        size_t targetEntriesPerCell = 8;
+    };
+
+    SpatialGrid() = default;
+    explicit SpatialGrid(const BuildSettings& settings);
+
+    void rebuild(const std::vector<Entry>& entries) override;
+    using SpatialIndex::query;
+    void query(const DirectX::BoundingFrustum& frustum, std::vector<size_t>& visibleObjects,
+        QueryStats* stats = nullptr) const override;
+    void queryFrontToBack(const DirectX::BoundingFrustum& frustum, const DirectX::XMFLOAT3& eye,
+        std::vector<DepthVisibility>& visibleObjects, QueryStats* stats = nullptr) const override;
+    void query(const DirectX::BoundingFrustum& frustum, const ContributionCulling& contribution,
+        std::vector<size_t>& visibleObjects, std::vector<size_t>* impostorObjects, QueryStats* stats = nullptr) const override;
+    void queryFrontToBack(const DirectX::BoundingFrustum& frustum, const ContributionCulling& contribution,
+        std::vector<DepthVisibility>& visibleObjects, std::vector<size_t>* impostorObjects, QueryStats* stats = nullptr) const override;
+
+    Handle insert(const Entry& entry) override;
+    void remove(Handle handle) override;
+    void update(Handle handle, const DirectX::BoundingBox& bounds) override;
+
+    size_t getCellCount() const { return mCells.size(); }
+    float getCellSize() const { return mCellSize; }
+    size_t getEntryCount() const override { return mLiveEntryCount; }
+    size_t getMemoryUsage() const override;
+
+private:
+    // Cell bounds only ever grow between rebuilds; removing or moving entries leaves them stale.
+    struct Cell {
+        DirectX::BoundingBox bounds = {};
+        std::vector<Handle> handles;
+        RejectingPlaneHint lastRejectingPlane;
+    };
+
+    struct HandleRecord {
+        Entry entry = {};
+        uint32_t cell = 0;
+        uint32_t slot = 0;
+        bool live = false;
+    };
+
+    static constexpr unsigned CELL_COORD_BITS = 21;
+    static constexpr size_t MIN_REBUILD_CHANGES = 64;
+
+    BuildSettings mSettings;
+    float mCellSize = 1.0f;
+    DirectX::XMFLOAT3 mOrigin = { 0.0f, 0.0f, 0.0f };
+    std::vector<Cell> mCells;
+    std::unordered_map<uint64_t, uint32_t> mCellLookup;
+    std::vector<HandleRecord> mHandles;
+    std::vector<Handle> mFreeHandles;
+    size_t mLiveEntryCount = 0;
+    size_t mStaleCount = 0;
+
+    template <typename Visitor>
+    void traverse(const DirectX::BoundingFrustum& frustum, Visitor&& visitor, QueryStats& counters) const;
+    void rebuildFromHandles();
+    uint64_t getCellKey(const DirectX::XMFLOAT3& point) const;
+    uint32_t findOrCreateCell(const DirectX::XMFLOAT3& point);
+    void addToCell(Handle handle);
+    void removeFromCell(Handle handle);
+    void rebuildIfNeeded();
+};
+
+#endif // SPATIAL_GRID_H
\ No newline at end of file
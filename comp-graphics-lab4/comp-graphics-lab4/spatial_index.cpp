@@ -0,0 +1,135 @@
+#include "spatial_index.h"
+#include "bvh.h"
+#include "octree.h"
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+    constexpr SpatialIndexType SPATIAL_INDEX_TYPES[] = {
+        SpatialIndexType::Octree, SpatialIndexType::LooseOctree, SpatialIndexType::Bvh, SpatialIndexType::Grid };
+    constexpr float LOOSE_OCTREE_LOOSENESS = 2.0f;
+}
+
+std::vector<size_t> SpatialIndex::query(const DirectX::BoundingFrustum& frustum, QueryStats* stats) const {
+    std::vector<size_t> visibleObjects;
+    query(frustum, visibleObjects, stats);
+    return visibleObjects;
+}
+
+std::vector<SpatialIndex::ViewVisibility> SpatialIndex::queryViews(const std::vector<DirectX::BoundingFrustum>& frustums,
+    QueryStats* stats) const {
+    std::vector<ViewVisibility> visibleObjects;
+    std::unordered_map<size_t, size_t> resultIndices;
+    QueryStats counters;
+
+    const size_t viewCount = std::min(frustums.size(), MAX_VIEWS);
+    for (size_t view = 0; view < viewCount; ++view) {
+        QueryStats viewStats;
+        for (size_t objectIndex : query(frustums[view], &viewStats)) {
+            const auto inserted = resultIndices.emplace(objectIndex, visibleObjects.size());
+            if (inserted.second) {
+                visibleObjects.push_back({ objectIndex, 0 });
+            }
+            visibleObjects[inserted.first->second].viewMask |= 1u << view;
+        }
+
+        counters.nodesVisited += viewStats.nodesVisited;
+        counters.planeTests += viewStats.planeTests;
+        counters.entriesTested += viewStats.entriesTested;
+    }
+
+    counters.entriesAccepted = visibleObjects.size();
+    if (stats) {
+        *stats = counters;
+    }
+
+    return visibleObjects;
+}
+
+float SpatialIndex::getViewDepth(const DirectX::BoundingBox& bounds, const DirectX::XMFLOAT3& eye) {
+    const float dx = std::max(std::fabs(eye.x - bounds.Center.x) - bounds.Extents.x, 0.0f);
+    const float dy = std::max(std::fabs(eye.y - bounds.Center.y) - bounds.Extents.y, 0.0f);
+    const float dz = std::max(std::fabs(eye.z - bounds.Center.z) - bounds.Extents.z, 0.0f);
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+SpatialIndex::ContributionCulling SpatialIndex::ContributionCulling::fromProjection(const DirectX::XMFLOAT3& eye,
+    const DirectX::XMFLOAT4X4& proj, float viewportHeight, float minPixelSize) {
+    ContributionCulling contribution;
+    contribution.eye = eye;
+    contribution.pixelsPerUnit = 0.5f * viewportHeight * proj.m[1][1];
+    contribution.minPixelSize = minPixelSize;
+    return contribution;
+}
+
+// Compares squared diameter and distance to avoid the square roots.
+bool SpatialIndex::ContributionCulling::isTooSmall(const DirectX::BoundingBox& bounds) const {
+    const float radiusSquared = bounds.Extents.x * bounds.Extents.x + bounds.Extents.y * bounds.Extents.y +
+        bounds.Extents.z * bounds.Extents.z;
+    const float dx = bounds.Center.x - eye.x;
+    const float dy = bounds.Center.y - eye.y;
+    const float dz = bounds.Center.z - eye.z;
+    const float distanceSquared = dx * dx + dy * dy + dz * dz;
+    return 4.0f * radiusSquared * pixelsPerUnit * pixelsPerUnit < minPixelSize * minPixelSize * distanceSquared;
+}
+
+bool SpatialIndex::passesContribution(const ContributionCulling& contribution, size_t objectIndex,
+    const DirectX::BoundingBox& bounds, std::vector<size_t>* impostorObjects, QueryStats& counters) {
+    if (!contribution.isTooSmall(bounds)) {
+        return true;
+    }
+
+    ++counters.entriesContributionCulled;
+    if (impostorObjects) {
+        impostorObjects->push_back(objectIndex);
+    }
+    return false;
+}
+
+std::unique_ptr<SpatialIndex> SpatialIndex::create(SpatialIndexType type, ThreadPool* threadPool) {
+    switch (type) {
+    case SpatialIndexType::Bvh:
+        return std::make_unique<Bvh>();
+    case SpatialIndexType::Grid:
+        return std::make_unique<SpatialGrid>();
+    case SpatialIndexType::Octree:
+    case SpatialIndexType::LooseOctree:
+    default: {
+        Octree::BuildSettings settings;
+        settings.maxObjectsPerNode = 24;
+        settings.maxDepth = 8;
+        settings.method = Octree::BuildMethod::Morton;
+        settings.threadPool = threadPool;
+        settings.looseness = type == SpatialIndexType::LooseOctree ? LOOSE_OCTREE_LOOSENESS : 1.0f;
+        return std::make_unique<Octree>(settings);
+    }
+    }
+}
+
+const char* SpatialIndex::getTypeName(SpatialIndexType type) {
+    switch (type) {
+    case SpatialIndexType::Bvh:
+        return "bvh";
+    case SpatialIndexType::Grid:
+        return "grid";
+    case SpatialIndexType::LooseOctree:
+        return "loose-octree";
+    case SpatialIndexType::Octree:
+    default:
+        return "octree";
+    }
+}
+
+bool SpatialIndex::parseType(const std::string& name, SpatialIndexType& type) {
+    for (SpatialIndexType candidate : SPATIAL_INDEX_TYPES) {
+        if (name == getTypeName(candidate)) {
+            type = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
\ No newline at end of file
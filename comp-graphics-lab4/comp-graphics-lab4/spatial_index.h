@@ -0,0 +1,115 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+enum class SpatialIndexType {
+    Octree,
+    LooseOctree,
+    Bvh,
+    Grid
+};
+
+// Common interface of the scene culling structures so the renderer and the benchmarks
+// can switch backends at startup.
+class SpatialIndex {
+public:
+    struct Entry {
+        size_t objectIndex = 0;
+        DirectX::BoundingBox bounds = {};
+    };
+
+    using Handle = uint32_t;
+
+    struct QueryStats {
+        size_t nodesVisited = 0;
+        size_t planeTests = 0;
+        size_t entriesTested = 0;
+        size_t entriesAccepted = 0;
+        size_t entriesContributionCulled = 0;
+    };
+
+    // Screen-size threshold of a query. pixelsPerUnit is the projected size in pixels of a
+    // unit length at unit distance in front of the eye.
+    struct ContributionCulling {
+        DirectX::XMFLOAT3 eye = { 0.0f, 0.0f, 0.0f };
+        float pixelsPerUnit = 0.0f;
+        float minPixelSize = 0.0f;
+
+        static ContributionCulling fromProjection(const DirectX::XMFLOAT3& eye, const DirectX::XMFLOAT4X4& proj,
+            float viewportHeight, float minPixelSize);
+
+        // True when the bounding sphere of the box covers fewer than minPixelSize pixels across.
+        bool isTooSmall(const DirectX::BoundingBox& bounds) const;
+    };
+
+    // Bit v of viewMask is set when the entry intersects frustum v of a multi-view query.
+    struct ViewVisibility {
+        size_t objectIndex = 0;
+        uint32_t viewMask = 0;
+    };
+
+    // viewDepth is the distance from the eye to the nearest point of the entry bounds.
+    struct DepthVisibility {
+        size_t objectIndex = 0;
+        float viewDepth = 0.0f;
+    };
+
+    static constexpr Handle INVALID_HANDLE = ~0u;
+    static constexpr size_t MAX_VIEWS = 32;
+
+    virtual ~SpatialIndex() = default;
+
+    // Handle i refers to entries[i] after a rebuild.
+    virtual void rebuild(const std::vector<Entry>& entries) = 0;
+    // Appends the visible objects, so callers can keep one buffer across frames. Queries may run
+    // concurrently with each other, but not with rebuilds or updates.
+    virtual void query(const DirectX::BoundingFrustum& frustum, std::vector<size_t>& visibleObjects,
+        QueryStats* stats = nullptr) const = 0;
+    std::vector<size_t> query(const DirectX::BoundingFrustum& frustum, QueryStats* stats = nullptr) const;
+    // Appends the visible objects in approximately front-to-back order from the eye, close
+    // enough for early depth rejection without sorting the whole list afterwards.
+    virtual void queryFrontToBack(const DirectX::BoundingFrustum& frustum, const DirectX::XMFLOAT3& eye,
+        std::vector<DepthVisibility>& visibleObjects, QueryStats* stats = nullptr) const = 0;
+
+    // Same as the queries above, except that visible entries too small on screen go to
+    // impostorObjects, or are dropped when it is null. Front-to-back order is from contribution.eye.
+    virtual void query(const DirectX::BoundingFrustum& frustum, const ContributionCulling& contribution,
+        std::vector<size_t>& visibleObjects, std::vector<size_t>* impostorObjects, QueryStats* stats = nullptr) const = 0;
+    virtual void queryFrontToBack(const DirectX::BoundingFrustum& frustum, const ContributionCulling& contribution,
+        std::vector<DepthVisibility>& visibleObjects, std::vector<size_t>* impostorObjects, QueryStats* stats = nullptr) const = 0;
+
+    // Culls against up to MAX_VIEWS frusta at once and returns every entry visible in at
+    // least one of them. The default runs one query per view and merges the results.
+    virtual std::vector<ViewVisibility> queryViews(const std::vector<DirectX::BoundingFrustum>& frustums,
+        QueryStats* stats = nullptr) const;
+
+    // Handles stay valid until removed, including across internal rebalancing.
+    virtual Handle insert(const Entry& entry) = 0;
+    virtual void remove(Handle handle) = 0;
+    virtual void update(Handle handle, const DirectX::BoundingBox& bounds) = 0;
+
+    virtual size_t getEntryCount() const = 0;
+    virtual size_t getMemoryUsage() const = 0;
+
+    static float getViewDepth(const DirectX::BoundingBox& bounds, const DirectX::XMFLOAT3& eye);
+
+    static std::unique_ptr<SpatialIndex> create(SpatialIndexType type, ThreadPool* threadPool = nullptr);
+    static const char* getTypeName(SpatialIndexType type);
+    static bool parseType(const std::string& name, SpatialIndexType& type);
+
+protected:
+    // Returns false, after moving the object to impostorObjects, when it fails the size test.
+    static bool passesContribution(const ContributionCulling& contribution, size_t objectIndex,
+        const DirectX::BoundingBox& bounds, std::vector<size_t>* impostorObjects, QueryStats& counters);
+};
+
+#endif // SPATIAL_INDEX_H
\ No newline at end of file
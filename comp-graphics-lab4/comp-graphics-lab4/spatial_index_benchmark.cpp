@@ -0,0 +1,691 @@
+#include "spatial_index_benchmark.h"
+#include "camera_path.h"
+#include "mesh_data.h"
+#include "octree.h"
+#include "thread_pool.h"
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+
+using namespace DirectX;
+
+namespace {
+    constexpr size_t SYNTHETIC_ENTRY_COUNT = 20000;
+    constexpr size_t PARALLEL_QUERY_ENTRY_COUNT = 1000000;
+    constexpr size_t CLUSTER_COUNT = 32;
+    constexpr size_t CAMERA_VIEW_COUNT = 64;
+    constexpr size_t QUERY_REPEAT_COUNT = 4;
+    constexpr size_t LAYOUT_ENTRY_COUNTS[] = { 10000, 100000, 1000000 };
+    constexpr size_t UPDATE_ENTRY_COUNT = 100000;
+    constexpr size_t UPDATE_MOVING_COUNTS[] = { 1000, 5000, 20000 };
+    constexpr size_t UPDATE_FRAME_COUNT = 100;
+    constexpr float UPDATE_MAX_SPEED = 1.0f;
+    constexpr size_t BUILD_ENTRY_COUNTS[] = { 100000, 1000000 };
+    constexpr size_t BUILD_REPEAT_COUNT = 3;
+    constexpr size_t CASCADE_ENTRY_COUNT = 100000;
+    constexpr size_t CASCADE_COUNT = 6;
+    constexpr size_t CASCADE_POSE_COUNT = 16;
+    // Blend between logarithmic and uniform cascade splits, as in practical split schemes.
+    constexpr float CASCADE_SPLIT_LAMBDA = 0.5f;
+    constexpr SpatialIndexType BACKENDS[] = {
+        SpatialIndexType::Octree, SpatialIndexType::LooseOctree, SpatialIndexType::Bvh, SpatialIndexType::Grid };
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Dataset {
+        std::string name;
+        std::vector<SpatialIndex::Entry> entries;
+    };
+
+    double elapsedMicroseconds(Clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    SpatialIndex::Entry makeEntry(size_t index, const XMFLOAT3& center, const XMFLOAT3& extents) {
+        SpatialIndex::Entry entry;
+        entry.objectIndex = index;
+        entry.bounds = BoundingBox(center, extents);
+        return entry;
+    }
+
+    Dataset createUniformDataset(size_t entryCount = SYNTHETIC_ENTRY_COUNT) {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> size(0.2f, 2.0f);
+
+        Dataset dataset{ "uniform", {} };
+        for (size_t i = 0; i < entryCount; ++i) {
+            const XMFLOAT3 center(position(random), position(random), position(random));
+            const XMFLOAT3 extents(size(random), size(random), size(random));
+            dataset.entries.push_back(makeEntry(i, center, extents));
+        }
+        return dataset;
+    }
+
+    Dataset createClusteredDataset() {
+        std::mt19937 random(2);
+        std::uniform_real_distribution<float> clusterPosition(-100.0f, 100.0f);
+        std::normal_distribution<float> offset(0.0f, 4.0f);
+        std::uniform_real_distribution<float> size(0.1f, 1.0f);
+
+        std::vector<XMFLOAT3> clusters;
+        for (size_t i = 0; i < CLUSTER_COUNT; ++i) {
+            clusters.emplace_back(clusterPosition(random), clusterPosition(random), clusterPosition(random));
+        }
+
+        Dataset dataset{ "clustered", {} };
+        for (size_t i = 0; i < SYNTHETIC_ENTRY_COUNT; ++i) {
+            const XMFLOAT3& cluster = clusters[i % CLUSTER_COUNT];
+            const XMFLOAT3 center(cluster.x + offset(random), cluster.y + offset(random), cluster.z + offset(random));
+            const XMFLOAT3 extents(size(random), size(random), size(random));
+            dataset.entries.push_back(makeEntry(i, center, extents));
+        }
+        return dataset;
+    }
+
+    // A long corridor of elongated objects, the worst case for cubic cells.
+    Dataset createLongThinDataset() {
+        std::mt19937 random(3);
+        std::uniform_real_distribution<float> along(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> across(-10.0f, 10.0f);
+        std::uniform_real_distribution<float> length(1.0f, 20.0f);
+        std::uniform_real_distribution<float> thickness(0.05f, 0.3f);
+
+        Dataset dataset{ "long-thin", {} };
+        for (size_t i = 0; i < SYNTHETIC_ENTRY_COUNT; ++i) {
+            const XMFLOAT3 center(along(random), across(random), across(random));
+            const XMFLOAT3 extents(length(random), thickness(random), thickness(random));
+            dataset.entries.push_back(makeEntry(i, center, extents));
+        }
+        return dataset;
+    }
+
+    BoundingBox computeSceneBounds(const std::vector<SpatialIndex::Entry>& entries) {
+        BoundingBox sceneBounds = entries.front().bounds;
+        for (const auto& entry : entries) {
+            BoundingBox::CreateMerged(sceneBounds, sceneBounds, entry.bounds);
+        }
+        return sceneBounds;
+    }
+
+    float computeSceneRadius(const BoundingBox& sceneBounds) {
+        return std::max(XMVectorGetX(XMVector3Length(XMLoadFloat3(&sceneBounds.Extents))), 1.0f);
+    }
+
+    std::vector<BoundingFrustum> createCameraPath(const std::vector<SpatialIndex::Entry>& entries) {
+        const BoundingBox sceneBounds = computeSceneBounds(entries);
+        const float radius = computeSceneRadius(sceneBounds);
+        std::vector<BoundingFrustum> frustums;
+        for (const auto& pose : createOrbitCameraPath(sceneBounds, CAMERA_VIEW_COUNT)) {
+            frustums.push_back(createCameraFrustum(pose, XM_PIDIV4, 16.0f / 9.0f, 0.1f, 2.0f * radius));
+        }
+        return frustums;
+    }
+
+    std::array<BoundingBox, 8> splitBounds(const BoundingBox& bounds) {
+        std::array<BoundingBox, 8> childBounds;
+        const XMFLOAT3 childExtents(bounds.Extents.x * 0.5f, bounds.Extents.y * 0.5f, bounds.Extents.z * 0.5f);
+        for (size_t child = 0; child < childBounds.size(); ++child) {
+            const XMFLOAT3 childCenter(
+                bounds.Center.x + ((child & 4) ? childExtents.x : -childExtents.x),
+                bounds.Center.y + ((child & 2) ? childExtents.y : -childExtents.y),
+                bounds.Center.z + ((child & 1) ? childExtents.z : -childExtents.z));
+            childBounds[child] = BoundingBox(childCenter, childExtents);
+        }
+        return childBounds;
+    }
+
+    // The octree as it was before its nodes were flattened into one array: every node owns
+    // its entries and its children through pointers, and queries recurse with the
+    // DirectXCollision tests. Only kept as the baseline of the layout benchmark.
+    class PointerOctree {
+    public:
+        PointerOctree(const std::vector<SpatialIndex::Entry>& entries, size_t maxObjectsPerNode, size_t maxDepth)
+            : mMaxObjectsPerNode(maxObjectsPerNode), mMaxDepth(maxDepth) {
+            if (entries.empty()) {
+                return;
+            }
+
+            BoundingBox bounds = entries.front().bounds;
+            for (const auto& entry : entries) {
+                BoundingBox::CreateMerged(bounds, bounds, entry.bounds);
+            }
+            mRoot = buildNode(bounds, entries, 0);
+        }
+
+        std::vector<size_t> query(const BoundingFrustum& frustum) const {
+            std::vector<size_t> visibleObjects;
+            if (mRoot) {
+                queryNode(*mRoot, frustum, visibleObjects);
+            }
+            return visibleObjects;
+        }
+
+        size_t getMemoryUsage() const {
+            return mRoot ? getMemoryUsage(*mRoot) : 0;
+        }
+
+    private:
+        struct Node {
+            BoundingBox bounds = {};
+            std::vector<SpatialIndex::Entry> entries;
+            std::array<std::unique_ptr<Node>, 8> children;
+        };
+
+        std::unique_ptr<Node> mRoot;
+        size_t mMaxObjectsPerNode = 16;
+        size_t mMaxDepth = 8;
+
+        std::unique_ptr<Node> buildNode(const BoundingBox& bounds, const std::vector<SpatialIndex::Entry>& entries, size_t depth) const {
+            std::unique_ptr<Node> node = std::make_unique<Node>();
+            node->bounds = bounds;
+            if (depth >= mMaxDepth || entries.size() <= mMaxObjectsPerNode) {
+                node->entries = entries;
+                return node;
+            }
+
+            // Entries go to the first child containing them and straddling ones stay here.
+            const std::array<BoundingBox, 8> childBounds = splitBounds(bounds);
+            std::array<std::vector<SpatialIndex::Entry>, 8> childEntries;
+            for (const auto& entry : entries) {
+                const auto child = std::find_if(childBounds.begin(), childBounds.end(),
+                    [&entry](const BoundingBox& box) { return box.Contains(entry.bounds) == CONTAINS; });
+                if (child != childBounds.end()) {
+                    childEntries[child - childBounds.begin()].push_back(entry);
+                }
+                else {
+                    node->entries.push_back(entry);
+                }
+            }
+
+            for (size_t child = 0; child < childBounds.size(); ++child) {
+                if (!childEntries[child].empty()) {
+                    node->children[child] = buildNode(childBounds[child], childEntries[child], depth + 1);
+                }
+            }
+            return node;
+        }
+
+        void queryNode(const Node& node, const BoundingFrustum& frustum, std::vector<size_t>& visibleObjects) const {
+            if (!frustum.Intersects(node.bounds)) {
+                return;
+            }
+
+            for (const auto& entry : node.entries) {
+                if (frustum.Intersects(entry.bounds)) {
+                    visibleObjects.push_back(entry.objectIndex);
+                }
+            }
+            for (const auto& child : node.children) {
+                if (child) {
+                    queryNode(*child, frustum, visibleObjects);
+                }
+            }
+        }
+
+        size_t getMemoryUsage(const Node& node) const {
+            size_t bytes = sizeof(Node) + node.entries.capacity() * sizeof(SpatialIndex::Entry);
+            for (const auto& child : node.children) {
+                if (child) {
+                    bytes += getMemoryUsage(*child);
+                }
+            }
+            return bytes;
+        }
+    };
+
+    // Runs every frustum QUERY_REPEAT_COUNT times and returns the average query time; results
+    // receives the sorted visible objects of every frustum.
+    template <typename Index>
+    double timeQueries(const Index& index, const std::vector<BoundingFrustum>& frustums,
+        std::vector<std::vector<size_t>>& results) {
+        results.assign(frustums.size(), {});
+        const Clock::time_point start = Clock::now();
+        for (size_t repeat = 0; repeat < QUERY_REPEAT_COUNT; ++repeat) {
+            for (size_t view = 0; view < frustums.size(); ++view) {
+                results[view] = index.query(frustums[view]);
+            }
+        }
+        const double queryMicroseconds = elapsedMicroseconds(start) / static_cast<double>(QUERY_REPEAT_COUNT * frustums.size());
+
+        for (auto& result : results) {
+            std::sort(result.begin(), result.end());
+        }
+        return queryMicroseconds;
+    }
+
+    // Counts the objects of expected that actual misses, both sorted per view.
+    size_t countMissing(const std::vector<std::vector<size_t>>& expected, const std::vector<std::vector<size_t>>& actual) {
+        size_t missing = 0;
+        for (size_t view = 0; view < expected.size(); ++view) {
+            std::vector<size_t> difference;
+            std::set_difference(expected[view].begin(), expected[view].end(), actual[view].begin(), actual[view].end(),
+                std::back_inserter(difference));
+            missing += difference.size();
+        }
+        return missing;
+    }
+
+    void benchmarkOctreeLayouts(const Dataset& dataset, std::ostream& out) {
+        const std::vector<BoundingFrustum> frustums = createCameraPath(dataset.entries);
+        const double queryCount = static_cast<double>(frustums.size());
+
+        Clock::time_point start = Clock::now();
+        const PointerOctree pointerOctree(dataset.entries, 16, 8);
+        const double pointerBuildMicroseconds = elapsedMicroseconds(start);
+
+        start = Clock::now();
+        const Octree octree(dataset.entries, 16, 8);
+        const double flatBuildMicroseconds = elapsedMicroseconds(start);
+
+        std::vector<std::vector<size_t>> pointerResults;
+        std::vector<std::vector<size_t>> flatResults;
+        const double pointerQueryMicroseconds = timeQueries(pointerOctree, frustums, pointerResults);
+        const double flatQueryMicroseconds = timeQueries(octree, frustums, flatResults);
+
+        size_t visibleCount = 0;
+        for (const auto& result : pointerResults) {
+            visibleCount += result.size();
+        }
+
+        // The flattened tree must never miss an object the pointer tree finds; extra counts
+        // the objects only the flattened tree accepts.
+        out << dataset.name << " (" << dataset.entries.size() << " entries, " <<
+            static_cast<double>(visibleCount) / queryCount << " visible)\n";
+        out << std::left << std::setw(14) << "layout" << std::right << std::setw(12) << "build ms" <<
+            std::setw(12) << "memory KB" << std::setw(14) << "query us" << std::setw(12) << "missing" <<
+            std::setw(12) << "extra" << "\n";
+        out << std::left << std::setw(14) << "pointer" << std::right << std::fixed << std::setprecision(3) <<
+            std::setw(12) << pointerBuildMicroseconds / 1000.0 << std::setprecision(1) <<
+            std::setw(12) << pointerOctree.getMemoryUsage() / 1024.0 << std::setw(14) << pointerQueryMicroseconds << "\n";
+        out << std::left << std::setw(14) << "flattened" << std::right << std::setprecision(3) <<
+            std::setw(12) << flatBuildMicroseconds / 1000.0 << std::setprecision(1) <<
+            std::setw(12) << octree.getMemoryUsage() / 1024.0 << std::setw(14) << flatQueryMicroseconds <<
+            std::setw(12) << countMissing(pointerResults, flatResults) <<
+            std::setw(12) << countMissing(flatResults, pointerResults) << "\n\n";
+    }
+
+    void benchmarkDataset(const Dataset& dataset, std::ostream& out, ThreadPool* threadPool) {
+        const std::vector<BoundingFrustum> frustums = createCameraPath(dataset.entries);
+
+        out << dataset.name << " (" << dataset.entries.size() << " entries)\n";
+        out << std::left << std::setw(14) << "backend" << std::right << std::setw(12) << "build ms" <<
+            std::setw(12) << "memory KB" << std::setw(14) << "query us" << std::setw(12) << "visible" <<
+            std::setw(12) << "nodes" << std::setw(12) << "tested" << "\n";
+
+        std::vector<std::pair<SpatialIndexType, std::vector<size_t>>> octreeDepths;
+
+        for (SpatialIndexType type : BACKENDS) {
+            std::unique_ptr<SpatialIndex> index = SpatialIndex::create(type, threadPool);
+
+            Clock::time_point start = Clock::now();
+            index->rebuild(dataset.entries);
+            const double buildMicroseconds = elapsedMicroseconds(start);
+
+            size_t visibleCount = 0;
+            size_t nodesVisited = 0;
+            size_t entriesTested = 0;
+            start = Clock::now();
+            for (size_t repeat = 0; repeat < QUERY_REPEAT_COUNT; ++repeat) {
+                for (const auto& frustum : frustums) {
+                    SpatialIndex::QueryStats stats;
+                    visibleCount += index->query(frustum, &stats).size();
+                    nodesVisited += stats.nodesVisited;
+                    entriesTested += stats.entriesTested;
+                }
+            }
+            const double queryCount = static_cast<double>(QUERY_REPEAT_COUNT * frustums.size());
+            const double queryMicroseconds = elapsedMicroseconds(start) / queryCount;
+
+            out << std::left << std::setw(14) << SpatialIndex::getTypeName(type) << std::right << std::fixed <<
+                std::setprecision(3) << std::setw(12) << buildMicroseconds / 1000.0 <<
+                std::setprecision(1) << std::setw(12) << index->getMemoryUsage() / 1024.0 <<
+                std::setw(14) << queryMicroseconds <<
+                std::setw(12) << static_cast<double>(visibleCount) / queryCount <<
+                std::setw(12) << static_cast<double>(nodesVisited) / queryCount <<
+                std::setw(12) << static_cast<double>(entriesTested) / queryCount << "\n";
+
+            if (const auto* octree = dynamic_cast<const Octree*>(index.get())) {
+                octreeDepths.push_back({ type, octree->getEntryCountPerDepth() });
+            }
+        }
+
+        // Straddling entries pile up near the root of the strict tree; the loose tree should
+        // move most of them down to the levels that match their size.
+        out << std::left << std::setw(14) << "entries/depth";
+        size_t maxDepthCount = 0;
+        for (const auto& depths : octreeDepths) {
+            maxDepthCount = std::max(maxDepthCount, depths.second.size());
+        }
+        for (size_t depth = 0; depth < maxDepthCount; ++depth) {
+            out << std::right << std::setw(8) << depth;
+        }
+        out << "\n";
+
+        for (const auto& depths : octreeDepths) {
+            out << std::left << std::setw(14) << SpatialIndex::getTypeName(depths.first) << std::right;
+            for (size_t depth = 0; depth < maxDepthCount; ++depth) {
+                out << std::setw(8) << (depth < depths.second.size() ? depths.second[depth] : 0);
+            }
+            out << "\n";
+        }
+
+        out << "\n";
+    }
+}
+
+std::vector<SpatialIndex::Entry> createSubmeshEntries(const MeshData& mesh) {
+    std::vector<SpatialIndex::Entry> entries;
+    entries.reserve(mesh.submeshes.size());
+
+    for (size_t i = 0; i < mesh.submeshes.size(); ++i) {
+        const Submesh& submesh = mesh.submeshes[i];
+        const size_t vertexEnd = (i + 1 < mesh.submeshes.size())
+            ? mesh.submeshes[i + 1].startVerticeIndex
+            : mesh.vertices.size();
+
+        SpatialIndex::Entry entry;
+        entry.objectIndex = i;
+        BoundingBox::CreateFromPoints(entry.bounds, vertexEnd - submesh.startVerticeIndex,
+            &mesh.vertices[submesh.startVerticeIndex].position, sizeof(Vertex));
+        entries.push_back(entry);
+    }
+
+    return entries;
+}
+
+void runSpatialIndexBenchmark(const std::vector<SpatialIndex::Entry>& sceneEntries, std::ostream& out, ThreadPool* threadPool) {
+    std::vector<Dataset> datasets;
+    if (!sceneEntries.empty()) {
+        datasets.push_back({ "sponza", sceneEntries });
+    }
+    datasets.push_back(createUniformDataset());
+    datasets.push_back(createClusteredDataset());
+    datasets.push_back(createLongThinDataset());
+
+    for (const auto& dataset : datasets) {
+        benchmarkDataset(dataset, out, threadPool);
+    }
+}
+
+void runOctreeLayoutBenchmark(const std::vector<SpatialIndex::Entry>& sceneEntries, std::ostream& out) {
+    out << "octree layout, pointer nodes against the flattened node array\n";
+    if (!sceneEntries.empty()) {
+        benchmarkOctreeLayouts({ "sponza", sceneEntries }, out);
+    }
+    for (size_t entryCount : LAYOUT_ENTRY_COUNTS) {
+        benchmarkOctreeLayouts(createUniformDataset(entryCount), out);
+    }
+}
+
+void runOctreeUpdateBenchmark(std::ostream& out) {
+    const Dataset dataset = createUniformDataset(UPDATE_ENTRY_COUNT);
+    const std::vector<BoundingFrustum> frustums = createCameraPath(dataset.entries);
+
+    out << "moving octree entries (" << dataset.entries.size() << " entries, " << UPDATE_FRAME_COUNT << " frames)\n";
+    out << std::left << std::setw(14) << "moved/frame" << std::right << std::setw(14) << "update ms" <<
+        std::setw(14) << "rebuild ms" << std::setw(12) << "speedup" << std::setw(12) << "rebalances" <<
+        std::setw(12) << "nodes" << std::setw(12) << "identical" << "\n";
+
+    for (size_t movingCount : UPDATE_MOVING_COUNTS) {
+        std::vector<SpatialIndex::Entry> entries = dataset.entries;
+        std::mt19937 random(4);
+        std::uniform_real_distribution<float> speed(-UPDATE_MAX_SPEED, UPDATE_MAX_SPEED);
+        std::vector<XMFLOAT3> velocities(movingCount);
+        for (auto& velocity : velocities) {
+            velocity = XMFLOAT3(speed(random), speed(random), speed(random));
+        }
+
+        // Handle i of the incrementally updated tree is entries[i].
+        Octree updatedOctree;
+        updatedOctree.rebuild(entries);
+        Octree rebuiltOctree;
+        double updateMicroseconds = 0.0;
+        double rebuildMicroseconds = 0.0;
+
+        for (size_t frame = 0; frame < UPDATE_FRAME_COUNT; ++frame) {
+            for (size_t i = 0; i < movingCount; ++i) {
+                XMFLOAT3& center = entries[i].bounds.Center;
+                center.x += velocities[i].x;
+                center.y += velocities[i].y;
+                center.z += velocities[i].z;
+            }
+
+            Clock::time_point start = Clock::now();
+            for (size_t i = 0; i < movingCount; ++i) {
+                updatedOctree.update(static_cast<SpatialIndex::Handle>(i), entries[i].bounds);
+            }
+            updateMicroseconds += elapsedMicroseconds(start);
+
+            start = Clock::now();
+            rebuiltOctree.rebuild(entries);
+            rebuildMicroseconds += elapsedMicroseconds(start);
+        }
+
+        std::vector<std::vector<size_t>> updatedResults;
+        std::vector<std::vector<size_t>> rebuiltResults;
+        timeQueries(updatedOctree, frustums, updatedResults);
+        timeQueries(rebuiltOctree, frustums, rebuiltResults);
+
+        const double frameCount = static_cast<double>(UPDATE_FRAME_COUNT);
+        out << std::left << std::setw(14) << movingCount << std::right << std::fixed << std::setprecision(3) <<
+            std::setw(14) << updateMicroseconds / frameCount / 1000.0 <<
+            std::setw(14) << rebuildMicroseconds / frameCount / 1000.0 << std::setprecision(2) <<
+            std::setw(12) << rebuildMicroseconds / std::max(updateMicroseconds, 1.0) <<
+            std::setw(12) << updatedOctree.getRebalanceCount() << std::setw(12) << updatedOctree.getNodeCount() <<
+            std::setw(12) << (updatedResults == rebuiltResults ? "yes" : "no") << "\n";
+    }
+
+    out << "\n";
+}
+
+void runOctreeBuildBenchmark(std::ostream& out, ThreadPool* threadPool) {
+    struct BuildConfiguration {
+        std::string name;
+        Octree::BuildMethod method;
+        ThreadPool* threadPool;
+    };
+
+    std::vector<BuildConfiguration> configurations = {
+        { "top-down", Octree::BuildMethod::TopDown, nullptr },
+        { "morton", Octree::BuildMethod::Morton, nullptr } };
+    if (threadPool) {
+        configurations.push_back({ "morton x" + std::to_string(threadPool->getThreadCount()), Octree::BuildMethod::Morton, threadPool });
+    }
+
+    for (size_t entryCount : BUILD_ENTRY_COUNTS) {
+        const Dataset dataset = createUniformDataset(entryCount);
+        const std::vector<BoundingFrustum> frustums = createCameraPath(dataset.entries);
+
+        out << "octree build (" << dataset.entries.size() << " entries)\n";
+        out << std::left << std::setw(14) << "method" << std::right << std::setw(12) << "build ms" <<
+            std::setw(12) << "nodes" << std::setw(12) << "memory KB" << std::setw(14) << "query us" << "\n";
+
+        for (const auto& configuration : configurations) {
+            Octree::BuildSettings settings;
+            settings.method = configuration.method;
+            settings.threadPool = configuration.threadPool;
+            Octree octree;
+
+            const Clock::time_point start = Clock::now();
+            for (size_t repeat = 0; repeat < BUILD_REPEAT_COUNT; ++repeat) {
+                octree.rebuild(dataset.entries, settings);
+            }
+            const double buildMicroseconds = elapsedMicroseconds(start) / static_cast<double>(BUILD_REPEAT_COUNT);
+
+            std::vector<std::vector<size_t>> results;
+            const double queryMicroseconds = timeQueries(octree, frustums, results);
+
+            out << std::left << std::setw(14) << configuration.name << std::right << std::fixed <<
+                std::setprecision(3) << std::setw(12) << buildMicroseconds / 1000.0 <<
+                std::setw(12) << octree.getNodeCount() << std::setprecision(1) <<
+                std::setw(12) << octree.getMemoryUsage() / 1024.0 << std::setw(14) << queryMicroseconds << "\n";
+        }
+        out << "\n";
+    }
+}
+
+void runMultiViewQueryBenchmark(std::ostream& out) {
+    const Dataset dataset = createUniformDataset(CASCADE_ENTRY_COUNT);
+    const BoundingBox sceneBounds = computeSceneBounds(dataset.entries);
+    const float nearZ = 0.1f;
+    const float farZ = 2.0f * computeSceneRadius(sceneBounds);
+
+    // Consecutive depth slices of one camera, like the cascades of a shadow map.
+    std::vector<std::vector<BoundingFrustum>> cascadeSets;
+    for (const auto& pose : createOrbitCameraPath(sceneBounds, CASCADE_POSE_COUNT)) {
+        std::vector<BoundingFrustum> cascades;
+        float cascadeNear = nearZ;
+        for (size_t cascade = 1; cascade <= CASCADE_COUNT; ++cascade) {
+            const float fraction = static_cast<float>(cascade) / static_cast<float>(CASCADE_COUNT);
+            const float logarithmicSplit = nearZ * std::pow(farZ / nearZ, fraction);
+            const float uniformSplit = nearZ + (farZ - nearZ) * fraction;
+            const float cascadeFar = CASCADE_SPLIT_LAMBDA * logarithmicSplit + (1.0f - CASCADE_SPLIT_LAMBDA) * uniformSplit;
+            cascades.push_back(createCameraFrustum(pose, XM_PIDIV4, 16.0f / 9.0f, cascadeNear, cascadeFar));
+            cascadeNear = cascadeFar;
+        }
+        cascadeSets.push_back(cascades);
+    }
+
+    Octree octree;
+    octree.rebuild(dataset.entries);
+
+    SpatialIndex::QueryStats separateStats;
+    std::vector<std::vector<uint32_t>> expectedMasks(cascadeSets.size(), std::vector<uint32_t>(dataset.entries.size(), 0));
+    std::vector<size_t> visibleObjects;
+    Clock::time_point start = Clock::now();
+    for (size_t repeat = 0; repeat < QUERY_REPEAT_COUNT; ++repeat) {
+        for (size_t set = 0; set < cascadeSets.size(); ++set) {
+            for (size_t view = 0; view < CASCADE_COUNT; ++view) {
+                SpatialIndex::QueryStats stats;
+                visibleObjects = octree.query(cascadeSets[set][view], &stats);
+                separateStats.nodesVisited += stats.nodesVisited;
+                separateStats.planeTests += stats.planeTests;
+                if (repeat == 0) {
+                    for (size_t objectIndex : visibleObjects) {
+                        expectedMasks[set][objectIndex] |= 1u << view;
+                    }
+                }
+            }
+        }
+    }
+    const double separateMicroseconds = elapsedMicroseconds(start);
+
+    SpatialIndex::QueryStats multiViewStats;
+    std::vector<std::vector<SpatialIndex::ViewVisibility>> multiViewResults(cascadeSets.size());
+    start = Clock::now();
+    for (size_t repeat = 0; repeat < QUERY_REPEAT_COUNT; ++repeat) {
+        for (size_t set = 0; set < cascadeSets.size(); ++set) {
+            SpatialIndex::QueryStats stats;
+            multiViewResults[set] = octree.queryViews(cascadeSets[set], &stats);
+            multiViewStats.nodesVisited += stats.nodesVisited;
+            multiViewStats.planeTests += stats.planeTests;
+        }
+    }
+    const double multiViewMicroseconds = elapsedMicroseconds(start);
+
+    // Every object must come back once, with exactly the views the separate queries found it in.
+    size_t mismatchedObjects = 0;
+    for (size_t set = 0; set < cascadeSets.size(); ++set) {
+        std::vector<uint32_t> masks(dataset.entries.size(), 0);
+        for (const auto& visibility : multiViewResults[set]) {
+            if (masks[visibility.objectIndex] != 0) {
+                ++mismatchedObjects;
+            }
+            masks[visibility.objectIndex] |= visibility.viewMask;
+        }
+        for (size_t objectIndex = 0; objectIndex < masks.size(); ++objectIndex) {
+            if (masks[objectIndex] != expectedMasks[set][objectIndex]) {
+                ++mismatchedObjects;
+            }
+        }
+    }
+
+    const double setCount = static_cast<double>(QUERY_REPEAT_COUNT * cascadeSets.size());
+    out << "multi-view octree query (" << dataset.entries.size() << " entries, " << CASCADE_COUNT << " cascades, " <<
+        cascadeSets.size() << " poses)\n";
+    out << std::left << std::setw(14) << "traversal" << std::right << std::setw(14) << "us/pose" <<
+        std::setw(12) << "nodes" << std::setw(14) << "plane tests" << std::setw(12) << "mismatches" << "\n";
+    out << std::left << std::setw(14) << "separate" << std::right << std::fixed << std::setprecision(1) <<
+        std::setw(14) << separateMicroseconds / setCount <<
+        std::setw(12) << static_cast<double>(separateStats.nodesVisited) / setCount <<
+        std::setw(14) << static_cast<double>(separateStats.planeTests) / setCount << "\n";
+    out << std::left << std::setw(14) << "queryViews" << std::right <<
+        std::setw(14) << multiViewMicroseconds / setCount <<
+        std::setw(12) << static_cast<double>(multiViewStats.nodesVisited) / setCount <<
+        std::setw(14) << static_cast<double>(multiViewStats.planeTests) / setCount <<
+        std::setw(12) << mismatchedObjects << "\n\n";
+}
+
+void runParallelQueryBenchmark(std::ostream& out, size_t maxThreadCount) {
+    const Dataset dataset = createUniformDataset(PARALLEL_QUERY_ENTRY_COUNT);
+    const std::vector<BoundingFrustum> frustums = createCameraPath(dataset.entries);
+    maxThreadCount = std::max<size_t>(maxThreadCount, 1);
+
+    Octree::BuildSettings settings;
+    settings.maxObjectsPerNode = 24;
+    settings.maxDepth = 8;
+    settings.method = Octree::BuildMethod::Morton;
+    ThreadPool buildPool(maxThreadCount);
+    settings.threadPool = &buildPool;
+    const Octree octree(dataset.entries, settings);
+
+    std::vector<std::vector<size_t>> expected(frustums.size());
+    Clock::time_point start = Clock::now();
+    for (size_t repeat = 0; repeat < QUERY_REPEAT_COUNT; ++repeat) {
+        for (size_t view = 0; view < frustums.size(); ++view) {
+            expected[view].clear();
+            octree.query(frustums[view], expected[view]);
+        }
+    }
+    const double queryCount = static_cast<double>(QUERY_REPEAT_COUNT * frustums.size());
+    const double sequentialMicroseconds = elapsedMicroseconds(start) / queryCount;
+
+    out << "parallel octree query (" << dataset.entries.size() << " entries, split depth " <<
+        Octree::DEFAULT_PARALLEL_SPLIT_DEPTH << ")\n";
+    out << std::left << std::setw(14) << "threads" << std::right << std::setw(14) << "query us" <<
+        std::setw(12) << "speedup" << std::setw(12) << "lists" << std::setw(12) << "identical" << "\n";
+    out << std::left << std::setw(14) << "sequential" << std::right << std::fixed << std::setprecision(1) <<
+        std::setw(14) << sequentialMicroseconds << std::setprecision(2) << std::setw(12) << 1.0 << "\n";
+
+    std::vector<std::vector<size_t>> visibleObjectLists;
+    std::vector<size_t> merged;
+    for (size_t threadCount = 1; threadCount <= maxThreadCount; ++threadCount) {
+        ThreadPool pool(threadCount);
+        bool identical = true;
+        size_t listCount = 0;
+
+        start = Clock::now();
+        for (size_t repeat = 0; repeat < QUERY_REPEAT_COUNT; ++repeat) {
+            for (size_t view = 0; view < frustums.size(); ++view) {
+                octree.queryParallel(frustums[view], &pool, visibleObjectLists);
+                listCount += visibleObjectLists.size();
+
+                if (repeat == 0) {
+                    merged.clear();
+                    for (const auto& list : visibleObjectLists) {
+                        merged.insert(merged.end(), list.begin(), list.end());
+                    }
+                    identical = identical && merged == expected[view];
+                }
+            }
+        }
+        const double parallelMicroseconds = elapsedMicroseconds(start) / queryCount;
+
+        out << std::left << std::setw(14) << threadCount << std::right << std::setprecision(1) <<
+            std::setw(14) << parallelMicroseconds << std::setprecision(2) <<
+            std::setw(12) << sequentialMicroseconds / parallelMicroseconds << std::setprecision(1) <<
+            std::setw(12) << static_cast<double>(listCount) / queryCount <<
+            std::setw(12) << (identical ? "yes" : "no") << "\n";
+    }
+
+    out << "\n";
+}
\ No newline at end of file
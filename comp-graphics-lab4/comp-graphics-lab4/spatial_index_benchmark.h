@@ -0,0 +1,48 @@
+#ifndef SPATIAL_INDEX_BENCHMARK_H
+#define SPATIAL_INDEX_BENCHMARK_H
+
+#include "spatial_index.h"
+
+#include <ostream>
+#include <vector>
+
+struct MeshData;
+class ThreadPool;
+
+// One entry per submesh, bounded by the submesh vertices.
+std::vector<SpatialIndex::Entry> createSubmeshEntries(const MeshData& mesh);
+
+// Builds every spatial index backend over the scene entries and over synthetic uniform,
+// clustered and long-thin distributions, then replays an orbiting camera path and reports
+// build time, memory usage and average query time per backend, plus how the strict and loose
+// octrees distribute entries over their levels.
+void runSpatialIndexBenchmark(const std::vector<SpatialIndex::Entry>& sceneEntries, std::ostream& out,
+    ThreadPool* threadPool = nullptr);
+
+// Compares the flattened Octree with a copy of the pointer-based octree it replaced, both
+// built with 16 entries per node and depth 8, on the scene entries and on uniform datasets
+// of 10k to 1M entries. Reports build time, memory, query time and any difference in results.
+void runOctreeLayoutBenchmark(const std::vector<SpatialIndex::Entry>& sceneEntries, std::ostream& out);
+
+// Moves a few thousand of 100k uniform entries per frame along random velocities and times
+// Octree::update for the moved entries against rebuilding the tree every frame. Reports how
+// often the updates triggered a rebalance and whether both trees end up with the same results.
+void runOctreeUpdateBenchmark(std::ostream& out);
+
+// Times the top-down and the Morton octree builds, the latter with and without the thread
+// pool, on uniform datasets of 100k and 1M entries, along with the node count and the query
+// time of the resulting trees.
+void runOctreeBuildBenchmark(std::ostream& out, ThreadPool* threadPool = nullptr);
+
+// Splits the view of each pose of an orbit path into six consecutive cascade frusta and
+// times Octree::queryViews against six separate queries over 100k uniform entries. Reports
+// nodes visited and plane tests of both, and counts objects whose view mask differs from the
+// views the separate queries returned them for.
+void runMultiViewQueryBenchmark(std::ostream& out);
+
+// Times Octree::queryParallel on a synthetic scene of a million entries with pools of 1 to
+// maxThreadCount threads against the single-threaded query, and checks that the merged
+// results match it exactly.
+void runParallelQueryBenchmark(std::ostream& out, size_t maxThreadCount);
+
+#endif // SPATIAL_INDEX_BENCHMARK_H
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "occlusion_culler.h"
+#include "thread_pool.h"
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+#include <cstdio>
+
+using namespace DirectX;
+
+namespace {
+    constexpr float WALL_DISTANCE = 10.0f;
+    constexpr float WALL_HALF_SIZE = 2.0f;
+
+    // A square wall facing the camera, split into two triangles.
+    OcclusionCuller::Occluder createWall() {
+        OcclusionCuller::Occluder wall;
+        wall.positions = {
+            XMFLOAT3(-WALL_HALF_SIZE, -WALL_HALF_SIZE, WALL_DISTANCE),
+            XMFLOAT3(WALL_HALF_SIZE, -WALL_HALF_SIZE, WALL_DISTANCE),
+            XMFLOAT3(WALL_HALF_SIZE, WALL_HALF_SIZE, WALL_DISTANCE),
+            XMFLOAT3(-WALL_HALF_SIZE, WALL_HALF_SIZE, WALL_DISTANCE) };
+        wall.indices = { 0, 1, 2, 0, 2, 3 };
+        return wall;
+    }
+
+    // The camera sits at the origin and looks down +z.
+    XMFLOAT4X4 createViewProj() {
+        const XMMATRIX view = XMMatrixLookAtLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        const XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV4, 2.0f, 0.1f, 100.0f);
+        XMFLOAT4X4 viewProj;
+        XMStoreFloat4x4(&viewProj, view * proj);
+        return viewProj;
+    }
+
+    bool expect(bool condition, const char* description) {
+        if (!condition) {
+            std::fprintf(stderr, "FAILED: %s\n", description);
+        }
+        return condition;
+    }
+
+    bool runChecks(ThreadPool* threadPool) {
+        OcclusionCuller culler;
+        culler.addOccluder(createWall());
+        culler.render(createViewProj(), threadPool);
+
+        bool passed = expect(culler.getRasterizedTriangleCount() == 2, "both wall triangles are rasterized");
+        passed &= expect(!culler.isVisible(BoundingBox(XMFLOAT3(0.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))),
+            "a box behind the wall is occluded");
+        passed &= expect(culler.isVisible(BoundingBox(XMFLOAT3(0.0f, 0.0f, 5.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))),
+            "a box in front of the wall is visible");
+        passed &= expect(culler.isVisible(BoundingBox(XMFLOAT3(4.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))),
+            "a box partly behind the wall is visible");
+        passed &= expect(culler.isVisible(BoundingBox(XMFLOAT3(10.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))),
+            "a box beside the wall is visible");
+        passed &= expect(culler.isVisible(BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))),
+            "a box around the camera is visible");
+
+        culler.clearOccluders();
+        culler.render(createViewProj(), threadPool);
+        passed &= expect(culler.isVisible(BoundingBox(XMFLOAT3(0.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))),
+            "nothing is occluded once the occluders are cleared");
+        return passed;
+    }
+}
+
+int main() {
+    ThreadPool threadPool(4);
+    const bool passed = runChecks(nullptr) && runChecks(&threadPool);
+    std::printf(passed ? "occlusion culler test passed\n" : "occlusion culler test failed\n");
+    return passed ? 0 : 1;
+}
\ No newline at end of file
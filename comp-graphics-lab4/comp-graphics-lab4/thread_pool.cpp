@@ -0,0 +1,106 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    const size_t workerCount = threadCount > 1 ? threadCount - 1 : 0;
+    mWorkers.reserve(workerCount);
+
+    for (size_t i = 0; i < workerCount; ++i) {
+        mWorkers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWakeCondition.notify_all();
+
+    for (auto& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t chunkSize, const Task& task) {
+    if (count == 0) {
+        return;
+    }
+
+    chunkSize = std::max<size_t>(chunkSize, 1);
+    const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+    if (mWorkers.empty() || chunkCount == 1) {
+        for (size_t begin = 0; begin < count; begin += chunkSize) {
+            task(begin, std::min(begin + chunkSize, count));
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTask = &task;
+        mTaskCount = count;
+        mChunkSize = chunkSize;
+        mChunkCount = chunkCount;
+        mNextChunk = 0;
+        mActiveWorkers = mWorkers.size();
+        ++mGeneration;
+    }
+    mWakeCondition.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCondition.wait(lock, [this] { return mActiveWorkers == 0; });
+    mTask = nullptr;
+}
+
+void ThreadPool::run(ThreadPool* pool, size_t count, size_t chunkSize, const Task& task) {
+    if (pool) {
+        pool->parallelFor(count, chunkSize, task);
+        return;
+    }
+
+    chunkSize = std::max<size_t>(chunkSize, 1);
+    for (size_t begin = 0; begin < count; begin += chunkSize) {
+        task(begin, std::min(begin + chunkSize, count));
+    }
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t seenGeneration = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWakeCondition.wait(lock, [this, seenGeneration] { return mStopping || mGeneration != seenGeneration; });
+            if (mStopping) {
+                return;
+            }
+            seenGeneration = mGeneration;
+        }
+
+        runChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (--mActiveWorkers == 0) {
+                mDoneCondition.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::runChunks() {
+    for (;;) {
+        const size_t chunk = mNextChunk.fetch_add(1);
+        if (chunk >= mChunkCount) {
+            return;
+        }
+
+        const size_t begin = chunk * mChunkSize;
+        (*mTask)(begin, std::min(begin + mChunkSize, mTaskCount));
+    }
+}
\ No newline at end of file
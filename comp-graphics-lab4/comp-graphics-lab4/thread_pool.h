@@ -0,0 +1,52 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    using Task = std::function<void(size_t begin, size_t end)>;
+
+    explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool& rhs) = delete;
+    ThreadPool& operator=(const ThreadPool& rhs) = delete;
+
+    // Number of threads that execute work, including the calling thread.
+    size_t getThreadCount() const { return mWorkers.size() + 1; }
+
+    // Splits [0, count) into chunks of chunkSize and runs them on the workers and the
+    // calling thread, returning once every chunk is done. Chunk boundaries depend only on
+    // count and chunkSize, so begin / chunkSize identifies a chunk deterministically.
+    // Not reentrant: a task must not call parallelFor on the same pool.
+    void parallelFor(size_t count, size_t chunkSize, const Task& task);
+
+    static void run(ThreadPool* pool, size_t count, size_t chunkSize, const Task& task);
+
+private:
+    void workerLoop();
+    void runChunks();
+
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mWakeCondition;
+    std::condition_variable mDoneCondition;
+
+    const Task* mTask = nullptr;
+    size_t mTaskCount = 0;
+    size_t mChunkSize = 1;
+    size_t mChunkCount = 0;
+    std::atomic<size_t> mNextChunk = 0;
+    size_t mActiveWorkers = 0;
+    uint64_t mGeneration = 0;
+    bool mStopping = false;
+};
+
+#endif // THREAD_POOL_H
\ No newline at end of file
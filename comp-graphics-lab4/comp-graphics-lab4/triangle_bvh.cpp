@@ -0,0 +1,528 @@
+#include "triangle_bvh.h"
+#include "mesh_data.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace {
+    constexpr uint32_t PACKET_WIDTH = TriangleBvh::PACKET_WIDTH;
+    constexpr uint32_t FULL_PACKET_MASK = (1u << PACKET_WIDTH) - 1;
+    // Cost of visiting a node relative to testing one triangle batch.
+    constexpr float TRAVERSAL_COST = 1.0f;
+    // Zero direction components are replaced so the slab test never multiplies 0 by infinity.
+    constexpr float MIN_DIRECTION_COMPONENT = 1e-20f;
+    constexpr size_t PACKETS_PER_CHUNK = 64;
+    // Widens the slab exit distance by the worst rounding error of the box test (Ize 2013),
+    // so a ray through a vertex shared by two leaves is not rejected by both.
+    constexpr float SLAB_EXIT_SCALE = 1.0f + 2.0f * 3.0f * FLT_EPSILON;
+
+#if defined(_XM_AVX_INTRINSICS_)
+    using Lanes = __m256;
+
+    Lanes loadLanes(const float* values) { return _mm256_loadu_ps(values); }
+    Lanes splatLanes(float value) { return _mm256_set1_ps(value); }
+    void storeLanes(float* values, Lanes lanes) { _mm256_storeu_ps(values, lanes); }
+    Lanes addLanes(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+    Lanes subtractLanes(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+    Lanes multiplyLanes(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+    Lanes minLanes(Lanes a, Lanes b) { return _mm256_min_ps(a, b); }
+    Lanes maxLanes(Lanes a, Lanes b) { return _mm256_max_ps(a, b); }
+    Lanes lessOrEqualLanes(Lanes a, Lanes b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    Lanes greaterOrEqualLanes(Lanes a, Lanes b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    Lanes notEqualLanes(Lanes a, Lanes b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_OQ); }
+    Lanes andLanes(Lanes a, Lanes b) { return _mm256_and_ps(a, b); }
+    Lanes orLanes(Lanes a, Lanes b) { return _mm256_or_ps(a, b); }
+    Lanes xorLanes(Lanes a, Lanes b) { return _mm256_xor_ps(a, b); }
+    uint32_t laneMask(Lanes lanes) { return static_cast<uint32_t>(_mm256_movemask_ps(lanes)); }
+#else
+    using Lanes = XMVECTOR;
+
+    Lanes loadLanes(const float* values) { return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(values)); }
+    Lanes splatLanes(float value) { return XMVectorReplicate(value); }
+    void storeLanes(float* values, Lanes lanes) { XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(values), lanes); }
+    Lanes addLanes(Lanes a, Lanes b) { return XMVectorAdd(a, b); }
+    Lanes subtractLanes(Lanes a, Lanes b) { return XMVectorSubtract(a, b); }
+    Lanes multiplyLanes(Lanes a, Lanes b) { return XMVectorMultiply(a, b); }
+    Lanes minLanes(Lanes a, Lanes b) { return XMVectorMin(a, b); }
+    Lanes maxLanes(Lanes a, Lanes b) { return XMVectorMax(a, b); }
+    Lanes lessOrEqualLanes(Lanes a, Lanes b) { return XMVectorLessOrEqual(a, b); }
+    Lanes greaterOrEqualLanes(Lanes a, Lanes b) { return XMVectorGreaterOrEqual(a, b); }
+    Lanes notEqualLanes(Lanes a, Lanes b) { return XMVectorNotEqual(a, b); }
+    Lanes andLanes(Lanes a, Lanes b) { return XMVectorAndInt(a, b); }
+    Lanes orLanes(Lanes a, Lanes b) { return XMVectorOrInt(a, b); }
+    Lanes xorLanes(Lanes a, Lanes b) { return XMVectorXorInt(a, b); }
+    uint32_t laneMask(Lanes lanes) {
+        uint32_t bits[4];
+        XMStoreInt4(bits, lanes);
+        return (bits[0] & 1u) | ((bits[1] & 1u) << 1) | ((bits[2] & 1u) << 2) | ((bits[3] & 1u) << 3);
+    }
+#endif
+
+    uint32_t lowestLane(uint32_t mask) {
+        uint32_t lane = 0;
+        while ((mask & (1u << lane)) == 0) {
+            ++lane;
+        }
+        return lane;
+    }
+
+    struct Aabb {
+        XMFLOAT3 min = { FLT_MAX, FLT_MAX, FLT_MAX };
+        XMFLOAT3 max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+        void grow(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax) {
+            min = { std::min(min.x, boxMin.x), std::min(min.y, boxMin.y), std::min(min.z, boxMin.z) };
+            max = { std::max(max.x, boxMax.x), std::max(max.y, boxMax.y), std::max(max.z, boxMax.z) };
+        }
+
+        void grow(const XMFLOAT3& point) {
+            grow(point, point);
+        }
+
+        void grow(const Aabb& other) {
+            grow(other.min, other.max);
+        }
+
+        float surfaceArea() const {
+            if (min.x > max.x) {
+                return 0.0f;
+            }
+            const float dx = max.x - min.x;
+            const float dy = max.y - min.y;
+            const float dz = max.z - min.z;
+            return 2.0f * (dx * dy + dy * dz + dz * dx);
+        }
+    };
+
+    float component(const XMFLOAT3& value, int axis) {
+        return axis == 0 ? value.x : (axis == 1 ? value.y : value.z);
+    }
+
+    size_t getBin(float value, float axisMin, float binScale, size_t binCount) {
+        const int bin = static_cast<int>((value - axisMin) * binScale);
+        return std::min(binCount - 1, static_cast<size_t>(bin));
+    }
+
+    float getBatchCount(size_t triangleCount) {
+        return static_cast<float>((triangleCount + PACKET_WIDTH - 1) / PACKET_WIDTH);
+    }
+
+    // Per-ray state in SoA form. The watertight test moves each ray to a space where it
+    // runs along +z: the axes are permuted so z is the dominant direction axis, and the
+    // shear maps the direction onto the z axis.
+    struct RayPacket {
+        alignas(32) float origin[3][PACKET_WIDTH];
+        alignas(32) float inverseDirection[3][PACKET_WIDTH];
+        alignas(32) float maxDistance[PACKET_WIDTH];
+        uint32_t axisX[PACKET_WIDTH];
+        uint32_t axisY[PACKET_WIDTH];
+        uint32_t axisZ[PACKET_WIDTH];
+        float shearX[PACKET_WIDTH];
+        float shearY[PACKET_WIDTH];
+        float shearZ[PACKET_WIDTH];
+        uint32_t activeMask = 0;
+        bool negativeDirection[3] = {};
+    };
+
+    void setupPacket(const Ray* rays, size_t count, RayPacket& packet) {
+        for (uint32_t lane = 0; lane < PACKET_WIDTH; ++lane) {
+            const Ray& ray = rays[std::min<size_t>(lane, count - 1)];
+            const float direction[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+            packet.origin[0][lane] = ray.origin.x;
+            packet.origin[1][lane] = ray.origin.y;
+            packet.origin[2][lane] = ray.origin.z;
+            packet.maxDistance[lane] = lane < count ? ray.maxDistance : -1.0f;
+
+            uint32_t axisZ = 0;
+            for (uint32_t axis = 0; axis < 3; ++axis) {
+                const float value = std::fabs(direction[axis]) < MIN_DIRECTION_COMPONENT ?
+                    std::copysign(MIN_DIRECTION_COMPONENT, direction[axis]) : direction[axis];
+                packet.inverseDirection[axis][lane] = 1.0f / value;
+                if (std::fabs(direction[axis]) > std::fabs(direction[axisZ])) {
+                    axisZ = axis;
+                }
+            }
+
+            // Swapping x and y keeps the winding of the triangles when z points backwards.
+            uint32_t axisX = (axisZ + 1) % 3;
+            uint32_t axisY = (axisX + 1) % 3;
+            if (direction[axisZ] < 0.0f) {
+                std::swap(axisX, axisY);
+            }
+
+            packet.axisX[lane] = axisX;
+            packet.axisY[lane] = axisY;
+            packet.axisZ[lane] = axisZ;
+            packet.shearX[lane] = direction[axisX] / direction[axisZ];
+            packet.shearY[lane] = direction[axisY] / direction[axisZ];
+            packet.shearZ[lane] = 1.0f / direction[axisZ];
+        }
+
+        packet.activeMask = (1u << count) - 1;
+        packet.negativeDirection[0] = rays[0].direction.x < 0.0f;
+        packet.negativeDirection[1] = rays[0].direction.y < 0.0f;
+        packet.negativeDirection[2] = rays[0].direction.z < 0.0f;
+    }
+
+    // Returns the lanes whose ray enters the box before its current nearest hit.
+    uint32_t intersectBox(const RayPacket& packet, const float* boxMin, const float* boxMax) {
+        Lanes nearDistance = splatLanes(0.0f);
+        Lanes farDistance = loadLanes(packet.maxDistance);
+        const Lanes exitScale = splatLanes(SLAB_EXIT_SCALE);
+        for (size_t axis = 0; axis < 3; ++axis) {
+            const Lanes origin = loadLanes(packet.origin[axis]);
+            const Lanes inverseDirection = loadLanes(packet.inverseDirection[axis]);
+            const Lanes t0 = multiplyLanes(subtractLanes(splatLanes(boxMin[axis]), origin), inverseDirection);
+            const Lanes t1 = multiplyLanes(subtractLanes(splatLanes(boxMax[axis]), origin), inverseDirection);
+            nearDistance = maxLanes(nearDistance, minLanes(t0, t1));
+            farDistance = minLanes(farDistance, multiplyLanes(maxLanes(t0, t1), exitScale));
+        }
+
+        return laneMask(lessOrEqualLanes(nearDistance, farDistance)) & packet.activeMask;
+    }
+}
+
+TriangleBvh::TriangleBvh(const BuildSettings& settings) : mSettings(settings) {
+    mSettings.binCount = std::clamp<size_t>(settings.binCount, 2, MAX_BIN_COUNT);
+}
+
+void TriangleBvh::build(const MeshData& mesh) {
+    mNodes.clear();
+    mBatches.clear();
+    mTriangleCount = 0;
+
+    std::vector<BuildTriangle> triangles;
+    triangles.reserve(mesh.indices.size() / 3);
+    for (size_t submeshIndex = 0; submeshIndex < mesh.submeshes.size(); ++submeshIndex) {
+        const Submesh& submesh = mesh.submeshes[submeshIndex];
+        for (UINT i = 0; i + 2 < submesh.indexCount; i += 3) {
+            BuildTriangle triangle;
+            triangle.submeshIndex = static_cast<uint32_t>(submeshIndex);
+            triangle.triangleIndex = i / 3;
+            triangle.firstIndex = submesh.startIndiceIndex + i;
+
+            Aabb bounds;
+            for (size_t k = 0; k < 3; ++k) {
+                bounds.grow(mesh.vertices[mesh.indices[triangle.firstIndex + k]].position);
+            }
+            triangle.min = bounds.min;
+            triangle.max = bounds.max;
+            triangle.centroid = XMFLOAT3(0.5f * (bounds.min.x + bounds.max.x), 0.5f * (bounds.min.y + bounds.max.y),
+                0.5f * (bounds.min.z + bounds.max.z));
+            triangles.push_back(triangle);
+        }
+    }
+
+    if (triangles.empty()) {
+        return;
+    }
+
+    mTriangleCount = triangles.size();
+    mNodes.reserve(2 * (mTriangleCount / PACKET_WIDTH) + 1);
+    mBatches.reserve(mTriangleCount / PACKET_WIDTH + 1);
+    buildNode(mesh, triangles, 0, triangles.size(), 0);
+}
+
+// Same binned SAH split as Bvh::buildNode, except that leaves are priced by the number of
+// batches they need, so splits that leave batches half empty are not favoured.
+uint32_t TriangleBvh::buildNode(const MeshData& mesh, std::vector<BuildTriangle>& triangles, size_t begin, size_t end,
+    size_t depth) {
+    const uint32_t nodeIndex = static_cast<uint32_t>(mNodes.size());
+    mNodes.emplace_back();
+
+    Aabb bounds;
+    Aabb centroidBounds;
+    for (size_t i = begin; i < end; ++i) {
+        bounds.grow(triangles[i].min, triangles[i].max);
+        centroidBounds.grow(triangles[i].centroid);
+    }
+
+    Node& node = mNodes[nodeIndex];
+    node.min[0] = bounds.min.x;
+    node.min[1] = bounds.min.y;
+    node.min[2] = bounds.min.z;
+    node.max[0] = bounds.max.x;
+    node.max[1] = bounds.max.y;
+    node.max[2] = bounds.max.z;
+    const size_t count = end - begin;
+
+    auto makeLeaf = [&]() {
+        Node& leaf = mNodes[nodeIndex];
+        leaf.offset = static_cast<uint32_t>(mBatches.size());
+        leaf.batchCount = static_cast<uint16_t>(getBatchCount(count));
+        appendBatches(mesh, triangles.data() + begin, count);
+        return nodeIndex;
+    };
+
+    if (count <= PACKET_WIDTH || depth >= MAX_DEPTH) {
+        return makeLeaf();
+    }
+
+    const size_t binCount = mSettings.binCount;
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    size_t bestSplit = 0;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        const float axisMin = component(centroidBounds.min, axis);
+        const float axisExtent = component(centroidBounds.max, axis) - axisMin;
+        if (!(axisExtent > 0.0f)) {
+            continue;
+        }
+
+        std::array<Aabb, MAX_BIN_COUNT> binBounds;
+        std::array<size_t, MAX_BIN_COUNT> binCounts = {};
+        const float binScale = static_cast<float>(binCount) / axisExtent;
+
+        for (size_t i = begin; i < end; ++i) {
+            const size_t bin = getBin(component(triangles[i].centroid, axis), axisMin, binScale, binCount);
+            binBounds[bin].grow(triangles[i].min, triangles[i].max);
+            ++binCounts[bin];
+        }
+
+        std::array<float, MAX_BIN_COUNT> rightCosts = {};
+        std::array<size_t, MAX_BIN_COUNT> rightCounts = {};
+        Aabb right;
+        size_t rightCount = 0;
+        for (size_t bin = binCount - 1; bin > 0; --bin) {
+            right.grow(binBounds[bin]);
+            rightCount += binCounts[bin];
+            rightCosts[bin] = right.surfaceArea() * getBatchCount(rightCount);
+            rightCounts[bin] = rightCount;
+        }
+
+        Aabb left;
+        size_t leftCount = 0;
+        for (size_t split = 1; split < binCount; ++split) {
+            left.grow(binBounds[split - 1]);
+            leftCount += binCounts[split - 1];
+            if (leftCount == 0 || rightCounts[split] == 0) {
+                continue;
+            }
+
+            const float cost = left.surfaceArea() * getBatchCount(leftCount) + rightCosts[split];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    size_t middle = begin + count / 2;
+    if (bestAxis >= 0) {
+        const float leafCost = bounds.surfaceArea() * getBatchCount(count);
+        const float splitCost = TRAVERSAL_COST * bounds.surfaceArea() + bestCost;
+        if (splitCost >= leafCost && count <= 2 * PACKET_WIDTH) {
+            return makeLeaf();
+        }
+
+        const float axisMin = component(centroidBounds.min, bestAxis);
+        const float binScale = static_cast<float>(binCount) / (component(centroidBounds.max, bestAxis) - axisMin);
+        const auto partitionEnd = std::partition(triangles.begin() + begin, triangles.begin() + end, [&](const BuildTriangle& triangle) {
+            return getBin(component(triangle.centroid, bestAxis), axisMin, binScale, binCount) < bestSplit;
+        });
+        middle = static_cast<size_t>(partitionEnd - triangles.begin());
+        mNodes[nodeIndex].axis = static_cast<uint8_t>(bestAxis);
+    }
+
+    if (middle == begin || middle == end) {
+        middle = begin + count / 2;
+    }
+
+    buildNode(mesh, triangles, begin, middle, depth + 1);
+    const uint32_t rightChild = buildNode(mesh, triangles, middle, end, depth + 1);
+    mNodes[nodeIndex].offset = rightChild;
+    return nodeIndex;
+}
+
+void TriangleBvh::appendBatches(const MeshData& mesh, const BuildTriangle* triangles, size_t count) {
+    for (size_t first = 0; first < count; first += PACKET_WIDTH) {
+        TriangleBatch batch = {};
+        for (uint32_t lane = 0; lane < PACKET_WIDTH; ++lane) {
+            batch.submeshIndices[lane] = INVALID_INDEX;
+            batch.triangleIndices[lane] = INVALID_INDEX;
+            if (first + lane >= count) {
+                continue;
+            }
+
+            const BuildTriangle& triangle = triangles[first + lane];
+            batch.submeshIndices[lane] = triangle.submeshIndex;
+            batch.triangleIndices[lane] = triangle.triangleIndex;
+            float (*vertices[3])[PACKET_WIDTH] = { batch.v0, batch.v1, batch.v2 };
+            for (size_t k = 0; k < 3; ++k) {
+                const Vector3& position = mesh.vertices[mesh.indices[triangle.firstIndex + k]].position;
+                vertices[k][0][lane] = position.x;
+                vertices[k][1][lane] = position.y;
+                vertices[k][2][lane] = position.z;
+            }
+        }
+        mBatches.push_back(batch);
+    }
+}
+
+bool TriangleBvh::intersect(const Ray& ray, RayHit& hit, TraversalStats* stats) const {
+    intersectPacket(&ray, &hit, 1, stats);
+    return hit.isHit();
+}
+
+void TriangleBvh::intersectPacket(const Ray* rays, RayHit* hits, size_t count, TraversalStats* stats) const {
+    count = std::min<size_t>(count, PACKET_WIDTH);
+    for (size_t i = 0; i < count; ++i) {
+        hits[i] = {};
+    }
+    if (mNodes.empty() || count == 0) {
+        return;
+    }
+
+    RayPacket packet;
+    setupPacket(rays, count, packet);
+
+    const Lanes zero = splatLanes(0.0f);
+    const Lanes signMask = splatLanes(-0.0f);
+    TraversalStats counters;
+    uint32_t stack[TRAVERSAL_STACK_SIZE];
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = mNodes[stack[--stackSize]];
+        ++counters.nodesVisited;
+
+        uint32_t mask = intersectBox(packet, node.min, node.max);
+        if (mask == 0) {
+            continue;
+        }
+
+        if (!node.isLeaf()) {
+            // Visit the child on the side the rays come from first, so later boxes are
+            // rejected against the nearer hits found there.
+            const uint32_t leftChild = static_cast<uint32_t>(&node - mNodes.data()) + 1;
+            const bool rightFirst = packet.negativeDirection[node.axis];
+            stack[stackSize++] = rightFirst ? leftChild : node.offset;
+            stack[stackSize++] = rightFirst ? node.offset : leftChild;
+            continue;
+        }
+
+        for (uint32_t batchIndex = node.offset; batchIndex < node.offset + node.batchCount; ++batchIndex) {
+            const TriangleBatch& batch = mBatches[batchIndex];
+            for (uint32_t rayMask = mask; rayMask != 0; rayMask &= rayMask - 1) {
+                const uint32_t ray = lowestLane(rayMask);
+                ++counters.triangleBatchesTested;
+
+                const uint32_t axisX = packet.axisX[ray];
+                const uint32_t axisY = packet.axisY[ray];
+                const uint32_t axisZ = packet.axisZ[ray];
+                const Lanes originX = splatLanes(packet.origin[axisX][ray]);
+                const Lanes originY = splatLanes(packet.origin[axisY][ray]);
+                const Lanes originZ = splatLanes(packet.origin[axisZ][ray]);
+                const Lanes shearX = splatLanes(packet.shearX[ray]);
+                const Lanes shearY = splatLanes(packet.shearY[ray]);
+
+                const Lanes az = subtractLanes(loadLanes(batch.v0[axisZ]), originZ);
+                const Lanes bz = subtractLanes(loadLanes(batch.v1[axisZ]), originZ);
+                const Lanes cz = subtractLanes(loadLanes(batch.v2[axisZ]), originZ);
+                const Lanes ax = subtractLanes(subtractLanes(loadLanes(batch.v0[axisX]), originX), multiplyLanes(shearX, az));
+                const Lanes ay = subtractLanes(subtractLanes(loadLanes(batch.v0[axisY]), originY), multiplyLanes(shearY, az));
+                const Lanes bx = subtractLanes(subtractLanes(loadLanes(batch.v1[axisX]), originX), multiplyLanes(shearX, bz));
+                const Lanes by = subtractLanes(subtractLanes(loadLanes(batch.v1[axisY]), originY), multiplyLanes(shearY, bz));
+                const Lanes cx = subtractLanes(subtractLanes(loadLanes(batch.v2[axisX]), originX), multiplyLanes(shearX, cz));
+                const Lanes cy = subtractLanes(subtractLanes(loadLanes(batch.v2[axisY]), originY), multiplyLanes(shearY, cz));
+
+                // Scaled barycentrics: the 2D edge functions of the sheared triangle at the origin.
+                const Lanes edgeU = subtractLanes(multiplyLanes(cx, by), multiplyLanes(cy, bx));
+                const Lanes edgeV = subtractLanes(multiplyLanes(ax, cy), multiplyLanes(ay, cx));
+                const Lanes edgeW = subtractLanes(multiplyLanes(bx, ay), multiplyLanes(by, ax));
+                const Lanes allNonNegative = andLanes(andLanes(greaterOrEqualLanes(edgeU, zero), greaterOrEqualLanes(edgeV, zero)),
+                    greaterOrEqualLanes(edgeW, zero));
+                const Lanes allNonPositive = andLanes(andLanes(lessOrEqualLanes(edgeU, zero), lessOrEqualLanes(edgeV, zero)),
+                    lessOrEqualLanes(edgeW, zero));
+                const Lanes determinant = addLanes(addLanes(edgeU, edgeV), edgeW);
+
+                const Lanes scaledDistance = multiplyLanes(addLanes(addLanes(multiplyLanes(edgeU, az), multiplyLanes(edgeV, bz)),
+                    multiplyLanes(edgeW, cz)), splatLanes(packet.shearZ[ray]));
+                const Lanes determinantSign = andLanes(determinant, signMask);
+                const Lanes signedDistance = xorLanes(scaledDistance, determinantSign);
+                const Lanes absDeterminant = xorLanes(determinant, determinantSign);
+
+                const Lanes valid = andLanes(andLanes(orLanes(allNonNegative, allNonPositive), notEqualLanes(determinant, zero)),
+                    andLanes(greaterOrEqualLanes(signedDistance, zero),
+                        lessOrEqualLanes(signedDistance, multiplyLanes(splatLanes(packet.maxDistance[ray]), absDeterminant))));
+                uint32_t hitMask = laneMask(valid) & FULL_PACKET_MASK;
+                if (hitMask == 0) {
+                    continue;
+                }
+
+                alignas(32) float distances[PACKET_WIDTH];
+                alignas(32) float determinants[PACKET_WIDTH];
+                storeLanes(distances, signedDistance);
+                storeLanes(determinants, absDeterminant);
+
+                uint32_t nearestLane = lowestLane(hitMask);
+                float nearestDistance = distances[nearestLane] / determinants[nearestLane];
+                for (hitMask &= hitMask - 1; hitMask != 0; hitMask &= hitMask - 1) {
+                    const uint32_t lane = lowestLane(hitMask);
+                    const float distance = distances[lane] / determinants[lane];
+                    if (distance < nearestDistance) {
+                        nearestDistance = distance;
+                        nearestLane = lane;
+                    }
+                }
+
+                if (nearestDistance > packet.maxDistance[ray]) {
+                    continue;
+                }
+
+                alignas(32) float weightsV[PACKET_WIDTH];
+                alignas(32) float weightsW[PACKET_WIDTH];
+                alignas(32) float signedDeterminants[PACKET_WIDTH];
+                storeLanes(weightsV, edgeV);
+                storeLanes(weightsW, edgeW);
+                storeLanes(signedDeterminants, determinant);
+
+                RayHit& hit = hits[ray];
+                hit.submeshIndex = batch.submeshIndices[nearestLane];
+                hit.triangleIndex = batch.triangleIndices[nearestLane];
+                hit.distance = nearestDistance;
+                hit.u = weightsV[nearestLane] / signedDeterminants[nearestLane];
+                hit.v = weightsW[nearestLane] / signedDeterminants[nearestLane];
+                packet.maxDistance[ray] = nearestDistance;
+            }
+        }
+    }
+
+    if (stats) {
+        stats->nodesVisited += counters.nodesVisited;
+        stats->triangleBatchesTested += counters.triangleBatchesTested;
+    }
+}
+
+void TriangleBvh::intersect(const std::vector<Ray>& rays, std::vector<RayHit>& hits, ThreadPool* threadPool) const {
+    hits.resize(rays.size());
+    const size_t packetCount = (rays.size() + PACKET_WIDTH - 1) / PACKET_WIDTH;
+    ThreadPool::run(threadPool, packetCount, PACKETS_PER_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t packet = begin; packet < end; ++packet) {
+            const size_t first = packet * PACKET_WIDTH;
+            intersectPacket(&rays[first], &hits[first], std::min<size_t>(PACKET_WIDTH, rays.size() - first));
+        }
+    });
+}
+
+size_t TriangleBvh::getMemoryUsage() const {
+    return mNodes.capacity() * sizeof(Node) + mBatches.capacity() * sizeof(TriangleBatch);
+}
+
+BoundingBox TriangleBvh::getBounds() const {
+    if (mNodes.empty()) {
+        return {};
+    }
+
+    BoundingBox bounds;
+    BoundingBox::CreateFromPoints(bounds, XMVectorSet(mNodes[0].min[0], mNodes[0].min[1], mNodes[0].min[2], 0.0f),
+        XMVectorSet(mNodes[0].max[0], mNodes[0].max[1], mNodes[0].max[2], 0.0f));
+    return bounds;
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#ifndef TRIANGLE_BVH_H
+#define TRIANGLE_BVH_H
+
+#include "query_shapes.h"
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+struct MeshData;
+class ThreadPool;
+
+// Triangle-level bounding volume hierarchy for ray casts against static geometry, built
+// with the binned surface area heuristic. Rays are traced in packets of PACKET_WIDTH: every
+// node box is tested against the whole packet at once, and leaves store their triangles in
+// SoA batches of PACKET_WIDTH so each ray tests a batch with one watertight SIMD test
+// (Woop, Benthin and Wald 2013). Rays touching a shared edge or vertex never slip through.
+class TriangleBvh {
+public:
+#if defined(_XM_AVX_INTRINSICS_)
+    static constexpr uint32_t PACKET_WIDTH = 8;
+#else
+    static constexpr uint32_t PACKET_WIDTH = 4;
+#endif
+    static constexpr uint32_t INVALID_INDEX = ~0u;
+    static constexpr size_t MAX_DEPTH = 64;
+
+    struct BuildSettings {
+        size_t binCount = 16;
+    };
+
+    // The hit point is (1 - u - v) * v0 + u * v1 + v * v2 for the triangle's vertices in
+    // index order; its first index is startIndiceIndex + 3 * triangleIndex of the submesh.
+    struct RayHit {
+        uint32_t submeshIndex = INVALID_INDEX;
+        uint32_t triangleIndex = INVALID_INDEX;
+        float distance = FLT_MAX;
+        float u = 0.0f;
+        float v = 0.0f;
+
+        bool isHit() const { return submeshIndex != INVALID_INDEX; }
+    };
+
+    struct TraversalStats {
+        size_t nodesVisited = 0;
+        size_t triangleBatchesTested = 0;
+    };
+
+    TriangleBvh() = default;
+    explicit TriangleBvh(const BuildSettings& settings);
+
+    void build(const MeshData& mesh);
+
+    // Finds the nearest hit within ray.maxDistance; distances are in units of the ray
+    // direction's length. Returns false on a miss.
+    bool intersect(const Ray& ray, RayHit& hit, TraversalStats* stats = nullptr) const;
+    // Traces up to PACKET_WIDTH rays together. Packets of rays with similar origins and
+    // directions visit mostly the same nodes, which is where the packet pays off.
+    void intersectPacket(const Ray* rays, RayHit* hits, size_t count, TraversalStats* stats = nullptr) const;
+    // Splits the rays into packets of consecutive rays and traces them on the thread pool.
+    void intersect(const std::vector<Ray>& rays, std::vector<RayHit>& hits, ThreadPool* threadPool = nullptr) const;
+
+    bool empty() const { return mNodes.empty(); }
+    size_t getNodeCount() const { return mNodes.size(); }
+    size_t getTriangleCount() const { return mTriangleCount; }
+    size_t getMemoryUsage() const;
+    DirectX::BoundingBox getBounds() const;
+
+private:
+    // Nodes are stored depth first, so the left child of an inner node directly follows
+    // it. An inner node stores its right child in offset; a leaf stores its first batch.
+    struct Node {
+        float min[3] = {};
+        float max[3] = {};
+        uint32_t offset = 0;
+        uint16_t batchCount = 0;
+        uint8_t axis = 0;
+
+        bool isLeaf() const { return batchCount != 0; }
+    };
+
+    // Unused lanes hold a degenerate triangle at the origin, which no ray can hit.
+    struct alignas(32) TriangleBatch {
+        float v0[3][PACKET_WIDTH];
+        float v1[3][PACKET_WIDTH];
+        float v2[3][PACKET_WIDTH];
+        uint32_t submeshIndices[PACKET_WIDTH];
+        uint32_t triangleIndices[PACKET_WIDTH];
+    };
+
+    struct BuildTriangle {
+        DirectX::XMFLOAT3 min = {};
+        DirectX::XMFLOAT3 max = {};
+        DirectX::XMFLOAT3 centroid = {};
+        uint32_t submeshIndex = 0;
+        uint32_t triangleIndex = 0;
+        uint32_t firstIndex = 0;
+    };
+
+    static constexpr size_t MAX_BIN_COUNT = 32;
+    static constexpr size_t TRAVERSAL_STACK_SIZE = MAX_DEPTH + 2;
+
+    BuildSettings mSettings;
+    std::vector<Node> mNodes;
+    std::vector<TriangleBatch> mBatches;
+    size_t mTriangleCount = 0;
+
+    uint32_t buildNode(const MeshData& mesh, std::vector<BuildTriangle>& triangles, size_t begin, size_t end, size_t depth);
+    void appendBatches(const MeshData& mesh, const BuildTriangle* triangles, size_t count);
+};
+
+#endif // TRIANGLE_BVH_H
\ No newline at end of file
@@ -0,0 +1,276 @@
+#include "vertex_format.h"
+
+#include <DirectXPackedVector.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace {
+    constexpr VertexFormat VERTEX_FORMATS[] = { VertexFormat::Full, VertexFormat::Packed, VertexFormat::Quantized };
+    constexpr float SNORM16_MAX = 32767.0f;
+    // The tangent's x gives up its lowest bit to the handedness.
+    constexpr float TANGENT_X_MAX = 16383.0f;
+    constexpr float UNORM16_MAX = 65535.0f;
+
+    static_assert(sizeof(FullAttributes) == 44, "FullAttributes must match the full input layout");
+    static_assert(sizeof(PackedAttributes) == 12, "PackedAttributes must match the packed input layout");
+    static_assert(sizeof(QuantizedPosition) == 8, "QuantizedPosition must match the quantized input layout");
+
+    float signNotZero(float value) {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+
+    Vector3 decodeOctahedral(float x, float y) {
+        Vector3 direction(x, y, 1.0f - std::fabs(x) - std::fabs(y));
+        if (direction.z < 0.0f) {
+            direction.x = (1.0f - std::fabs(y)) * signNotZero(x);
+            direction.y = (1.0f - std::fabs(x)) * signNotZero(y);
+        }
+        direction.Normalize();
+        return direction;
+    }
+
+    // Of the four neighbouring grid points of the projected direction, keeps the one that
+    // decodes closest to it; plain rounding can be off by a whole step after the fold.
+    void encodeOctahedral(const Vector3& direction, float maxX, float maxY, int& x, int& y) {
+        const float sum = std::fabs(direction.x) + std::fabs(direction.y) + std::fabs(direction.z);
+        if (sum <= FLT_MIN) {
+            x = 0;
+            y = 0;
+            return;
+        }
+
+        float projectedX = direction.x / sum;
+        float projectedY = direction.y / sum;
+        if (direction.z < 0.0f) {
+            const float foldedX = (1.0f - std::fabs(projectedY)) * signNotZero(projectedX);
+            projectedY = (1.0f - std::fabs(projectedX)) * signNotZero(projectedY);
+            projectedX = foldedX;
+        }
+
+        const Vector3 target = direction / sum;
+        float bestDot = -FLT_MAX;
+        for (int corner = 0; corner < 4; ++corner) {
+            const float cornerX = (corner & 1) ? std::ceil(projectedX * maxX) : std::floor(projectedX * maxX);
+            const float cornerY = (corner & 2) ? std::ceil(projectedY * maxY) : std::floor(projectedY * maxY);
+            const float dot = decodeOctahedral(cornerX / maxX, cornerY / maxY).Dot(target);
+            if (dot > bestDot) {
+                bestDot = dot;
+                x = static_cast<int>(cornerX);
+                y = static_cast<int>(cornerY);
+            }
+        }
+    }
+
+    void packVertexAttributes(const Vertex& vertex, PackedAttributes& packed) {
+        int x = 0;
+        int y = 0;
+        encodeOctahedral(vertex.normal, SNORM16_MAX, SNORM16_MAX, x, y);
+        packed.normal[0] = static_cast<int16_t>(x);
+        packed.normal[1] = static_cast<int16_t>(y);
+
+        const float handedness = vertex.normal.Cross(vertex.tangent).Dot(vertex.bitangent);
+        encodeOctahedral(vertex.tangent, TANGENT_X_MAX, SNORM16_MAX, x, y);
+        packed.tangent[0] = static_cast<int16_t>(x * 2 + (handedness < 0.0f ? 1 : 0));
+        packed.tangent[1] = static_cast<int16_t>(y);
+
+        packed.texCoord[0] = XMConvertFloatToHalf(vertex.texCoord.x);
+        packed.texCoord[1] = XMConvertFloatToHalf(vertex.texCoord.y);
+    }
+
+    void unpackVertexAttributes(const PackedAttributes& packed, Vertex& vertex) {
+        vertex.normal = decodeOctahedral(packed.normal[0] / SNORM16_MAX, packed.normal[1] / SNORM16_MAX);
+
+        const int handednessBit = packed.tangent[0] & 1;
+        vertex.tangent = decodeOctahedral(((packed.tangent[0] - handednessBit) / 2) / TANGENT_X_MAX,
+            packed.tangent[1] / SNORM16_MAX);
+        vertex.bitangent = vertex.normal.Cross(vertex.tangent) * (handednessBit ? -1.0f : 1.0f);
+
+        vertex.texCoord = Vector2(XMConvertHalfToFloat(packed.texCoord[0]), XMConvertHalfToFloat(packed.texCoord[1]));
+    }
+
+    uint16_t quantize(float value, float origin, float extent) {
+        if (extent <= 0.0f) {
+            return 0;
+        }
+        const float normalized = std::min(std::max((value - origin) / extent, 0.0f), 1.0f);
+        return static_cast<uint16_t>(std::lround(normalized * UNORM16_MAX));
+    }
+
+    template <typename Element>
+    void copyStream(const std::vector<Element>& elements, std::vector<uint8_t>& stream) {
+        stream.resize(elements.size() * sizeof(Element));
+        if (!elements.empty()) {
+            std::memcpy(stream.data(), elements.data(), stream.size());
+        }
+    }
+
+    struct PositionHash {
+        size_t operator()(const XMFLOAT3& position) const {
+            uint32_t bits[3];
+            std::memcpy(bits, &position, sizeof(bits));
+            return (static_cast<size_t>(bits[0]) * 73856093u) ^ (static_cast<size_t>(bits[1]) * 19349663u) ^
+                (static_cast<size_t>(bits[2]) * 83492791u);
+        }
+    };
+
+    // Bitwise, so -0 and 0 stay apart like they do after quantization.
+    struct PositionEqual {
+        bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const {
+            return std::memcmp(&a, &b, sizeof(XMFLOAT3)) == 0;
+        }
+    };
+}
+
+const char* getVertexFormatName(VertexFormat format) {
+    switch (format) {
+    case VertexFormat::Packed:
+        return "packed";
+    case VertexFormat::Quantized:
+        return "quantized";
+    case VertexFormat::Full:
+    default:
+        return "full";
+    }
+}
+
+bool parseVertexFormat(const std::string& name, VertexFormat& format) {
+    for (VertexFormat candidate : VERTEX_FORMATS) {
+        if (name == getVertexFormatName(candidate)) {
+            format = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t getPositionStride(VertexFormat format) {
+    return format == VertexFormat::Quantized ? sizeof(QuantizedPosition) : sizeof(XMFLOAT3);
+}
+
+size_t getAttributeStride(VertexFormat format) {
+    return format == VertexFormat::Full ? sizeof(FullAttributes) : sizeof(PackedAttributes);
+}
+
+size_t getSubmeshVertexEnd(const MeshData& mesh, size_t submeshIndex) {
+    return submeshIndex + 1 < mesh.submeshes.size() ? mesh.submeshes[submeshIndex + 1].startVerticeIndex : mesh.vertices.size();
+}
+
+std::vector<PackedAttributes> packAttributes(const std::vector<Vertex>& vertices) {
+    std::vector<PackedAttributes> packed(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        packVertexAttributes(vertices[i], packed[i]);
+    }
+    return packed;
+}
+
+std::vector<QuantizedPosition> quantizePositions(MeshData& mesh) {
+    std::vector<QuantizedPosition> quantized(mesh.vertices.size());
+    if (mesh.vertices.empty()) {
+        return quantized;
+    }
+
+    // One grid for the whole mesh: a position shared by neighbouring submeshes lands on the
+    // same grid point in each of them, so their shared edges stay watertight.
+    XMVECTOR minimum = XMVectorReplicate(FLT_MAX);
+    XMVECTOR maximum = XMVectorReplicate(-FLT_MAX);
+    for (const Vertex& vertex : mesh.vertices) {
+        const XMVECTOR position = XMLoadFloat3(&vertex.position);
+        minimum = XMVectorMin(minimum, position);
+        maximum = XMVectorMax(maximum, position);
+    }
+    XMFLOAT3 origin;
+    XMFLOAT3 extent;
+    XMStoreFloat3(&origin, minimum);
+    XMStoreFloat3(&extent, XMVectorSubtract(maximum, minimum));
+    for (Submesh& submesh : mesh.submeshes) {
+        submesh.positionOrigin = origin;
+        submesh.positionExtent = extent;
+    }
+
+    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+        const Vector3& position = mesh.vertices[i].position;
+        QuantizedPosition& packed = quantized[i];
+        packed.position[0] = quantize(position.x, origin.x, extent.x);
+        packed.position[1] = quantize(position.y, origin.y, extent.y);
+        packed.position[2] = quantize(position.z, origin.z, extent.z);
+        packed.position[3] = 0;
+    }
+    return quantized;
+}
+
+VertexStreams createVertexStreams(MeshData& mesh, VertexFormat format) {
+    VertexStreams streams;
+    streams.positionStride = static_cast<UINT>(getPositionStride(format));
+    streams.attributeStride = static_cast<UINT>(getAttributeStride(format));
+
+    if (format == VertexFormat::Quantized) {
+        copyStream(quantizePositions(mesh), streams.positions);
+    }
+    else {
+        std::vector<XMFLOAT3> positions(mesh.vertices.size());
+        for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+            positions[i] = mesh.vertices[i].position;
+        }
+        copyStream(positions, streams.positions);
+    }
+
+    if (format == VertexFormat::Full) {
+        std::vector<FullAttributes> attributes(mesh.vertices.size());
+        for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+            const Vertex& vertex = mesh.vertices[i];
+            attributes[i] = { vertex.normal, vertex.tangent, vertex.bitangent, vertex.texCoord };
+        }
+        copyStream(attributes, streams.attributes);
+    }
+    else {
+        copyStream(packAttributes(mesh.vertices), streams.attributes);
+    }
+    return streams;
+}
+
+std::vector<uint32_t> createPositionWeldedIndices(const MeshData& mesh) {
+    std::vector<uint32_t> indices(mesh.indices);
+    std::vector<uint32_t> canonicalVertices(mesh.vertices.size());
+    std::unordered_map<XMFLOAT3, uint32_t, PositionHash, PositionEqual> firstVertices;
+    for (size_t submeshIndex = 0; submeshIndex < mesh.submeshes.size(); ++submeshIndex) {
+        const Submesh& submesh = mesh.submeshes[submeshIndex];
+        const size_t vertexEnd = getSubmeshVertexEnd(mesh, submeshIndex);
+
+        firstVertices.clear();
+        for (size_t i = submesh.startVerticeIndex; i < vertexEnd; ++i) {
+            canonicalVertices[i] = firstVertices.emplace(mesh.vertices[i].position, static_cast<uint32_t>(i)).first->second;
+        }
+        for (UINT i = 0; i < submesh.indexCount; ++i) {
+            uint32_t& index = indices[submesh.startIndiceIndex + i];
+            if (index >= submesh.startVerticeIndex && index < vertexEnd) {
+                index = canonicalVertices[index];
+            }
+        }
+    }
+    return indices;
+}
+
+Vertex unpackVertex(const XMFLOAT3& position, const PackedAttributes& attributes) {
+    Vertex unpacked;
+    unpacked.position = position;
+    unpackVertexAttributes(attributes, unpacked);
+    return unpacked;
+}
+
+Vertex unpackVertex(const QuantizedPosition& position, const PackedAttributes& attributes, const Submesh& submesh) {
+    Vertex unpacked;
+    unpacked.position = Vector3(
+        submesh.positionOrigin.x + position.position[0] / UNORM16_MAX * submesh.positionExtent.x,
+        submesh.positionOrigin.y + position.position[1] / UNORM16_MAX * submesh.positionExtent.y,
+        submesh.positionOrigin.z + position.position[2] / UNORM16_MAX * submesh.positionExtent.z);
+    unpackVertexAttributes(attributes, unpacked);
+    return unpacked;
+}
\ No newline at end of file
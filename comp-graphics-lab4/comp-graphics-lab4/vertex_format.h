@@ -0,0 +1,76 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include "mesh_data.h"
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Layout of the GPU vertex buffers. The CPU keeps full Vertex data either way; the compact
+// formats only change what the geometry passes fetch.
+enum class VertexFormat {
+    Full,
+    Packed,
+    Quantized
+};
+
+// Vertices are uploaded as two streams: positions in slot 0, so depth-only passes fetch
+// nothing else, and the shading attributes in slot 1.
+struct FullAttributes {
+    Vector3 normal;
+    Vector3 tangent;
+    Vector3 bitangent;
+    Vector2 texCoord;
+};
+
+// Normal and tangent are octahedral encoded. The tangent is stored as signed integers whose x
+// carries the bitangent handedness in its lowest bit, so the bitangent is rebuilt as
+// cross(normal, tangent) * handedness. UVs are half floats.
+struct PackedAttributes {
+    int16_t normal[2];
+    int16_t tangent[2];
+    uint16_t texCoord[2];
+};
+
+// Position quantized to 16 bits per axis inside the range of the whole mesh, see
+// Submesh::positionOrigin. The fourth component only pads the element.
+struct QuantizedPosition {
+    uint16_t position[4];
+};
+
+struct VertexStreams {
+    std::vector<uint8_t> positions;
+    std::vector<uint8_t> attributes;
+    UINT positionStride = 0;
+    UINT attributeStride = 0;
+};
+
+const char* getVertexFormatName(VertexFormat format);
+bool parseVertexFormat(const std::string& name, VertexFormat& format);
+size_t getPositionStride(VertexFormat format);
+size_t getAttributeStride(VertexFormat format);
+
+// Submeshes own the vertices from their startVerticeIndex up to the next submesh's.
+size_t getSubmeshVertexEnd(const MeshData& mesh, size_t submeshIndex);
+
+std::vector<PackedAttributes> packAttributes(const std::vector<Vertex>& vertices);
+
+// Quantizes against the bounds of all of the mesh's vertices and stores that range in every
+// submesh.
+std::vector<QuantizedPosition> quantizePositions(MeshData& mesh);
+
+// Quantized formats store the position ranges in the submeshes.
+VertexStreams createVertexStreams(MeshData& mesh, VertexFormat format);
+
+// Same triangles as mesh.indices, but every index points at the first vertex of its submesh
+// with the same position, so a depth-only pass shares vertices across normal and UV seams.
+std::vector<uint32_t> createPositionWeldedIndices(const MeshData& mesh);
+
+// Decode exactly as vertex_input.hlsli does.
+Vertex unpackVertex(const DirectX::XMFLOAT3& position, const PackedAttributes& attributes);
+Vertex unpackVertex(const QuantizedPosition& position, const PackedAttributes& attributes, const Submesh& submesh);
+
+#endif // VERTEX_FORMAT_H
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "vertex_format_benchmark.h"
+#include "vertex_format.h"
+#include "index_pools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <tuple>
+#include <unordered_set>
+
+using namespace DirectX;
+
+namespace {
+    constexpr double BYTES_PER_MEGABYTE = 1024.0 * 1024.0;
+
+    struct ErrorStats {
+        double max = 0.0;
+        double sum = 0.0;
+
+        void add(double error) {
+            max = std::max(max, error);
+            sum += error;
+        }
+    };
+
+    struct RoundTripErrors {
+        ErrorStats position;
+        ErrorStats normal;
+        ErrorStats tangent;
+        ErrorStats bitangent;
+        ErrorStats texCoord;
+        size_t handednessFlips = 0;
+    };
+
+    // atan2 keeps its precision for the tiny angles acos loses in float.
+    double getAngleDegrees(Vector3 expected, const Vector3& actual) {
+        expected.Normalize();
+        return XMConvertToDegrees(std::atan2(expected.Cross(actual).Length(), expected.Dot(actual)));
+    }
+
+    void addRoundTrip(const Vertex& source, const Vertex& decoded, RoundTripErrors& errors) {
+        errors.position.add((source.position - decoded.position).Length());
+        errors.normal.add(getAngleDegrees(source.normal, decoded.normal));
+        errors.tangent.add(getAngleDegrees(source.tangent, decoded.tangent));
+        // Includes how far the source bitangent is from cross(normal, tangent).
+        errors.bitangent.add(getAngleDegrees(source.bitangent, decoded.bitangent));
+        errors.texCoord.add(std::max(std::fabs(source.texCoord.x - decoded.texCoord.x), std::fabs(source.texCoord.y - decoded.texCoord.y)));
+        if (source.bitangent.Dot(decoded.bitangent) < 0.0f) {
+            ++errors.handednessFlips;
+        }
+    }
+
+    void reportErrors(const char* name, const RoundTripErrors& errors, size_t vertexCount, std::ostream& out) {
+        const double count = static_cast<double>(std::max<size_t>(vertexCount, 1));
+        auto report = [&](const char* quantity, const ErrorStats& stats) {
+            out << "  " << std::left << std::setw(22) << quantity << std::right << std::setw(12) << stats.max <<
+                std::setw(12) << stats.sum / count << "\n";
+        };
+
+        out << name << " round-trip error (max, mean)\n";
+        report("position", errors.position);
+        report("normal degrees", errors.normal);
+        report("tangent degrees", errors.tangent);
+        report("bitangent degrees", errors.bitangent);
+        report("uv", errors.texCoord);
+        out << "  " << std::left << std::setw(22) << "handedness flips" << std::right << std::setw(12) <<
+            errors.handednessFlips << "\n";
+    }
+
+    // Largest distance between the decoded copies of one source position in different
+    // submeshes. Anything above zero opens cracks along the submesh seams.
+    double getSharedPositionMismatch(const MeshData& mesh, const std::vector<QuantizedPosition>& quantized,
+        const std::vector<PackedAttributes>& packed, size_t& sharedPositionCount) {
+        struct FirstCopy {
+            size_t submeshIndex;
+            Vector3 decoded;
+            bool shared;
+        };
+
+        std::map<std::tuple<float, float, float>, FirstCopy> firstCopies;
+        double mismatch = 0.0;
+        for (size_t submeshIndex = 0; submeshIndex < mesh.submeshes.size(); ++submeshIndex) {
+            const Submesh& submesh = mesh.submeshes[submeshIndex];
+            for (size_t i = submesh.startVerticeIndex; i < getSubmeshVertexEnd(mesh, submeshIndex); ++i) {
+                const Vector3& position = mesh.vertices[i].position;
+                const Vector3 decoded = unpackVertex(quantized[i], packed[i], submesh).position;
+                const auto inserted = firstCopies.emplace(std::make_tuple(position.x, position.y, position.z),
+                    FirstCopy{ submeshIndex, decoded, false });
+                FirstCopy& first = inserted.first->second;
+                if (!inserted.second && first.submeshIndex != submeshIndex) {
+                    first.shared = true;
+                    mismatch = std::max(mismatch, static_cast<double>((first.decoded - decoded).Length()));
+                }
+            }
+        }
+
+        sharedPositionCount = std::count_if(firstCopies.begin(), firstCopies.end(),
+            [](const auto& entry) { return entry.second.shared; });
+        return mismatch;
+    }
+}
+
+void runVertexFormatBenchmark(MeshData& mesh, std::ostream& out) {
+    const size_t vertexCount = mesh.vertices.size();
+    const size_t indexCount = mesh.indices.size();
+    const std::vector<PackedAttributes> packed = packAttributes(mesh.vertices);
+    const std::vector<QuantizedPosition> quantized = quantizePositions(mesh);
+
+    RoundTripErrors packedErrors;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        addRoundTrip(mesh.vertices[i], unpackVertex(mesh.vertices[i].position, packed[i]), packedErrors);
+    }
+
+    RoundTripErrors quantizedErrors;
+    for (size_t submeshIndex = 0; submeshIndex < mesh.submeshes.size(); ++submeshIndex) {
+        const Submesh& submesh = mesh.submeshes[submeshIndex];
+        for (size_t i = submesh.startVerticeIndex; i < getSubmeshVertexEnd(mesh, submeshIndex); ++i) {
+            addRoundTrip(mesh.vertices[i], unpackVertex(quantized[i], packed[i], submesh), quantizedErrors);
+        }
+    }
+
+    size_t sharedPositionCount = 0;
+    const double sharedPositionMismatch = getSharedPositionMismatch(mesh, quantized, packed, sharedPositionCount);
+
+    const std::unordered_set<uint32_t> shadedVertices(mesh.indices.begin(), mesh.indices.end());
+    const std::vector<uint32_t> weldedIndices = createPositionWeldedIndices(mesh);
+    const std::unordered_set<uint32_t> depthVertices(weldedIndices.begin(), weldedIndices.end());
+
+    out << "vertices: " << vertexCount << ", indices: " << indexCount << ", submeshes: " << mesh.submeshes.size() << "\n";
+    out << "vertices referenced: " << shadedVertices.size() << ", after position welding: " << depthVertices.size() << "\n";
+    out << std::left << std::setw(12) << "format" << std::right << std::setw(8) << "stride" << std::setw(14) <<
+        "buffer MB" << std::setw(10) << "saved" << std::setw(16) << "fetch MB/draw" << std::setw(16) << "depth MB/draw" << "\n";
+
+    const double fullBytes = static_cast<double>(vertexCount * (getPositionStride(VertexFormat::Full) + getAttributeStride(VertexFormat::Full)));
+    for (VertexFormat format : { VertexFormat::Full, VertexFormat::Packed, VertexFormat::Quantized }) {
+        const size_t stride = getPositionStride(format) + getAttributeStride(format);
+        const double bufferBytes = static_cast<double>(vertexCount * stride);
+        // Upper bounds: every index fetches its vertex when the post-transform cache misses.
+        // The depth pass reads only the position stream.
+        const double fetchBytes = static_cast<double>(indexCount * stride);
+        const double depthFetchBytes = static_cast<double>(indexCount * getPositionStride(format));
+        out << std::left << std::setw(12) << getVertexFormatName(format) << std::right << std::setw(8) << stride <<
+            std::fixed << std::setprecision(2) << std::setw(14) << bufferBytes / BYTES_PER_MEGABYTE <<
+            std::setw(9) << (fullBytes > 0.0 ? 100.0 * (1.0 - bufferBytes / fullBytes) : 0.0) << "%" <<
+            std::setw(16) << fetchBytes / BYTES_PER_MEGABYTE << std::setw(16) << depthFetchBytes / BYTES_PER_MEGABYTE << "\n";
+    }
+
+    assignIndexPools(mesh);
+    const IndexPools indexPools = createIndexPools(mesh, mesh.indices);
+    const size_t shortSubmeshCount = std::count_if(mesh.submeshes.begin(), mesh.submeshes.end(),
+        [](const Submesh& submesh) { return submesh.shortIndices; });
+    const double longIndexBytes = static_cast<double>(indexCount * sizeof(uint32_t));
+    const double pooledIndexBytes = static_cast<double>(indexPools.getByteSize());
+    out << "\nindex buffer MB: 32-bit " << longIndexBytes / BYTES_PER_MEGABYTE << ", pooled " <<
+        pooledIndexBytes / BYTES_PER_MEGABYTE << ", saved " <<
+        (longIndexBytes > 0.0 ? 100.0 * (1.0 - pooledIndexBytes / longIndexBytes) : 0.0) << "%\n";
+    out << "submeshes with 16-bit indices: " << shortSubmeshCount << "/" << mesh.submeshes.size() <<
+        ", indices: " << indexPools.shortIndices.size() << "/" << indexCount << "\n";
+
+    out << "\n" << std::scientific << std::setprecision(3);
+    reportErrors("packed", packedErrors, vertexCount, out);
+    out << "\n";
+    reportErrors("quantized", quantizedErrors, vertexCount, out);
+    out << "  " << std::left << std::setw(22) << "shared position gap" << std::right << std::setw(12) <<
+        sharedPositionMismatch << "  (" << sharedPositionCount << " positions in several submeshes)\n";
+}
\ No newline at end of file
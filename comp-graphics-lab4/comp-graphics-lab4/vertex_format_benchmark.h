@@ -0,0 +1,15 @@
+#ifndef VERTEX_FORMAT_BENCHMARK_H
+#define VERTEX_FORMAT_BENCHMARK_H
+
+#include <ostream>
+
+struct MeshData;
+
+// Packs the mesh in every vertex format and reports the vertex buffer size, the vertex bytes
+// one draw of every submesh fetches at most with all streams and with the position stream
+// alone, how many vertices position welding saves the depth pass, the round-trip error of the
+// compact formats, and how much the 16-bit index pool saves over 32-bit indices. Quantizing and
+// pooling store their per submesh ranges in the submeshes.
+void runVertexFormatBenchmark(MeshData& mesh, std::ostream& out);
+
+#endif // VERTEX_FORMAT_BENCHMARK_H
\ No newline at end of file
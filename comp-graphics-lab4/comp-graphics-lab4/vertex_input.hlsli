@@ -0,0 +1,98 @@
+// Vertex input of the geometry passes, see vertex_format.h. PACKED_VERTICES selects
+// PackedAttributes and QUANTIZED_VERTICES additionally QuantizedPosition; without either the
+// input is full precision. Positions come from stream 0 and the other attributes from stream 1.
+// Expects gWorldViewProj, gPositionOrigin and gPositionExtent in cbPerObject.
+
+// Depth-only passes bind the position stream alone.
+struct PositionIn
+{
+#if defined(QUANTIZED_VERTICES)
+    float4 PosQ : POSITION;
+#else
+    float3 PosL : POSITION;
+#endif
+};
+
+struct VertexIn
+{
+#if defined(QUANTIZED_VERTICES)
+    float4 PosQ : POSITION;
+#else
+    float3 PosL : POSITION;
+#endif
+#if defined(PACKED_VERTICES) || defined(QUANTIZED_VERTICES)
+    float2 NormalOct : NORMAL;
+    int2 TangentOct : TANGENT;
+#else
+    float3 NormalL : NORMAL;
+    float3 TangentL : TANGENT;
+    float3 BitangentL : BINORMAL;
+#endif
+    float2 TexC : TEXCOORD;
+};
+
+struct VertexAttributes
+{
+    float3 PosL;
+    float3 NormalL;
+    float3 TangentL;
+    float3 BitangentL;
+    float2 TexC;
+};
+
+float3 decodeOctahedral(float2 e)
+{
+    float3 v = float3(e, 1.0f - abs(e.x) - abs(e.y));
+    if (v.z < 0.0f)
+    {
+        v.xy = (1.0f - abs(v.yx)) * (v.xy >= 0.0f ? 1.0f : -1.0f);
+    }
+    return normalize(v);
+}
+
+// The geometry pass depth-tests LESS_EQUAL against the depth pre-pass, so both must turn a
+// vertex into bit-identical clip positions. precise keeps the compiler from fusing or
+// reordering the decode and the projection differently in the two shaders.
+float3 decodeQuantizedPosition(float4 posQ)
+{
+    precise float3 posL = gPositionOrigin + posQ.xyz * gPositionExtent;
+    return posL;
+}
+
+float4 projectPosition(float3 posL)
+{
+    precise float4 posH = mul(float4(posL, 1.0f), gWorldViewProj);
+    return posH;
+}
+
+float3 decodePosition(PositionIn pin)
+{
+#if defined(QUANTIZED_VERTICES)
+    return decodeQuantizedPosition(pin.PosQ);
+#else
+    return pin.PosL;
+#endif
+}
+
+VertexAttributes decodeVertex(VertexIn vin)
+{
+    VertexAttributes v;
+#if defined(QUANTIZED_VERTICES)
+    v.PosL = decodeQuantizedPosition(vin.PosQ);
+#else
+    v.PosL = vin.PosL;
+#endif
+#if defined(PACKED_VERTICES) || defined(QUANTIZED_VERTICES)
+    // The lowest bit of the tangent's x is the bitangent handedness.
+    int handednessBit = vin.TangentOct.x & 1;
+    v.NormalL = decodeOctahedral(vin.NormalOct);
+    v.TangentL = decodeOctahedral(float2((vin.TangentOct.x - handednessBit) / 2, vin.TangentOct.y) / float2(16383.0f, 32767.0f));
+    v.BitangentL = cross(v.NormalL, v.TangentL) * (handednessBit ? -1.0f : 1.0f);
+#else
+    v.NormalL = vin.NormalL;
+    v.TangentL = vin.TangentL;
+    v.BitangentL = vin.BitangentL;
+#endif
+    v.TexC = vin.TexC;
+    return v;
+}
\ No newline at end of file